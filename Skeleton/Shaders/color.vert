@@ -5,6 +5,9 @@ attribute vec3 vPositions;
 attribute vec3 vNormals;
 
 uniform mat4 uMVP;
+
+//Same expression as occlusion.vert for the meshes : the depth of the pre-pass and of the shading pass must be equal, for GL_EQUAL
+invariant gl_Position;
 uniform mat4 modelmatrix;
 uniform mat3 inv_modelmatrix;
 
@@ -14,13 +17,60 @@ varying vec3 vary_normal;
 attribute vec2 vUV;
 varying vec2 vary_UV;
 
+uniform bool uOctNormals; //The normals are 2 octahedral components (VERTEX_FORMAT_COMPACT)
+
+uniform bool  uProcedural; //No vertex buffer : the vertex of a UV sphere is computed from gl_VertexID
+uniform ivec2 uGrid;       //(nbLatitude, nbLongitude) of the procedural sphere
+
+vec3 decodeOctahedral(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if(n.z < 0.0)
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(n);
+}
+
+//Same vertices as Sphere, drawn as one triangle strip per longitude band : (i, 0) repeated, then (i, j), (i+1, j) for each latitude,
+//then (i+1, nbLatitude-1) repeated, so that the bands are joined by degenerated triangles
+void proceduralSphere(out vec3 position, out vec3 normal, out vec2 uv)
+{
+	int perBand = 2*uGrid.x + 2;
+	int i = gl_VertexID / perBand;
+	int k = gl_VertexID - i*perBand;
+	int j = 0;
+	if(k == perBand-1)
+	{
+		i++;
+		j = uGrid.x-1;
+	}
+	else if(k > 0)
+	{
+		j  = (k-1)/2;
+		i += (k-1) - 2*j;
+	}
+
+	uv = vec2(float(i) / float(uGrid.y-1), float(j) / float(uGrid.x-1));
+	float theta = (i == uGrid.y-1) ? 0.0 : 6.28318530718*uv.x; //The last longitude closes the seam exactly
+	float phi   = 3.14159265359*uv.y;
+	normal      = vec3(sin(phi)*sin(theta), cos(phi), cos(theta)*sin(phi));
+	position    = 0.5*normal;
+}
+
 void main()
 {
-	
-	gl_Position =uMVP*vec4(vPositions, 1.0); 
-	vary_normal = normalize(transpose(inv_modelmatrix)*vNormals);
-	vec4 tmp = modelmatrix * vec4(vPositions, 1.0);
+	vec3 position = vPositions;
+	vec3 normal   = uOctNormals ? decodeOctahedral(vNormals.xy) : vNormals;
+	vec2 uv       = vUV;
+	if(uProcedural)
+	{
+		proceduralSphere(position, normal, uv);
+		gl_Position = uMVP*vec4(position, 1.0);
+	}
+	else
+		gl_Position = uMVP*vec4(vPositions, 1.0);
+	vary_normal = normalize(transpose(inv_modelmatrix)*normal);
+	vec4 tmp = modelmatrix * vec4(position, 1.0);
 	tmp = tmp / tmp.w;
 	vary_position=tmp.xyz;
-	vary_UV = vUV;
+	vary_UV = uv;
 }
@@ -0,0 +1,8 @@
+#version 130
+
+//A triangle over the whole screen, on the far plane (see OverdrawCounter::measureCoverage)
+void main()
+{
+	vec2 corner = vec2(float((gl_VertexID & 1) << 2) - 1.0, float((gl_VertexID & 2) << 1) - 1.0);
+	gl_Position = vec4(corner, 1.0, 1.0);
+}
@@ -0,0 +1,47 @@
+#version 430
+
+//The bodies kept by the GPU culling (see GpuCuller) : the instanced attribute is the index of the body record
+
+in vec3 vPositions;
+in vec3 vNormals;
+in vec2 vUV;
+in uint vDraw;
+
+struct Body
+{
+	mat4 model;
+	vec4 normalMatrix[3]; //Texture layer in the w of the first column
+};
+
+layout(std430, binding = 0) readonly buffer Bodies { Body bodies[]; };
+
+uniform mat4 uViewProjection;
+uniform bool uOctNormals; //The normals are 2 octahedral components (VERTEX_FORMAT_COMPACT)
+
+out vec3 vary_position;
+out vec3 vary_normal;
+out vec2 vary_UV;
+flat out float vary_layer;
+
+vec3 decodeOctahedral(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if(n.z < 0.0)
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(n);
+}
+
+void main()
+{
+	Body body = bodies[vDraw];
+	mat3 normalMatrix = mat3(body.normalMatrix[0].xyz, body.normalMatrix[1].xyz, body.normalMatrix[2].xyz);
+
+	vec3 normal = uOctNormals ? decodeOctahedral(vNormals.xy) : vNormals;
+	vec4 world  = body.model * vec4(vPositions, 1.0);
+
+	gl_Position   = uViewProjection * world;
+	vary_normal   = normalize(normalMatrix * normal);
+	vary_position = world.xyz;
+	vary_UV       = vUV;
+	vary_layer    = body.normalMatrix[0].w;
+}
@@ -0,0 +1,51 @@
+#version 130
+precision highp float;
+
+#define PI 3.14159265358979
+
+uniform mat4 uInvView;     //View to world
+uniform mat4 uProjection;
+uniform mat3 uInvRotation; //World to the frame of the body, to place the texture
+uniform float uRadius;
+uniform sampler2D uTexture;
+
+varying vec3 vary_viewRay;
+varying vec3 vary_center;
+
+//phong() comes from phong.glsl
+
+void main()
+{
+	//Ray (from the camera, at the origin of the view space) / sphere intersection
+	vec3 dir   = normalize(vary_viewRay);
+	float b    = dot(dir, vary_center);
+	float disc = b*b - dot(vary_center, vary_center) + uRadius*uRadius;
+	if(disc < 0.0)
+		discard;
+
+	float t = b - sqrt(disc);
+	if(t < 0.0) //Camera inside the sphere : we see its inner side
+		t = b + sqrt(disc);
+	if(t < 0.0)
+		discard;
+
+	vec3 hit = t*dir;
+	vec3 position = (uInvView*vec4(hit, 1.0)).xyz;
+	vec3 N = normalize(mat3(uInvView)*((hit - vary_center)/uRadius));
+
+	//Same mapping as Sphere : position = (sin(phi)sin(theta), cos(phi), cos(theta)sin(phi)), uv = (theta/2PI, phi/PI)
+	vec3 n    = uInvRotation*N;
+	float a   = atan(n.x, n.z)/(2.0*PI);
+	float u   = fract(a);
+	float v   = acos(clamp(n.y, -1.0, 1.0))/PI;
+
+	//u jumps from 1 to 0 on the seam, which would select the coarsest mip there : take the derivatives of a u without jump at this place
+	float uSeam = fract(a + 0.5);
+	float dudx  = (abs(dFdx(u)) <= abs(dFdx(uSeam))) ? dFdx(u) : dFdx(uSeam);
+	float dudy  = (abs(dFdy(u)) <= abs(dFdy(uSeam))) ? dFdy(u) : dFdy(uSeam);
+	vec3 color  = textureGrad(uTexture, vec2(u, v), vec2(dudx, dFdx(v)), vec2(dudy, dFdy(v))).rgb;
+
+	vec4 clip    = uProjection*vec4(hit, 1.0);
+	gl_FragDepth = 0.5*clip.z/clip.w + 0.5;
+	gl_FragColor = vec4(phong(color, position, N), 1.0);
+}
@@ -0,0 +1,38 @@
+#version 130
+precision highp float;
+
+//A sphere drawn as one quad (GL_TRIANGLE_STRIP of 4 vertices, no vertex buffer) : the surface is ray-cast in impostor.frag
+
+uniform mat4 uView;       //World to view
+uniform mat4 uProjection;
+uniform vec3 uCenter;     //Center of the sphere in world space
+uniform float uRadius;
+
+varying vec3 vary_viewRay; //Point on the quad in view space. The camera being the origin, it is also the direction of the ray
+varying vec3 vary_center;  //Center of the sphere in view space
+
+void main()
+{
+	vec2 corner = vec2(float(gl_VertexID & 1), float((gl_VertexID >> 1) & 1))*2.0 - 1.0;
+
+	vary_center = (uView*vec4(uCenter, 1.0)).xyz;
+	float dist  = length(vary_center);
+
+	//Close to (or inside) the sphere, or partly behind the camera : cover the whole screen
+	if(dist < 1.5*uRadius || vary_center.z > -uRadius)
+	{
+		vary_viewRay = vec3(corner.x/uProjection[0][0], corner.y/uProjection[1][1], -1.0);
+		gl_Position  = vec4(corner, 0.0, 1.0);
+		return;
+	}
+
+	//Quad in the plane of the center, facing the camera, as large as the silhouette cone at this distance
+	vec3 dir   = vary_center/dist;
+	float size = uRadius*dist/sqrt(dist*dist - uRadius*uRadius);
+	vec3 up    = (abs(dir.y) < 0.99) ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+	vec3 right = normalize(cross(dir, up));
+	up         = cross(right, dir);
+
+	vary_viewRay = vary_center + size*(corner.x*right + corner.y*up);
+	gl_Position  = uProjection*vec4(vary_viewRay, 1.0);
+}
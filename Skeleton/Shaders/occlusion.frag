@@ -0,0 +1,8 @@
+#version 130
+precision mediump float;
+
+//Only the depth test matters here : the color writes are disabled while the proxies are drawn
+void main()
+{
+	gl_FragColor = vec4(1.0);
+}
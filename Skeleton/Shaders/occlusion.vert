@@ -0,0 +1,13 @@
+#version 130
+precision mediump float;
+
+attribute vec3 vPositions;
+
+uniform mat4 uMVP;
+
+invariant gl_Position; //See color.vert
+
+void main()
+{
+	gl_Position = uMVP*vec4(vPositions, 1.0);
+}
@@ -0,0 +1,26 @@
+//Phong lighting shared by the fragment shaders (inserted after their #version line)
+
+uniform vec3 constants; //ka, kd, ks
+uniform float alpha ;
+uniform vec3 lightcolor;
+uniform vec3 lightposition;
+uniform vec3 cameraposition;
+
+vec3 phong(vec3 color, vec3 position, vec3 N)
+{
+	float ka=constants[0];
+	float kd=constants[1];
+	float ks=constants[2];
+
+	vec3 L = normalize(lightposition - position);
+	vec3 R = normalize(reflect(-L,N));
+	vec3 V = normalize(cameraposition-position);
+
+	vec3 Ambiant = ka * color * lightcolor;
+
+	vec3 Diffuse = kd*max(0.0,dot(N,L))*color*lightcolor;
+
+	vec3 Specular = ks*pow(max(0.0,dot(R,V)),alpha)*lightcolor;
+
+	return Ambiant+Diffuse+Specular;
+}
@@ -0,0 +1,95 @@
+#version 430
+
+//Programmable vertex pulling (see VertexPuller) : no vertex buffer, the vertices are read from shader storage and decoded here
+
+//MeshRecord flags
+#define MESH_COMPACT       1u
+#define MESH_UNORM_UV      2u
+#define MESH_INDEXED       4u
+#define MESH_SHORT_INDICES 8u
+
+struct MeshRecord
+{
+	uint positionWord;
+	uint normalWord;
+	uint uvWord;
+	uint indexWord;
+	uint positionStride;
+	uint normalStride;
+	uint uvStride;
+	uint flags;
+};
+
+struct DrawRecord
+{
+	mat4 mvp;
+	mat4 model;
+	mat4 normalMatrix;
+	uint mesh;
+	uint padding[3];
+};
+
+layout(std430, binding = 0) readonly buffer MeshData {uint words[];};
+layout(std430, binding = 1) readonly buffer Meshes   {MeshRecord meshes[];};
+layout(std430, binding = 2) readonly buffer Draws    {DrawRecord draws[];};
+
+layout(location = 3) in uint vDraw; //Instanced : the base instance of the draw, i.e. its record
+
+out vec3 vary_position;
+out vec3 vary_normal;
+out vec2 vary_UV;
+
+vec3 decodeOctahedral(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if(n.z < 0.0)
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(n);
+}
+
+vec3 fetchVec3(uint word)
+{
+	return uintBitsToFloat(uvec3(words[word], words[word+1u], words[word+2u]));
+}
+
+void main()
+{
+	DrawRecord drawRecord = draws[vDraw];
+	MeshRecord mesh       = meshes[drawRecord.mesh];
+
+	//gl_VertexID runs over the index range of the draw
+	uint vertex = uint(gl_VertexID);
+	if((mesh.flags & MESH_INDEXED) != 0u)
+	{
+		if((mesh.flags & MESH_SHORT_INDICES) != 0u)
+			vertex = bitfieldExtract(words[mesh.indexWord + (vertex >> 1)], int(vertex & 1u) * 16, 16);
+		else
+			vertex = words[mesh.indexWord + vertex];
+	}
+
+	uint p = mesh.positionWord + vertex*mesh.positionStride;
+	uint n = mesh.normalWord   + vertex*mesh.normalStride;
+	uint t = mesh.uvWord       + vertex*mesh.uvStride;
+
+	vec3 position;
+	vec3 normal;
+	vec2 uv;
+	if((mesh.flags & MESH_COMPACT) != 0u)
+	{
+		//Half float position (+ padding), octahedral normal in two snorm16, uv in two unorm16 or half floats
+		position = vec3(unpackHalf2x16(words[p]), unpackHalf2x16(words[p+1u]).x);
+		normal   = decodeOctahedral(unpackSnorm2x16(words[n]));
+		uv       = ((mesh.flags & MESH_UNORM_UV) != 0u) ? unpackUnorm2x16(words[t]) : unpackHalf2x16(words[t]);
+	}
+	else
+	{
+		position = fetchVec3(p);
+		normal   = fetchVec3(n);
+		uv       = uintBitsToFloat(uvec2(words[t], words[t+1u]));
+	}
+
+	gl_Position   = drawRecord.mvp * vec4(position, 1.0);
+	vary_normal   = normalize(mat3(drawRecord.normalMatrix) * normal);
+	vary_position = (drawRecord.model * vec4(position, 1.0)).xyz;
+	vary_UV       = uv;
+}
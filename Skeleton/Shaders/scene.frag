@@ -0,0 +1,17 @@
+#version 130
+
+in vec3 vary_normal;
+in vec3 vary_position;
+in vec2 vary_UV;
+flat in float vary_layer; //Layer of the body in the texture array, negative for an untextured body
+
+uniform sampler2DArray uTextures;
+
+//phong() comes from phong.glsl
+
+void main()
+{
+	vec3 color = vary_layer >= 0.0 ? texture(uTextures, vec3(vary_UV, vary_layer)).rgb : vec3(0.0);
+
+	gl_FragColor = vec4(phong(color, vary_position, vary_normal), 1.0);
+}
@@ -0,0 +1,43 @@
+#version 140
+
+//The bodies batched in one multi-draw (see MeshBuffer) : the per draw data is found from the draw ID
+
+in vec3 vPositions;
+in vec3 vNormals;
+in vec2 vUV;
+in uint vDraw;
+
+//DRAW_DATA_TEXELS (11) texels per draw : model to clip space, model matrix, normal matrix (texture layer in the w of its first column)
+uniform samplerBuffer uDrawData;
+uniform int uDrawBase;    //First texel of the draws of this frame
+uniform bool uOctNormals; //The normals are 2 octahedral components (VERTEX_FORMAT_COMPACT)
+
+out vec3 vary_position;
+out vec3 vary_normal;
+out vec2 vary_UV;
+flat out float vary_layer;
+
+vec3 decodeOctahedral(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if(n.z < 0.0)
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(n);
+}
+
+void main()
+{
+	int base = uDrawBase + int(vDraw) * 11;
+	mat4 mvp   = mat4(texelFetch(uDrawData, base),   texelFetch(uDrawData, base+1), texelFetch(uDrawData, base+2), texelFetch(uDrawData, base+3));
+	mat4 model = mat4(texelFetch(uDrawData, base+4), texelFetch(uDrawData, base+5), texelFetch(uDrawData, base+6), texelFetch(uDrawData, base+7));
+	vec4 n0    = texelFetch(uDrawData, base+8);
+	mat3 normalMatrix = mat3(n0.xyz, texelFetch(uDrawData, base+9).xyz, texelFetch(uDrawData, base+10).xyz);
+
+	vec3 normal = uOctNormals ? decodeOctahedral(vNormals.xy) : vNormals;
+
+	gl_Position   = mvp * vec4(vPositions, 1.0);
+	vary_normal   = normalize(normalMatrix * normal);
+	vary_position = (model * vec4(vPositions, 1.0)).xyz;
+	vary_UV       = vUV;
+	vary_layer    = n0.w;
+}
@@ -0,0 +1,29 @@
+#version 130
+precision highp float;
+
+#define PI 3.14159265358979
+
+uniform sampler2D uTexture;
+
+varying vec3 vary_position;
+varying vec3 vary_normal;
+varying vec3 vary_direction;
+
+//phong() comes from phong.glsl
+
+void main()
+{
+	//Same mapping as Sphere, per fragment : the chunks do not carry texture coordinates
+	vec3 n  = normalize(vary_direction);
+	float a = atan(n.x, n.z)/(2.0*PI);
+	float u = fract(a);
+	float v = acos(clamp(n.y, -1.0, 1.0))/PI;
+
+	//u jumps from 1 to 0 on the seam : take the derivatives of a u without jump at this place (see impostor.frag)
+	float uSeam = fract(a + 0.5);
+	float dudx  = (abs(dFdx(u)) <= abs(dFdx(uSeam))) ? dFdx(u) : dFdx(uSeam);
+	float dudy  = (abs(dFdy(u)) <= abs(dFdy(uSeam))) ? dFdy(u) : dFdy(uSeam);
+	vec3 color  = textureGrad(uTexture, vec2(u, v), vec2(dudx, dFdx(v)), vec2(dudy, dFdy(v))).rgb;
+
+	gl_FragColor = vec4(phong(color, vary_position, normalize(vary_normal)), 1.0);
+}
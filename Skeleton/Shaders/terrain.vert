@@ -0,0 +1,53 @@
+#version 130
+precision highp float;
+
+attribute vec2 vPositions; //Position in the grid shared by every node, in [0, 1]
+
+uniform mat4 uMVP;
+uniform mat4 modelmatrix;
+uniform mat3 inv_modelmatrix;
+
+uniform mat3  uFace;     //Cube face : its columns are the u axis, the v axis and the normal
+uniform vec3  uChunk;    //Corner (x, y) and size of the node on its face, in [-1, 1]
+uniform vec2  uMorph;    //Distances (model space) where the morph to the grid of the parent starts and ends
+uniform float uGridSize; //Number of quads along the side of the grid
+uniform vec3  uCamera;   //Camera position in model space
+
+uniform bool      uDisplaced; //The body has a relief
+uniform sampler2D uHeights;   //One texel per vertex of the grid : normal (xyz) and height relative to the radius (w)
+
+varying vec3 vary_position;
+varying vec3 vary_normal;
+varying vec3 vary_direction; //Model space direction of the vertex, for the texture mapping
+
+//Same equal-angle mapping as CubeSphere and PlanetTerrain::faceToSphere
+vec3 faceToSphere(vec2 grid)
+{
+	vec2 face = uChunk.xy + grid*uChunk.z;
+	return normalize(uFace*vec3(tan(0.785398163397*face), 1.0));
+}
+
+void main()
+{
+	//CDLOD morph : towards the end of the range of the node, the odd vertices slide onto the even ones, which form the grid of the parent
+	float morph  = clamp((distance(0.5*faceToSphere(vPositions), uCamera) - uMorph.x) / (uMorph.y - uMorph.x), 0.0, 1.0);
+	vec2  parent = vPositions - fract(vPositions*uGridSize*0.5) * (2.0/uGridSize);
+	vec2  grid   = mix(vPositions, parent, morph);
+
+	vec3 direction = faceToSphere(grid);
+	vec3 normal    = direction;
+	vec3 position  = 0.5*direction;
+	if(uDisplaced)
+	{
+		//The relief morphs with the position : from the texel of the vertex to the one of the even vertex it slides onto
+		vec4 relief = mix(texelFetch(uHeights, ivec2(vPositions*uGridSize + 0.5), 0),
+		                  texelFetch(uHeights, ivec2(parent*uGridSize + 0.5), 0), morph);
+		normal   = relief.xyz;
+		position = position*(1.0 + relief.w);
+	}
+
+	gl_Position    = uMVP*vec4(position, 1.0);
+	vary_normal    = normalize(transpose(inv_modelmatrix)*normal);
+	vary_position  = (modelmatrix*vec4(position, 1.0)).xyz;
+	vary_direction = direction;
+}
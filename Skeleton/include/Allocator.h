@@ -0,0 +1,122 @@
+#ifndef  ALLOCATOR_INC
+#define  ALLOCATOR_INC
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+
+/* \brief Interface of the memory sources the geometries are carved from */
+class Allocator
+{
+    public:
+        virtual ~Allocator(){}
+
+        /* \brief Allocate a block of memory
+         * \param size the size of the block in bytes
+         * \param alignment the alignment of the block (a power of two)
+         * \return the block, or NULL if no memory is left */
+        virtual void* allocate(size_t size, size_t alignment) = 0;
+
+        /* \brief Give back a block obtained with allocate
+         * \param ptr the block (NULL is ignored) */
+        virtual void deallocate(void* ptr) = 0;
+};
+
+/* \brief Aligned blocks on the heap. The default allocator of the geometries */
+class HeapAllocator : public Allocator
+{
+    public:
+        void* allocate(size_t size, size_t alignment);
+        void  deallocate(void* ptr);
+};
+
+/* \brief Where an Arena was at a given moment, to rewind it later */
+struct ArenaMarker
+{
+    size_t chunk;  /*!< The chunk being filled*/
+    size_t offset; /*!< The first free byte in this chunk*/
+};
+
+/* \brief Linear allocator : blocks are carved one after the other from big chunks and only given back all at once (reset or rewind).
+ * deallocate does nothing, so whatever lives in an arena must not outlive its reset. Not thread safe. */
+class Arena : public Allocator
+{
+    public:
+        /* \brief Constructor
+         * \param chunkSize the size of the chunks allocated on the heap. Bigger blocks get a chunk of their own */
+        Arena(size_t chunkSize = 1 << 20);
+
+        /* \brief Destructor. Frees every chunk */
+        ~Arena();
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        void* allocate(size_t size, size_t alignment);
+        void  deallocate(void* ptr) {}
+
+        /* \brief Get the current position of the arena
+         * \return the marker to give to rewind */
+        ArenaMarker getMarker() const {return m_marker;}
+
+        /* \brief Give back everything allocated since the marker was taken. The chunks are kept for the next allocations
+         * \param marker a marker obtained with getMarker */
+        void rewind(const ArenaMarker& marker) {m_marker = marker;}
+
+        /* \brief Give back everything. The chunks are kept for the next allocations */
+        void reset() {m_marker = {0, 0};}
+
+        /* \brief Get how many bytes the arena took from the heap
+         * \return the total size of the chunks */
+        size_t getCapacity() const;
+
+    private:
+        struct Chunk
+        {
+            uint8_t* data;
+            size_t   size;
+        };
+
+        size_t             m_chunkSize;
+        std::vector<Chunk> m_chunks;
+        ArenaMarker        m_marker = {0, 0};
+};
+
+/* \brief Get the allocator used by the geometries created without one
+ * \return the allocator (a HeapAllocator unless changed) */
+Allocator* getDefaultAllocator();
+
+/* \brief Change the allocator used by the geometries created without one
+ * \param allocator the new allocator, or NULL to go back to the heap. It must outlive the geometries created from it */
+void setDefaultAllocator(Allocator* allocator);
+
+/* \brief Get the scratch arena of the calling thread, for the temporaries of the mesh generation.
+ * Use a ScratchScope to give the memory back. Geometries must not be allocated in it : they would not outlive the scopes of the functions building them */
+Arena& getScratchArena();
+
+/* \brief Rewind the scratch arena of the thread to where it was when the scope was opened */
+class ScratchScope
+{
+    public:
+        ScratchScope() : m_arena(getScratchArena()), m_marker(m_arena.getMarker()) {}
+        ~ScratchScope() {m_arena.rewind(m_marker);}
+
+        ScratchScope(const ScratchScope&) = delete;
+        ScratchScope& operator=(const ScratchScope&) = delete;
+
+        /* \brief Get the scratch arena
+         * \return the arena of the thread */
+        Arena& getArena() {return m_arena;}
+
+        /* \brief Allocate an array of T in the scratch arena. It lives until the scope ends
+         * \param count the number of elements
+         * \return the array (not initialized) */
+        template <typename T>
+        T* allocate(size_t count) {return (T*)m_arena.allocate(sizeof(T)*count, alignof(T) < 16 ? 16 : alignof(T));}
+
+    private:
+        Arena&      m_arena;
+        ArenaMarker m_marker;
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef  BENCHMARK_INC
+#define  BENCHMARK_INC
+
+#include "Geometry.h"
+
+/* \brief Shape statistics of the triangles of a sphere geometry */
+struct MeshQuality
+{
+    uint32_t nbTriangles;
+    uint32_t nbVertices;
+    float    minAngle;      /*!< Smallest angle of all the triangles, in degrees*/
+    float    meanQuality;   /*!< Mean of 4*sqrt(3)*area / sum(edge^2) : 1 for an equilateral triangle, 0 for a sliver*/
+    float    areaRatio;     /*!< Largest area / smallest area*/
+    float    maxError;      /*!< Largest distance between a triangle center and the sphere, relative to the radius*/
+};
+
+/* \brief Measure the triangles of a sphere geometry of radius 0.5
+ * \param geometry the geometry (indexed or not)
+ * \return the statistics */
+MeshQuality measureSphereQuality(const Geometry& geometry);
+
+/* \brief Compare Sphere, Icosphere and CubeSphere at equal triangle counts (generation time and triangle shapes), and print the results */
+void benchmarkSphereGenerators();
+
+/* \brief Time Sphere, Cylinder, Cone and Circle at high tessellations, on one worker thread then on all of them, and print the results */
+void benchmarkMeshGenerators();
+
+/* \brief Measure the throughput of the planet relief : one point at a time (scalar), in batches (SIMD) and as tiles over the worker threads, and print the results */
+void benchmarkPlanetNoise();
+
+/* \brief Time the preparation of the batched draws of a belt of nodes (FrameBuilder) on 1, 2, 4... worker threads, and print the results
+ * \param nbNodes the number of spheres of the belt */
+void benchmarkFramePreparation(uint32_t nbNodes);
+
+/* \brief Compare the JobSystem with a thread pool on one locked queue (small jobs, jobs starting jobs, an unbalanced loop),
+ * then print how the jobs of the loop spread over the workers, and print the results */
+void benchmarkJobSystem();
+
+#endif
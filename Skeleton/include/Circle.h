@@ -8,8 +8,9 @@ class Circle : public Geometry
 {
     public:
         /* \brief Create a circle
-         * \param nbEdges the number of edges for this circle */
-        Circle(uint32_t nbEdges);
+         * \param nbEdges the number of edges for this circle
+         * \param allocator where the data is allocated (NULL for the default allocator) */
+        Circle(uint32_t nbEdges, Allocator* allocator = NULL);
 };
 
 #endif
@@ -7,8 +7,11 @@
 class Cone : public Geometry
 {
     public:
-        /* \brief Constructor. Base radius = 1.0. Depth = 1.0. */
-        Cone(uint32_t nbLattitude, float radiusTop);
+        /* \brief Constructor. Base radius = 1.0. Depth = 1.0.
+         * \param nbLattitude the number of lattitude. Minimum : 3
+         * \param radiusTop the radius of the top circle
+         * \param allocator where the data is allocated (NULL for the default allocator) */
+        Cone(uint32_t nbLattitude, float radiusTop, Allocator* allocator = NULL);
 };
 
 #endif
@@ -6,7 +6,9 @@
 class Cube : public Geometry
 {
     public:
-        Cube();
+        /* \brief Constructor. A cube of side 1.0 centered on the origin
+         * \param allocator where the data is allocated (NULL for the default allocator) */
+        Cube(Allocator* allocator = NULL);
 };
 
 #endif
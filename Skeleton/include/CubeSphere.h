@@ -0,0 +1,18 @@
+#ifndef  CUBESPHERE_INC
+#define  CUBESPHERE_INC
+
+#include "SphericalGeometry.h"
+
+/* \brief An indexed sphere (radius 0.5) made by projecting a subdivided cube on the sphere.
+ * The grid of each face is warped (equal-angle mapping) so that the cells keep nearly the same area after the projection */
+class CubeSphere : public SphericalGeometry
+{
+    public:
+        /* \brief Constructor
+         * \param resolution the number of cells along an edge of a face. The sphere has 12*resolution^2 triangles.
+         * Use an even resolution to have a vertex on each pole (the only places where the texture mapping is singular)
+         * \param allocator where the data is allocated (NULL for the default allocator) */
+        CubeSphere(uint32_t resolution, Allocator* allocator = NULL);
+};
+
+#endif
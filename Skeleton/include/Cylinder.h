@@ -9,8 +9,9 @@ class Cylinder : public Geometry
 {
     public:
         /* \brief Constructor
-         * \param nbLattitude the number of lattitude. Minimum : 3 */
-        Cylinder(uint32_t nbLattitude);
+         * \param nbLattitude the number of lattitude. Minimum : 3
+         * \param allocator where the data is allocated (NULL for the default allocator) */
+        Cylinder(uint32_t nbLattitude, Allocator* allocator = NULL);
 };
 
 #endif
@@ -0,0 +1,80 @@
+#ifndef  DRAWCOMMANDBUILDER_INC
+#define  DRAWCOMMANDBUILDER_INC
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <stdint.h>
+#include <vector>
+
+#include "StreamBuffer.h"
+
+/* \brief Where a mesh lives in a MeshBuffer */
+struct MeshRange
+{
+    uint32_t firstIndex; /*!< Offset (in indices) of the first index of the mesh in the index buffer*/
+    uint32_t nbIndices;  /*!< Number of indices of the mesh*/
+    uint32_t baseVertex; /*!< Offset (in vertices) of the first vertex of the mesh : added to each of its indices*/
+    uint32_t nbVertices; /*!< Number of vertices of the mesh*/
+};
+
+/* \brief One draw of glMultiDrawElementsIndirect (the layout is fixed by GL) */
+struct DrawElementsIndirectCommand
+{
+    GLuint count;         /*!< Number of indices*/
+    GLuint instanceCount;
+    GLuint firstIndex;    /*!< Offset (in indices) in the index buffer*/
+    GLint  baseVertex;
+    GLuint baseInstance;  /*!< Here the draw ID : it selects the per draw data*/
+};
+
+/* \brief The draws of a frame, as DrawElementsIndirectCommand, and the indirect buffer they are streamed to (see StreamBuffer).
+ * Each draw gets its ID as base instance : MeshBuffer turns it into a vertex attribute */
+class DrawCommandBuilder
+{
+    public:
+        /* \brief Constructor. The indirect buffer is created by the first upload() */
+        DrawCommandBuilder();
+
+        /* \brief Destructor. Destroy the indirect buffer */
+        ~DrawCommandBuilder();
+
+        DrawCommandBuilder(const DrawCommandBuilder& copy) = delete;
+        DrawCommandBuilder& operator=(const DrawCommandBuilder& copy) = delete;
+
+        /* \brief Forget the draws */
+        void clear() {m_commands.clear();}
+
+        /* \brief Add the draw of a whole mesh
+         * \param mesh the mesh
+         * \param drawID the ID of the draw (its base instance) */
+        void add(const MeshRange& mesh, uint32_t drawID) {add(mesh, 0, mesh.nbIndices, drawID);}
+
+        /* \brief Add the draw of a range of the indices of a mesh (e.g. a level of a LODSphere)
+         * \param mesh the mesh
+         * \param firstIndex the first index of the range, in the indices of the mesh
+         * \param nbIndices the number of indices of the range
+         * \param drawID the ID of the draw (its base instance) */
+        void add(const MeshRange& mesh, uint32_t firstIndex, uint32_t nbIndices, uint32_t drawID);
+
+        /* \brief Make room for draws written in place (e.g. by several threads, see FrameBuilder)
+         * \param nbCommands the number of draws added
+         * \return the first of them. Valid until the next change of the list */
+        DrawElementsIndirectCommand* append(uint32_t nbCommands) {m_commands.resize(m_commands.size() + nbCommands); return m_commands.data() + m_commands.size() - nbCommands;}
+
+        /* \brief Send the draws to the indirect buffer (a GL context must be current). There must be at least one draw
+         * \param offset where the draws start in the indirect buffer
+         * \return the indirect buffer */
+        GLuint upload(GLintptr* offset);
+
+        /* \brief Get the draws
+         * \return the draws, in the order they were added */
+        const std::vector<DrawElementsIndirectCommand>& getCommands() const {return m_commands;}
+
+        uint32_t getNbCommands() const {return m_commands.size();}
+
+    private:
+        std::vector<DrawElementsIndirectCommand> m_commands;
+        StreamBuffer                             m_stream;
+};
+
+#endif
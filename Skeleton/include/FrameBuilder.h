@@ -0,0 +1,91 @@
+#ifndef  FRAMEBUILDER_INC
+#define  FRAMEBUILDER_INC
+
+#include <stdint.h>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "LODSphere.h"
+#include "DrawCommandBuilder.h"
+
+//Nodes per job of the culling pass : each job fills its own list of draws
+#define FRAME_BUILDER_CHUNK_SIZE 2048
+
+//vec4 per draw : mvp, model matrix, normal matrix and texture layer (the layout read by scene.vert)
+#define FRAME_BUILDER_DRAW_TEXELS 11
+
+/* \brief A node of the scene as seen by the FrameBuilder : the same matrices as the scene graph, flattened */
+struct FrameNode
+{
+    int32_t   parent = -1;                       /*!< Index of the parent node (before this one), -1 for a root*/
+    glm::mat4 propagatedMatrix = glm::mat4(1.0f); /*!< Transform passed down to the children*/
+    glm::mat4 localMatrix = glm::mat4(1.0f);      /*!< Transform of this node only*/
+    int32_t   textureLayer = -1;                  /*!< Layer in the texture array of the batched draws (-1 : untextured)*/
+    bool      drawn = true;                       /*!< False for the nodes which only move their children*/
+};
+
+/* \brief Prepares the batched draws of a frame on the worker threads (see parallelFor), for scenes of many spheres of one LODSphere chain.
+ * The GL thread only copies the animated matrices in the nodes, then build() runs the jobs :
+ * the world matrices, one depth of the tree after the other, then culling, level of detail and draw data, in chunks of
+ * FRAME_BUILDER_CHUNK_SIZE nodes each writing its own list of draws. The lists are merged, in node order, in the
+ * DrawCommandBuilder and the draw data given to build(), which the GL thread submits (see MeshBuffer::draw). */
+class FrameBuilder
+{
+    public:
+        /* \brief Constructor
+         * \param lod the levels of the chain
+         * \param mesh where the chain lives in the mesh buffer */
+        FrameBuilder(const LODSphere& lod, const MeshRange& mesh);
+
+        /* \brief Add a node, after its parent
+         * \param node the node
+         * \return its index */
+        uint32_t addNode(const FrameNode& node);
+
+        /* \brief Update the matrices of a node, e.g. from the animation
+         * \param node the index of the node
+         * \param propagatedMatrix its new transform passed down to the children
+         * \param localMatrix its new transform of this node only */
+        void setNode(uint32_t node, const glm::mat4& propagatedMatrix, const glm::mat4& localMatrix);
+
+        /* \brief Prepare the draws of the visible nodes. The lists given are cleared first
+         * \param view the camera to world matrix
+         * \param projection the projection matrix
+         * \param viewportHeight the height of the viewport in pixels (for the levels of detail)
+         * \param commands receives one draw per visible node, its ID being its index
+         * \param drawData receives FRAME_BUILDER_DRAW_TEXELS texels per draw */
+        void build(const glm::mat4& view, const glm::mat4& projection, float viewportHeight, DrawCommandBuilder& commands, std::vector<glm::vec4>& drawData);
+
+        uint32_t getNbNodes() const {return m_nodes.size();}
+
+        /* \brief Set the bias of the levels chosen by the next builds (see LODSphere::selectLevel)
+         * \param bias added to the ideal level, negative values favor coarser levels */
+        void setLodBias(int bias) {m_lodBias = bias;}
+
+        /* \brief Get how many nodes the last build() kept
+         * \return the number of draws */
+        uint32_t getNbDraws() const {return m_nbDraws;}
+
+    private:
+        /* \brief The draws prepared by one job */
+        struct Chunk
+        {
+            std::vector<DrawElementsIndirectCommand> commands;
+            std::vector<glm::vec4>                   drawData;
+            uint32_t                                 firstDraw; /*!< Index of its first draw in the merged list*/
+        };
+
+        const LODSphere&       m_lod;
+        MeshRange              m_mesh;
+        int                    m_lodBias = 0;
+        std::vector<FrameNode> m_nodes;
+        std::vector<uint32_t>  m_depths;      /*!< Depth of each node in the tree*/
+        std::vector<std::vector<uint32_t> > m_depthNodes; /*!< Nodes of each depth*/
+        std::vector<glm::mat4> m_propagated;  /*!< Product of the propagated matrices from the root, per node*/
+        std::vector<glm::mat4> m_world;       /*!< Model matrix of each node*/
+        std::vector<uint32_t>  m_lodLevels;   /*!< Level of each node at the last frame (hysteresis)*/
+        std::vector<Chunk>     m_chunks;
+        uint32_t               m_nbDraws = 0;
+};
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef  FRAMECAPTURE_INC
+#define  FRAMECAPTURE_INC
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <string>
+
+#include "JobSystem.h"
+
+//Pixel buffers the frames are read in : a frame is mapped this many captures after its glReadPixels, once the GPU is long done with it
+#define FRAME_CAPTURE_NB_BUFFERS 3
+
+//Frames read back but not written yet. Past it, capture() helps the workers until they are all written, rather than dropping one
+#define FRAME_CAPTURE_MAX_PENDING 8
+
+/* \brief What the captured frames become */
+enum CaptureFormat
+{
+    CAPTURE_PPM,  /*!< One binary PPM per frame*/
+    CAPTURE_QOI,  /*!< One QOI per frame*/
+    CAPTURE_PNG,  /*!< One PNG per frame*/
+    CAPTURE_PIPE  /*!< Raw RGBA frames, top row first, written in order to the standard input of an encoder process*/
+};
+
+/* \brief Records the frames drawn without stalling the GPU. Each frame is read (glReadPixels) in a pixel buffer object of a ring of
+ * FRAME_CAPTURE_NB_BUFFERS, which is only mapped when its turn comes again. The pixels are then encoded and written by the JobSystem :
+ * the images of a sequence in parallel, the frames of a pipe in order, by one job at a time.
+ * Every frame drawn is captured : the animation advancing one step per frame, the recording does not depend on the time it takes */
+class FrameCapture
+{
+    public:
+        FrameCapture();
+
+        /* \brief Destructor. Stop the capture */
+        ~FrameCapture();
+
+        FrameCapture(const FrameCapture& copy) = delete;
+        FrameCapture& operator=(const FrameCapture& copy) = delete;
+
+        /* \brief Start writing the frames as a sequence of images
+         * \param pattern the path of the images, with a printf conversion of the frame number (e.g. "frames/%05u.qoi").
+         * It must be the only conversion, an integer one, and a % is written %%. The extension tells the format : .ppm, .qoi or .png
+         * \param width the width of the frames
+         * \param height the height of the frames
+         * \return true on success */
+        bool startSequence(const char* pattern, uint32_t width, uint32_t height);
+
+        /* \brief Start writing the frames to the standard input of a process, e.g.
+         * "ffmpeg -f rawvideo -pixel_format rgba -video_size 1000x1000 -framerate 60 -i - video.mp4"
+         * \param command the command line of the process
+         * \param width the width of the frames
+         * \param height the height of the frames
+         * \return true if the process was started */
+        bool startPipe(const char* command, uint32_t width, uint32_t height);
+
+        /* \brief Read the frame drawn in the read framebuffer, from (0, 0). Hands the frame read FRAME_CAPTURE_NB_BUFFERS captures ago to the workers */
+        void capture();
+
+        /* \brief Read back the frames still in the pixel buffers, wait for them all to be written and close the pipe */
+        void stop();
+
+        bool     isCapturing() const {return m_capturing;}
+        uint32_t getNbFrames() const {return m_nbFrames;}
+
+    private:
+        /* \brief A frame on its way to the disk */
+        struct Frame
+        {
+            uint32_t             number;
+            std::vector<uint8_t> pixels; /*!< As read by glReadPixels : bottom row first*/
+        };
+
+        bool start(uint32_t width, uint32_t height);
+
+        /* \brief Map the pixel buffer of a frame, copy it and hand the copy to the workers */
+        void readBack(uint32_t buffer);
+
+        /* \brief Encode and write an image of the sequence. From the workers */
+        void writeImage(Frame* frame);
+
+        /* \brief Write the frames queued for the pipe, in order, until none is left. One job at a time */
+        void writePipe();
+
+        CaptureFormat         m_format = CAPTURE_QOI;
+        std::string           m_pattern;
+        FILE*                 m_pipe = NULL;
+        uint32_t              m_width = 0;
+        uint32_t              m_height = 0;
+        bool                  m_capturing = false;
+
+        GLuint                m_buffers[FRAME_CAPTURE_NB_BUFFERS];
+        bool                  m_filled[FRAME_CAPTURE_NB_BUFFERS];  /*!< The buffer holds a frame not read back yet*/
+        uint32_t              m_numbers[FRAME_CAPTURE_NB_BUFFERS]; /*!< The number of that frame*/
+        uint32_t              m_next = 0;     /*!< The buffer of the next capture*/
+        uint32_t              m_nbFrames = 0; /*!< Frames captured since the start*/
+
+        JobCounter            m_jobs;         /*!< The encoding and writing jobs in flight*/
+        std::atomic<uint32_t> m_nbPending;    /*!< Frames read back, not written yet*/
+        std::atomic<bool>     m_failed;       /*!< A write failed : the next ones are not tried*/
+        std::mutex            m_pipeMutex;
+        std::deque<Frame*>    m_pipeFrames;   /*!< Frames waiting for the pipe*/
+        bool                  m_pipeRunning = false; /*!< A job is writing to the pipe : it takes the new frames too*/
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef  FRAMESTATS_INC
+#define  FRAMESTATS_INC
+
+#include <stdint.h>
+#include <chrono>
+
+/* \brief Where the time of a loop of the application goes */
+enum FrameStage
+{
+    FRAME_STAGE_EVENTS,     /*!< Events, animation and camera*/
+    FRAME_STAGE_SUBMISSION, /*!< Traversal and GL calls, on the CPU*/
+    FRAME_STAGE_GPU,        /*!< The frame on the GPU (GpuTimer), overlapping the other stages*/
+    FRAME_STAGE_PRESENT,    /*!< Upscale and swap*/
+    FRAME_STAGE_PACING,     /*!< Sleeping to keep the frame rate*/
+    FRAME_STAGE_IDLE,       /*!< Blocked waiting for an event, nothing to draw*/
+    FRAME_NB_STAGES
+};
+
+/* \brief Breakdown of the cost of the frames, accumulated until reset(). The loops which draw nothing
+ * (render on demand, hidden window) are counted apart from the frames drawn */
+class FrameStats
+{
+    public:
+        /* \brief Constructor. Starts the period now */
+        FrameStats();
+
+        /* \brief Account time to a stage of the current loop
+         * \param stage the stage
+         * \param ms the time in milliseconds */
+        void add(FrameStage stage, double ms) {m_totalMs[stage] += ms;}
+
+        /* \brief End a loop of the application
+         * \param drawn true if a frame was drawn and presented */
+        void endFrame(bool drawn);
+
+        /* \brief Forget everything and start a new period now */
+        void reset();
+
+        /* \brief Get the time since the last reset
+         * \return the time in milliseconds */
+        double getElapsedMs() const;
+
+        /* \brief Get the mean time of a stage per frame drawn
+         * \param stage the stage
+         * \return the time in milliseconds, 0 if nothing was drawn */
+        double getAverageMs(FrameStage stage) const {return m_nbDrawn ? m_totalMs[stage] / m_nbDrawn : 0.0;}
+
+        double   getTotalMs(FrameStage stage) const {return m_totalMs[stage];}
+        uint32_t getNbLoops() const {return m_nbLoops;}
+        uint32_t getNbDrawn() const {return m_nbDrawn;}
+
+        /* \brief Log the breakdown of the period (INFO) */
+        void report() const;
+
+        static const char* getStageName(FrameStage stage);
+
+    private:
+        std::chrono::steady_clock::time_point m_start;
+        double   m_totalMs[FRAME_NB_STAGES];
+        uint32_t m_nbLoops;
+        uint32_t m_nbDrawn;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef  FRAMEBUFFER_INC
+#define  FRAMEBUFFER_INC
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <stdint.h>
+
+/* \brief An offscreen render target (GL 3.0 framebuffer object) : a GL_RGBA8 color texture and a 24 bits depth renderbuffer.
+ * The frame is drawn in it at any resolution, then blitted (scaled) to the window or read back.
+ * Like GpuTimer, the GL objects are only created on the first resize() */
+class Framebuffer
+{
+    public:
+        /* \brief Constructor. Nothing is created yet */
+        Framebuffer();
+
+        /* \brief Destructor. Destroy the GL objects */
+        ~Framebuffer();
+
+        Framebuffer(const Framebuffer& copy) = delete;
+        Framebuffer& operator=(const Framebuffer& copy) = delete;
+
+        /* \brief Set the size of the attachments. They are only reallocated when the size changes
+         * \param width the width in pixels
+         * \param height the height in pixels
+         * \return true if the framebuffer can be drawn to */
+        bool resize(uint32_t width, uint32_t height);
+
+        /* \brief Draw and read in this framebuffer, on all of it (the viewport is set) */
+        void bind() const;
+
+        /* \brief Draw and read in the framebuffer of the window again
+         * \param width the width of the window, for the viewport
+         * \param height the height of the window */
+        static void bindDefault(uint32_t width, uint32_t height);
+
+        /* \brief Copy the color to another framebuffer, scaled to its size. The other framebuffer stays bound for drawing and reading
+         * \param width the width of the destination
+         * \param height the height of the destination
+         * \param destination the destination framebuffer, 0 for the window
+         * \param filter GL_LINEAR to filter the upscaling, GL_NEAREST to keep the pixels */
+        void blit(uint32_t width, uint32_t height, GLuint destination = 0, GLenum filter = GL_LINEAR) const;
+
+        GLuint   getID() const {return m_id;}
+        GLuint   getColorTexture() const {return m_color;}
+        uint32_t getWidth() const {return m_width;}
+        uint32_t getHeight() const {return m_height;}
+        bool     isComplete() const {return m_complete;}
+
+    private:
+        GLuint   m_id       = 0;
+        GLuint   m_color    = 0;
+        GLuint   m_depth    = 0;
+        uint32_t m_width    = 0;
+        uint32_t m_height   = 0;
+        bool     m_complete = false;
+};
+
+#endif
@@ -3,27 +3,49 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <atomic>
+#include "Allocator.h"
 
-/* \brief Represent a geometry*/
+/* \brief How the vertex data of a geometry is laid out once uploaded (see VertexFormat.h) */
+enum VertexFormat
+{
+    VERTEX_FORMAT_PLANAR,      /*!< Three float planes : positions | normals | uvs. 32 bytes per vertex*/
+    VERTEX_FORMAT_INTERLEAVED, /*!< Floats interleaved per vertex : position, normal, uv. 32 bytes per vertex*/
+    VERTEX_FORMAT_COMPACT      /*!< Interleaved and quantized : half float position, octahedral normal, 16 bits uv. 16 bytes per vertex*/
+};
+
+/* \brief Represent a geometry.
+ * Its vertices and indices live in one aligned block taken from an Allocator. The data is immutable once built :
+ * copies share the block (reference counted), so copying a geometry is O(1)*/
 class Geometry
 {
     public:
-        /* \brief The constructor.*/
-        Geometry();
+        /* \brief The constructor.
+         * \param allocator where the data of the geometry is allocated. NULL for the default allocator (see setDefaultAllocator)*/
+        Geometry(Allocator* allocator = NULL);
 
         /* \brief Move constructor*/
         Geometry(Geometry&& geom);
 
-        /* \brief Copy constructor*/
+        /* \brief Copy constructor. Shares the data of copy*/
         Geometry(const Geometry& copy);
 
-        /* \brief Copy assignment*/
+        /* \brief Copy assignment. Shares the data of geom and releases the previous one*/
         Geometry& operator=(const Geometry& geom);
 
-        /* \brief Destructor. Destroy the data */
+        /* \brief Move assignment. Releases the previous data*/
+        Geometry& operator=(Geometry&& geom);
+
+        /* \brief Destructor. Destroy the data if no other geometry shares it */
         virtual ~Geometry();
 
+        /* \brief Get the allocator the data of this geometry comes from
+         * \return the allocator */
+        Allocator* getAllocator() const {return m_allocator;}
 
+        /* \brief Tell whether other geometries share the data of this one
+         * \return true if the data is shared */
+        bool isShared() const {return m_storage != NULL && m_storage->refCount.load() > 1;}
 
         /* \brief Get the vertices data of the geometry
          * \return const array on the vertices data. Use getNbVertices to get how many vertices the array contains (size(array) == 3*nbVertices) */
@@ -41,11 +63,51 @@ class Geometry
          * \return the number of vertices this geometry contains*/
         uint32_t getNbVertices() const {return m_nbVertices;}
 
+        /* \brief Get the indices of the triangles of the geometry
+         * \return const array on the indices (3 per triangle), or NULL if the geometry is not indexed (one vertex per triangle corner) */
+        const uint32_t* getIndices() const {return m_indices;}
+
+        /* \brief Get how many indices this geometry contains
+         * \return the number of indices, 0 if the geometry is not indexed*/
+        uint32_t getNbIndices() const {return m_nbIndices;}
+
+        /* \brief Choose how the vertices will be laid out in the GPU buffers
+         * \param format the vertex format */
+        void setVertexFormat(VertexFormat format) {m_vertexFormat = format;}
+
+        /* \brief Get how the vertices will be laid out in the GPU buffers
+         * \return the vertex format (VERTEX_FORMAT_PLANAR by default) */
+        VertexFormat getVertexFormat() const {return m_vertexFormat;}
+
     protected: 
-        uint32_t m_nbVertices = 0;
-        float*   m_vertices   = NULL;
-        float*   m_normals    = NULL;
-        float*   m_uvs        = NULL;
+        friend class MeshOptimizer;
+
+        /* \brief Replace the data by a new block, not initialized. Only meant for the constructors of the geometries
+         * \param nbVertices the number of vertices (positions, normals and uvs)
+         * \param nbIndices the number of indices (0 for a non indexed geometry) */
+        void allocate(uint32_t nbVertices, uint32_t nbIndices);
+
+        uint32_t  m_nbVertices = 0;
+        float*    m_vertices   = NULL;
+        float*    m_normals    = NULL;
+        float*    m_uvs        = NULL;
+        uint32_t  m_nbIndices  = 0;
+        uint32_t* m_indices    = NULL;
+        VertexFormat m_vertexFormat = VERTEX_FORMAT_PLANAR;
+
+    private:
+        /* \brief Header of the block, followed by the arrays */
+        struct Storage
+        {
+            std::atomic<uint32_t> refCount;
+            Allocator*            allocator;
+        };
+
+        /* \brief Drop the reference on the data, destroying it if it was the last one */
+        void release();
+
+        Allocator* m_allocator = NULL;
+        Storage*   m_storage   = NULL;
 };
 
 #endif
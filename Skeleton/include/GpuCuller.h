@@ -0,0 +1,134 @@
+#ifndef  GPUCULLER_INC
+#define  GPUCULLER_INC
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <stdint.h>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+#include "MeshBuffer.h"
+#include "LODSphere.h"
+#include "StreamBuffer.h"
+
+//Levels of detail the culling shader can choose from (size of uResolutions in cull.comp)
+#define GPU_CULLER_MAX_LEVELS 8
+
+//Shader storage binding points (as declared in cull.comp and gpudriven.vert)
+#define GPU_CULLER_BODIES_BINDING    0
+#define GPU_CULLER_LEVELS_BINDING    1
+#define GPU_CULLER_COMMANDS_BINDING  2
+#define GPU_CULLER_INSTANCES_BINDING 3
+
+//Location of the body index attribute (the draw ID of the other batched paths, see MeshBuffer)
+#define GPU_CULLER_BODY_LOCATION 3
+
+//Work group sizes of cull.comp and hiz.comp
+#define GPU_CULLER_GROUP_SIZE 64
+#define GPU_CULLER_HIZ_GROUP  8
+
+/* \brief GPU driven drawing of many spheres of a LODSphere chain (GL 4.3 : compute shaders and multi-draw indirect).
+ * Every body is a record (model matrix, normal matrix, texture layer) in a shader storage buffer, uploaded only when it changes.
+ * Each frame cull.comp tests every body against the frustum and against the depth of the previous frame (hierarchical Z),
+ * picks the level of the survivors as LODSphere::selectLevel does, and appends them to the instances of that level :
+ * one DrawElementsIndirectCommand per level, its instance count incremented atomically.
+ * The CPU never reads anything back : draw() is a single glMultiDrawElementsIndirect, whatever the number of visible bodies. */
+class GpuCuller
+{
+    public:
+        /* \brief Constructor. Allocate the buffers and the depth pyramid (a GL context must be current)
+         * \param cullShader the culling compute shader (cull.comp)
+         * \param hizShader the depth pyramid compute shader (hiz.comp)
+         * \param meshes the mesh buffer holding the chain
+         * \param mesh the handle of the chain in the mesh buffer
+         * \param lod the levels of the chain (at most GPU_CULLER_MAX_LEVELS)
+         * \param maxBodies the capacity in bodies
+         * \param width the width of the framebuffer whose depth is read back
+         * \param height the height of the framebuffer whose depth is read back */
+        GpuCuller(Shader* cullShader, Shader* hizShader, const MeshBuffer& meshes, uint32_t mesh, const LODSphere& lod, uint32_t maxBodies, uint32_t width, uint32_t height);
+
+        /* \brief Destructor. Destroy the buffers and textures */
+        ~GpuCuller();
+
+        GpuCuller(const GpuCuller& copy) = delete;
+        GpuCuller& operator=(const GpuCuller& copy) = delete;
+
+        /* \brief Add a body
+         * \param model its model matrix (the unit sphere of the chain to world space)
+         * \param layer its texture layer (-1 : untextured)
+         * \return its handle, or -1 if the culler is full */
+        int addBody(const glm::mat4& model, int layer);
+
+        /* \brief Move a body. Only the bodies changed since the last cull() are uploaded
+         * \param body the handle of the body
+         * \param model its new model matrix */
+        void setBody(uint32_t body, const glm::mat4& model);
+
+        /* \brief Cull the bodies and fill the draw commands, on the GPU
+         * \param viewMatrix the world to camera matrix
+         * \param projection the projection matrix
+         * \param viewportHeight the height of the viewport in pixels, for the levels of detail. 0 for the height given to the constructor */
+        void cull(const glm::mat4& viewMatrix, const glm::mat4& projection, uint32_t viewportHeight = 0);
+
+        /* \brief Draw the bodies kept by the last cull(). The shader (gpudriven.vert) must be in use with its uniforms set
+         * \param mode the primitive type */
+        void draw(GLenum mode = GL_TRIANGLES);
+
+        /* \brief Read back the depth of the frame from the read framebuffer and build its pyramid, for the occlusion test of the next cull().
+         * Call it once the frame is fully drawn */
+        void updateDepth();
+
+        /* \brief Forget the depth read back : the next cull() tests the frustum only, until updateDepth() is called again.
+         * For the frames whose depth is not of the size given to the constructor */
+        void invalidateDepth() {m_hasDepth = false;}
+
+        /* \brief Enable or disable the occlusion test (the frustum test is always done)
+         * \param enabled true to test the bodies against the depth of the previous frame */
+        void setOcclusionEnabled(bool enabled) {m_occlusion = enabled;}
+        bool isOcclusionEnabled() const {return m_occlusion;}
+
+        uint32_t getNbBodies() const {return m_bodies.size();}
+
+        /* \brief Tell if the context can cull on the GPU (GL 4.3)
+         * \return true if it can */
+        static bool isSupported();
+
+    private:
+        /* \brief A body as read by cull.comp and gpudriven.vert (std430) */
+        struct BodyRecord
+        {
+            glm::mat4 model;
+            glm::vec4 normalMatrix[3]; /*!< Columns of the normal matrix, the texture layer in the w of the first one*/
+        };
+
+        Shader*   m_cullShader;
+        Shader*   m_hizShader;
+        uint32_t  m_maxBodies;
+        uint32_t  m_width;
+        uint32_t  m_height;
+        uint32_t  m_nbLevels;
+        float     m_resolutions[GPU_CULLER_MAX_LEVELS];
+        std::vector<DrawElementsIndirectCommand> m_resetCommands; /*!< One command per level, with no instance*/
+
+        std::vector<BodyRecord> m_bodies;
+        StreamBuffer m_staging;     /*!< The changed bodies and the reset commands, on their way to their buffers*/
+        uint32_t  m_dirtyBegin = 0; /*!< Range of bodies to upload at the next cull()*/
+        uint32_t  m_dirtyEnd   = 0;
+
+        bool      m_occlusion = true;
+        bool      m_hasDepth  = false;      /*!< False until a first depth was read back*/
+        glm::mat4 m_viewProjection;         /*!< The one of the last cull()...*/
+        glm::mat4 m_depthViewProjection;    /*!< ...and the one of the depth in the pyramid*/
+        uint32_t  m_nbHiZLevels;
+
+        GLuint    m_VAO = 0;
+        GLuint    m_bodyBuffer = 0;
+        GLuint    m_levelBuffer = 0;
+        GLuint    m_commandBuffer = 0;
+        GLuint    m_instanceBuffer = 0;
+        GLuint    m_depthTexture = 0;
+        GLuint    m_hizTexture = 0;
+};
+
+#endif
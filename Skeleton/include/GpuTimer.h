@@ -0,0 +1,70 @@
+#ifndef  GPUTIMER_INC
+#define  GPUTIMER_INC
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <stdint.h>
+
+//Queries in flight : a result is read back this many measures after it was issued, when the GPU is done with it
+#define GPU_TIMER_NB_QUERIES 4
+
+/* \brief Time spent by the GPU on a sequence of commands (GL_TIME_ELAPSED queries, GL 3.3 or ARB_timer_query).
+ * Like the occlusion queries, the results are only read once available, so the CPU never waits on them (except in finish()).
+ * The measures are accumulated until reset(). When the context has no timer query, nothing is measured. */
+class GpuTimer
+{
+    public:
+        /* \brief Constructor. The GL queries are created lazily the first time they are used */
+        GpuTimer();
+
+        /* \brief Destructor. Destroy the GL queries */
+        ~GpuTimer();
+
+        GpuTimer(const GpuTimer& copy) = delete;
+        GpuTimer& operator=(const GpuTimer& copy) = delete;
+
+        /* \brief Start timing the next commands. Collects the results which came back meanwhile. Measures cannot be nested */
+        void begin();
+
+        /* \brief Stop timing */
+        void end();
+
+        /* \brief Wait for every measure in flight and collect it */
+        void finish();
+
+        /* \brief Forget the measures collected so far */
+        void reset();
+
+        /* \brief Get the number of measures collected since the last reset
+         * \return the number of measures */
+        uint32_t getNbMeasures() const {return m_nbMeasures;}
+
+        /* \brief Get the mean of the measures collected since the last reset
+         * \return the mean time in milliseconds, 0 if nothing was measured */
+        double getAverageMs() const {return m_nbMeasures ? m_totalMs / m_nbMeasures : 0.0;}
+
+        /* \brief Get the last measure collected
+         * \return the time in milliseconds, 0 if nothing was measured */
+        double getLastMs() const {return m_lastMs;}
+
+        /* \brief Tell if the context has timer queries
+         * \return true if the timer measures something */
+        static bool isSupported();
+
+    private:
+        /* \brief Collect the result of a query in flight
+         * \param wait wait for the GPU if the result is not there yet
+         * \return true if the result was collected */
+        bool collect(uint32_t query, bool wait);
+
+        GLuint   m_ids[GPU_TIMER_NB_QUERIES];
+        bool     m_pending[GPU_TIMER_NB_QUERIES];
+        uint32_t m_next       = 0;     /*!< Query used by the next measure*/
+        bool     m_created    = false;
+        bool     m_running    = false;
+        uint32_t m_nbMeasures = 0;
+        double   m_totalMs    = 0.0;
+        double   m_lastMs     = 0.0;
+};
+
+#endif
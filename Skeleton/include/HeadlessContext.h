@@ -0,0 +1,46 @@
+#ifndef  HEADLESSCONTEXT_INC
+#define  HEADLESSCONTEXT_INC
+
+#include <stdlib.h>
+#include <stdint.h>
+
+/* \brief An OpenGL context without any window nor display, through EGL : the headless backend (--headless).
+ * It tries EGL_MESA_platform_surfaceless first (no display server, no GPU needed with llvmpipe) with a context bound to no surface,
+ * then the default display with a 1x1 pbuffer. Either way nothing can be presented : the frames are drawn in Framebuffer objects.
+ * Only available when built with EGL (HAVE_EGL, see CMakeLists.txt) */
+class HeadlessContext
+{
+    public:
+        HeadlessContext();
+
+        /* \brief Destructor. Destroy the context if it was created */
+        ~HeadlessContext();
+
+        HeadlessContext(const HeadlessContext& copy) = delete;
+        HeadlessContext& operator=(const HeadlessContext& copy) = delete;
+
+        /* \brief Create a compatibility profile context of at least the given version and make it current
+         * \param major the major OpenGL version
+         * \param minor the minor OpenGL version
+         * \return true on success */
+        bool create(int major, int minor);
+
+        /* \brief Destroy the context and release the display */
+        void destroy();
+
+        /* \brief Tell if the context is bound to no surface at all (else to a pbuffer)
+         * \return true for a surfaceless context */
+        bool isSurfaceless() const {return m_surfaceless;}
+
+        /* \brief Tell if the program was built with the headless backend
+         * \return true if create() can work */
+        static bool isSupported();
+
+    private:
+        void* m_display     = NULL; /*!< EGLDisplay*/
+        void* m_context     = NULL; /*!< EGLContext*/
+        void* m_surface     = NULL; /*!< EGLSurface, the pbuffer, or NULL*/
+        bool  m_surfaceless = false;
+};
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef  ICOSPHERE_INC
+#define  ICOSPHERE_INC
+
+#include "SphericalGeometry.h"
+
+/* \brief An indexed sphere (radius 0.5) made by subdividing an icosahedron : nearly equilateral triangles of nearly equal areas.
+ * The icosahedron has a vertex on each pole so that the texture mapping is only singular there */
+class Icosphere : public SphericalGeometry
+{
+    public:
+        /* \brief Constructor
+         * \param nbSubdivisions how many times each triangle is split in 4. The sphere has 20*4^nbSubdivisions triangles
+         * \param allocator where the data is allocated (NULL for the default allocator) */
+        Icosphere(uint32_t nbSubdivisions, Allocator* allocator = NULL);
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef  IMAGEWRITER_INC
+#define  IMAGEWRITER_INC
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <mutex>
+
+/* \brief Write an image as a binary PPM (P6) : 8 bits RGB, the alpha is dropped
+ * \param path the path of the file
+ * \param width the width in pixels
+ * \param height the height in pixels
+ * \param rgba the pixels, 4 bytes each, row after row
+ * \param bottomUp true if the first row is the bottom of the image, as glReadPixels returns it
+ * \return true on success */
+bool writePPM(const char* path, uint32_t width, uint32_t height, const uint8_t* rgba, bool bottomUp);
+
+/* \brief Write an image as a QOI (the "Quite OK Image" format, https://qoiformat.org) : lossless, about as small as a PNG
+ * for a fraction of its encoding time
+ * \param path the path of the file
+ * \param width the width in pixels
+ * \param height the height in pixels
+ * \param rgba the pixels, 4 bytes each, row after row
+ * \param bottomUp true if the first row is the bottom of the image
+ * \return true on success */
+bool writeQOI(const char* path, uint32_t width, uint32_t height, const uint8_t* rgba, bool bottomUp);
+
+/* \brief Write an image as a PNG, through SDL2_image
+ * \param path the path of the file
+ * \param width the width in pixels
+ * \param height the height in pixels
+ * \param rgba the pixels, 4 bytes each, row after row
+ * \param bottomUp true if the first row is the bottom of the image
+ * \return true on success */
+bool writePNG(const char* path, uint32_t width, uint32_t height, const uint8_t* rgba, bool bottomUp);
+
+/* \brief A binary PPM (P6) written a block at a time, in any order : the image is never in memory as a whole, e.g. a poster
+ * rendered in tiles. Its size is known from the start, so each block goes straight to its rows in the file.
+ * The blocks may be written by several threads at once : they are converted in parallel, only the writes to the file are serialized */
+class PPMStream
+{
+    public:
+        PPMStream();
+
+        /* \brief Destructor. Close the file */
+        ~PPMStream();
+
+        PPMStream(const PPMStream& copy) = delete;
+        PPMStream& operator=(const PPMStream& copy) = delete;
+
+        /* \brief Create the file and write its header
+         * \param path the path of the file
+         * \param width the width of the whole image in pixels
+         * \param height the height of the whole image in pixels
+         * \return true on success */
+        bool open(const char* path, uint32_t width, uint32_t height);
+
+        /* \brief Write a block of the image. Thread safe
+         * \param x the left column of the block in the image
+         * \param y the top row of the block in the image
+         * \param width the width of the block
+         * \param height the height of the block
+         * \param rgba its pixels, 4 bytes each, row after row. The alpha is dropped
+         * \param bottomUp true if the first row is the bottom of the block, as glReadPixels returns it
+         * \return true on success */
+        bool writeBlock(uint32_t x, uint32_t y, uint32_t width, uint32_t height, const uint8_t* rgba, bool bottomUp);
+
+        /* \brief Close the file, once every block is written
+         * \return true if every write succeeded */
+        bool close();
+
+        bool isOpen() const {return m_file != NULL;}
+
+    private:
+        FILE*       m_file;
+        uint32_t    m_width;
+        uint32_t    m_height;
+        uint64_t    m_headerSize;
+        bool        m_failed;
+        std::mutex  m_mutex;
+};
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef  JOBSYSTEM_INC
+#define  JOBSYSTEM_INC
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+//Jobs a worker can hold in its deque (a power of two). Past it, run() does the job right away
+#define JOB_QUEUE_CAPACITY 4096
+
+//parallelFor cuts its range in about this many pieces per worker, so that the stealing can even out unbalanced loops
+#define JOB_PIECES_PER_WORKER 8
+
+//Tries to find a job before a worker goes to sleep
+#define JOB_SPIN_COUNT 64
+
+typedef std::function<void()> JobFunction;
+
+/* \brief What the profiler hook is told about every job */
+struct JobEvent
+{
+    const char* name;    /*!< The name given with the job, or NULL*/
+    uint32_t    worker;  /*!< The worker which ran it (0 : the thread which created the JobSystem). JOB_EXTERNAL_WORKER for other threads*/
+    uint64_t    beginNs; /*!< When it started, in nanoseconds of the steady clock*/
+    uint64_t    endNs;   /*!< When it ended*/
+};
+
+//Worker index of the threads which are not part of the JobSystem
+#define JOB_EXTERNAL_WORKER 0xffffffff
+
+/* \brief Called after every job, from the thread which ran it : it must be thread safe */
+typedef std::function<void(const JobEvent& event)> JobProfilerHook;
+
+class JobSystem;
+
+/* \brief Counts the unfinished jobs of a group. JobSystem::wait() on it runs other jobs meanwhile,
+ * and jobs can be started once it reaches zero (JobSystem::runAfter). It can be reused, or destroyed, once wait() returned */
+class JobCounter
+{
+    public:
+        JobCounter() : m_count(0) {}
+
+        JobCounter(const JobCounter& copy) = delete;
+        JobCounter& operator=(const JobCounter& copy) = delete;
+
+        /* \brief Tell if every job of the group is done
+         * \return true if it is */
+        bool isDone() const {return m_count.load(std::memory_order_acquire) == 0;}
+
+    private:
+        friend class JobSystem;
+        struct Job;
+
+        std::atomic<uint32_t> m_count;
+        mutable std::mutex    m_mutex;         /*!< Protects m_continuations, and the zero crossing seen by them*/
+        std::vector<Job*>     m_continuations; /*!< Jobs waiting for the counter to reach zero*/
+};
+
+/* \brief Work-stealing job scheduler. Every subsystem fans its work out here rather than starting threads of its own.
+ * The thread which creates it is the worker 0, nbWorkers-1 threads are started for the others.
+ * Each worker has a Chase-Lev deque (Chase and Lev, "Dynamic Circular Work-Stealing Deque", with the memory orders of
+ * Lê et al., "Correct and Efficient Work-Stealing for Weak Memory Models") : its owner pushes and pops jobs at the bottom
+ * without any lock, the idle workers steal the oldest jobs, at the top. Other threads push in a locked queue of their own.
+ * A thread waiting for a JobCounter runs jobs until the counter is done, so jobs can start and wait for jobs.
+ * With a single worker no thread is started and every job runs at once, on the thread which starts it. */
+class JobSystem
+{
+    public:
+        /* \brief Constructor. Start the worker threads
+         * \param nbWorkers the number of workers, the calling thread included. 0 for the number of hardware threads
+         * \param pinThreads true to pin every worker to a core : the calling thread (the GL thread) to the core 0, the worker i to the core i */
+        JobSystem(uint32_t nbWorkers = 0, bool pinThreads = false);
+
+        /* \brief Destructor. Wait for the jobs left and stop the threads. Must run on the thread which created the system */
+        ~JobSystem();
+
+        JobSystem(const JobSystem& copy) = delete;
+        JobSystem& operator=(const JobSystem& copy) = delete;
+
+        /* \brief Start a job
+         * \param function the job
+         * \param counter incremented now, decremented once the job is done. Can be NULL
+         * \param name the name given to the profiler hook (a literal), or NULL */
+        void run(const JobFunction& function, JobCounter* counter = NULL, const char* name = NULL);
+
+        /* \brief Start a job once every job of a group is done
+         * \param dependency the group to wait for. It must not be destroyed before the job starts
+         * \param function the job
+         * \param counter incremented now, decremented once the job is done. Can be NULL
+         * \param name the name given to the profiler hook, or NULL */
+        void runAfter(JobCounter& dependency, const JobFunction& function, JobCounter* counter = NULL, const char* name = NULL);
+
+        /* \brief Run jobs until every job of a group is done
+         * \param counter the group */
+        void wait(const JobCounter& counter);
+
+        /* \brief Run a loop over the workers and wait for it. The range is split in pieces of at least minGrain indices,
+         * about JOB_PIECES_PER_WORKER per worker : each piece splits its upper half off as a new job, to be stolen, until it is small enough
+         * \param begin the first index
+         * \param end the index after the last one
+         * \param minGrain the smallest number of indices worth a job
+         * \param body called with [first, last) for each piece, from any worker
+         * \param name the name of the pieces for the profiler hook, or NULL */
+        void parallelFor(uint32_t begin, uint32_t end, uint32_t minGrain, const std::function<void(uint32_t first, uint32_t last)>& body, const char* name = NULL);
+
+        uint32_t getNbWorkers() const {return m_queues.size();}
+        bool     isPinned() const {return m_pinned;}
+
+        /* \brief Set the function called after every job. Only while no job runs
+         * \param hook the hook, or an empty function to remove it */
+        void setProfilerHook(const JobProfilerHook& hook) {m_profilerHook = hook;}
+
+        /* \brief Get the job system shared by the whole program, created with the hardware threads on first use
+         * \return the shared job system */
+        static JobSystem& getShared();
+
+        /* \brief Replace the shared job system. Only while no job runs, from the thread which will be its worker 0
+         * \param nbWorkers the number of workers, the calling thread included. 0 for the number of hardware threads
+         * \param pinThreads true to pin the workers to the cores (see the constructor) */
+        static void resetShared(uint32_t nbWorkers, bool pinThreads);
+
+    private:
+        typedef JobCounter::Job Job;
+
+        /* \brief Chase-Lev deque of a fixed capacity. push and pop are for its worker only, steal for any thread */
+        class WorkQueue
+        {
+            public:
+                WorkQueue() : m_top(0), m_bottom(0), m_jobs(JOB_QUEUE_CAPACITY) {}
+
+                bool push(Job* job);
+                Job* pop();
+                Job* steal();
+
+            private:
+                std::atomic<int64_t> m_top;       /*!< Next job to steal*/
+                char                 m_padding[64]; /*!< Keeps the thieves off the cache line of the owner*/
+                std::atomic<int64_t> m_bottom;    /*!< Next free slot*/
+                std::vector<std::atomic<Job*> > m_jobs;
+        };
+
+        /* \brief Give a job to the workers, or run it if no queue can take it */
+        void schedule(Job* job);
+
+        /* \brief Run a job, then release its counter and the jobs which waited for it */
+        void execute(Job* job, uint32_t worker);
+
+        /* \brief Take a job : from the own deque first, then from the external queue, then from the other workers
+         * \param worker the worker looking for a job, or JOB_EXTERNAL_WORKER */
+        Job* findJob(uint32_t worker);
+
+        /* \brief Get the worker index of the calling thread, JOB_EXTERNAL_WORKER if it is not one of this system */
+        uint32_t getWorker() const;
+
+        /* \brief The loop of the worker threads */
+        void workerLoop(uint32_t worker);
+
+        /* \brief Pin the calling thread to a core */
+        static void pinToCore(uint32_t core);
+
+        std::vector<WorkQueue*>  m_queues;   /*!< One per worker*/
+        std::vector<std::thread> m_threads;  /*!< The workers 1 and up*/
+        std::thread::id          m_owner;    /*!< The worker 0*/
+        bool                     m_pinned;
+
+        std::mutex               m_externalMutex;
+        std::deque<Job*>         m_external; /*!< The jobs started by the threads which are not workers*/
+        std::atomic<uint32_t>    m_nbExternal; /*!< Its size, checked without the lock*/
+
+        std::atomic<uint32_t>    m_nbQueued;   /*!< Jobs waiting in the queues, to wake the sleeping workers up*/
+        std::atomic<uint32_t>    m_nbSleeping; /*!< Workers waiting on m_wakeCondition*/
+        std::mutex               m_sleepMutex;
+        std::condition_variable  m_wakeCondition;
+        std::atomic<bool>        m_quit;
+
+        JobProfilerHook          m_profilerHook;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef  LODSPHERE_INC
+#define  LODSPHERE_INC
+
+#include "Geometry.h"
+#include <vector>
+#include <glm/glm.hpp>
+
+//Wanted length in pixels of a triangle edge along the silhouette
+#define LOD_TARGET_EDGE_PX 8.0f
+//Relative margin to cross before switching level
+#define LOD_HYSTERESIS     0.2f
+
+/* \brief The index range of one level of detail inside the LODSphere buffers */
+struct LODRange
+{
+    uint32_t firstIndex; /*!< Offset (in indices) of the level in the index array*/
+    uint32_t nbIndices;  /*!< Number of indices of the level*/
+    uint32_t resolution; /*!< Number of latitudes (= longitudes) of the level*/
+};
+
+/* \brief A chain of UV spheres of increasing resolution, stored in one vertex and one index array.
+ * The indices of each level are already offset to its vertices, so a level is drawn with a single glDrawElements on its range.
+ * Each level is reordered by the MeshOptimizer before being merged. */
+class LODSphere : public Geometry
+{
+    public:
+        /* \brief Constructor. Resolutions double from minResolution up to maxResolution
+         * \param minResolution the latitudes/longitudes of the coarsest level (minimum : 3)
+         * \param maxResolution the latitudes/longitudes of the finest level
+         * \param cacheDir the directory where the MeshOptimizer keeps its results (NULL to optimize at each run)
+         * \param withData if false, only the level ranges are computed (the buffers come from somewhere else, e.g. a MeshCache) */
+        LODSphere(uint32_t minResolution = 8, uint32_t maxResolution = 256, const char* cacheDir = NULL, bool withData = true);
+
+        /* \brief Get how many levels this chain contains
+         * \return the number of levels */
+        uint32_t getNbLevels() const {return m_levels.size();}
+
+        /* \brief Get the index range of a level. Level 0 is the coarsest
+         * \param level the level
+         * \return the range of the level */
+        const LODRange& getLevel(uint32_t level) const {return m_levels[level];}
+
+        /* \brief Choose the level to draw a sphere with, with hysteresis around the level boundaries to avoid popping
+         * \param screenRadius the projected radius of the sphere in pixels
+         * \param currentLevel the level the sphere was drawn with the previous frame
+         * \param bias added to the ideal level (negative values favor coarser levels)
+         * \return the level to use this frame */
+        uint32_t selectLevel(float screenRadius, uint32_t currentLevel, int bias = 0) const;
+
+        /* \brief Compute the projected radius in pixels of a sphere of this chain
+         * \param modelMatrix the model matrix of the sphere
+         * \param cameraPosition the camera position in world space
+         * \param projection the projection matrix
+         * \param viewportHeight the height of the viewport in pixels
+         * \return the radius on screen in pixels. Huge if the camera is inside the sphere */
+        static float computeScreenRadius(const glm::mat4& modelMatrix, const glm::vec3& cameraPosition, const glm::mat4& projection, float viewportHeight);
+
+    private:
+        std::vector<LODRange> m_levels;
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef  LRUCACHE_INC
+#define  LRUCACHE_INC
+
+#include <stdlib.h>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+/* \brief Map of bounded size : inserting into a full cache evicts the least recently used entry. Not thread safe */
+template <typename Key, typename Value>
+class LRUCache
+{
+    public:
+        typedef std::list<std::pair<Key, Value> > EntryList;
+
+        /* \brief Constructor
+         * \param capacity the maximum number of entries */
+        LRUCache(size_t capacity) : m_capacity(capacity) {}
+
+        LRUCache(const LRUCache& copy) = delete;
+        LRUCache& operator=(const LRUCache& copy) = delete;
+
+        /* \brief Look for an entry, and mark it as the most recently used
+         * \param key the key of the entry
+         * \return the value, or NULL if the key is not in the cache */
+        Value* find(const Key& key)
+        {
+            typename std::unordered_map<Key, typename EntryList::iterator>::iterator it = m_index.find(key);
+            if(it == m_index.end())
+                return NULL;
+            m_entries.splice(m_entries.begin(), m_entries, it->second);
+            return &it->second->second;
+        }
+
+        /* \brief Check if an entry is in the cache, without touching its age
+         * \param key the key of the entry
+         * \return true if it is there */
+        bool contains(const Key& key) const {return m_index.count(key) != 0;}
+
+        /* \brief Add an entry as the most recently used. The key must not be in the cache yet
+         * \param key the key of the entry
+         * \param value the value of the entry
+         * \param evicted if not NULL, receives the value of the entry removed to make room
+         * \return true if an entry was removed to make room */
+        bool insert(const Key& key, const Value& value, Value* evicted = NULL)
+        {
+            m_entries.push_front(std::make_pair(key, value));
+            m_index[key] = m_entries.begin();
+            if(m_entries.size() <= m_capacity)
+                return false;
+
+            if(evicted)
+                *evicted = m_entries.back().second;
+            m_index.erase(m_entries.back().first);
+            m_entries.pop_back();
+            return true;
+        }
+
+        /* \brief Get the entries, from the most to the least recently used
+         * \return the entries */
+        const EntryList& getEntries() const {return m_entries;}
+
+        size_t getSize() const {return m_entries.size();}
+        size_t getCapacity() const {return m_capacity;}
+
+    private:
+        size_t                                                  m_capacity;
+        EntryList                                               m_entries;  /*!< Most recently used first*/
+        std::unordered_map<Key, typename EntryList::iterator>   m_index;
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef  MAPPEDFILE_INC
+#define  MAPPEDFILE_INC
+
+#include <stdlib.h>
+#include <stdint.h>
+
+/* \brief A whole file mapped read only in memory. The pages are loaded by the OS when first touched */
+class MappedFile
+{
+    public:
+        /* \brief Constructor. Nothing is mapped */
+        MappedFile();
+
+        /* \brief Destructor. Unmap the file */
+        ~MappedFile();
+
+        MappedFile(const MappedFile& copy) = delete;
+        MappedFile& operator=(const MappedFile& copy) = delete;
+
+        /* \brief Map a file, unmapping the previous one
+         * \param path the path of the file
+         * \return true on success. Empty or missing files fail */
+        bool open(const char* path);
+
+        /* \brief Unmap the file */
+        void close();
+
+        /* \brief Get the content of the file
+         * \return the first byte of the file, NULL if nothing is mapped */
+        const uint8_t* getData() const {return m_data;}
+
+        /* \brief Get the size of the file
+         * \return the size in bytes */
+        size_t getSize() const {return m_size;}
+
+    private:
+        const uint8_t* m_data = NULL;
+        size_t         m_size = 0;
+#ifdef _WIN32
+        void*          m_file    = NULL;
+        void*          m_mapping = NULL;
+#endif
+};
+
+#endif
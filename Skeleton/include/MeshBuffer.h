@@ -0,0 +1,95 @@
+#ifndef  MESHBUFFER_INC
+#define  MESHBUFFER_INC
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <stdint.h>
+#include <vector>
+
+#include "Geometry.h"
+#include "VertexFormat.h"
+#include "MeshCache.h"
+#include "DrawCommandBuilder.h"
+
+//Location of the draw ID attribute (see DrawCommandBuilder)
+#define MESH_BUFFER_DRAW_LOCATION 3
+
+/* \brief One vertex buffer and one index buffer shared by many meshes, allocated once and filled mesh after mesh.
+ * Every mesh has the layout of the buffer, so a single VAO describes them all : a mesh is only a base vertex and an index range.
+ * A frame of draws (DrawCommandBuilder) goes out in one glMultiDrawElementsIndirect (GL 4.3 or ARB_multi_draw_indirect),
+ * or in a loop of glDrawElementsBaseVertex on older contexts (GL 3.2 or ARB_draw_elements_base_vertex).
+ * The ID of each draw reaches the vertex shader as the attribute MESH_BUFFER_DRAW_LOCATION : instanced and selected by the base
+ * instance of the draw in the multi-draw, a constant attribute set before each draw in the loop. */
+class MeshBuffer
+{
+    public:
+        /* \brief Constructor. Allocate the buffers (a GL context must be current)
+         * \param layout the layout of the vertices, interleaved (the stride must not be 0)
+         * \param maxVertices the capacity of the vertex buffer
+         * \param maxIndices the capacity of the index buffer */
+        MeshBuffer(const VertexLayout& layout, uint32_t maxVertices, uint32_t maxIndices);
+
+        /* \brief Destructor. Destroy the buffers */
+        ~MeshBuffer();
+
+        MeshBuffer(const MeshBuffer& copy) = delete;
+        MeshBuffer& operator=(const MeshBuffer& copy) = delete;
+
+        /* \brief Add a geometry, packed in the layout of the buffer. A non indexed geometry gets the indices 0, 1, 2...
+         * \param geometry the geometry
+         * \return the handle of the mesh, or -1 if the buffer is full */
+        int addMesh(const Geometry& geometry);
+
+        /* \brief Add a mesh of the mesh cache, as mapped. Its layout must be the one of the buffer
+         * \param mesh the mesh
+         * \return the handle of the mesh, or -1 if the buffer is full or the layout differs */
+        int addMesh(const CachedMesh& mesh);
+
+        /* \brief Get where a mesh lives in the buffers
+         * \param mesh the handle of the mesh
+         * \return the range of the mesh */
+        const MeshRange& getMesh(uint32_t mesh) const {return m_meshes[mesh];}
+
+        /* \brief Draw a frame of draws. The shader must be in use with its uniforms set
+         * \param commands the draws, uploaded to their indirect buffer here if the multi-draw is available
+         * \param mode the primitive type */
+        void draw(DrawCommandBuilder& commands, GLenum mode = GL_TRIANGLES);
+
+        const VertexLayout& getLayout() const {return m_layout;}
+        uint32_t getNbMeshes() const {return m_meshes.size();}
+        uint32_t getNbVertices() const {return m_nbVertices;}
+        uint32_t getNbIndices() const {return m_nbIndices;}
+
+        /* \brief Get the buffers, for other VAOs reading the same meshes (e.g. the GpuCuller)
+         * \return the vertex buffer (laid out as getLayout()) and the index buffer (32 bits indices, relative to each mesh) */
+        GLuint getVertexBuffer() const {return m_VBO;}
+        GLuint getIndexBuffer() const {return m_EBO;}
+
+        /* \brief Tell if the context can draw meshes of a shared buffer (base vertex)
+         * \return true if it can */
+        static bool isSupported();
+
+        /* \brief Tell if the context can draw a whole frame in one call (multi-draw indirect with base instance)
+         * \return true if it can, false if draw() loops over the draws */
+        static bool isMultiDrawSupported();
+
+    private:
+        /* \brief Copy a mesh at the end of the buffers
+         * \return the handle of the mesh, or -1 if it does not fit */
+        int addMesh(const void* vertexData, uint32_t nbVertices, const uint32_t* indices, uint32_t nbIndices);
+
+        VertexLayout           m_layout;
+        uint32_t               m_maxVertices;
+        uint32_t               m_maxIndices;
+        uint32_t               m_nbVertices = 0;
+        uint32_t               m_nbIndices  = 0;
+        std::vector<MeshRange> m_meshes;
+
+        GLuint   m_VAO = 0;
+        GLuint   m_VBO = 0;
+        GLuint   m_EBO = 0;
+        GLuint   m_drawIDs = 0;          /*!< 0, 1, 2... : the value of the instanced draw ID attribute at each base instance*/
+        uint32_t m_drawIDCapacity = 0;
+};
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef  MESHCACHE_INC
+#define  MESHCACHE_INC
+
+#include <string>
+#include <functional>
+#include "Geometry.h"
+#include "VertexFormat.h"
+#include "MappedFile.h"
+
+/* \brief A mesh ready for the GPU : the packed vertex buffer and the indices, as they go to glBufferData.
+ * The data is mapped from its cache file (or kept in memory if the file could not be written) */
+class CachedMesh
+{
+    public:
+        /* \brief Constructor. The mesh is empty until MeshCache fills it */
+        CachedMesh();
+
+        /* \brief Destructor. Unmap or free the data */
+        ~CachedMesh();
+
+        CachedMesh(const CachedMesh& copy) = delete;
+        CachedMesh& operator=(const CachedMesh& copy) = delete;
+
+        /* \brief Get the layout of the vertex buffer
+         * \return the layout (layout.size bytes of vertex data) */
+        const VertexLayout& getLayout() const {return m_layout;}
+
+        /* \brief Get the vertex buffer data
+         * \return the packed vertices */
+        const void* getVertexData() const {return m_vertexData;}
+
+        /* \brief Get the indices
+         * \return the indices, or NULL if the mesh is not indexed */
+        const uint32_t* getIndices() const {return m_indices;}
+
+        /* \brief Get how many indices the mesh contains
+         * \return the number of indices */
+        uint32_t getNbIndices() const {return m_nbIndices;}
+
+        /* \brief Get how many vertices the mesh contains
+         * \return the number of vertices */
+        uint32_t getNbVertices() const {return m_nbVertices;}
+
+        /* \brief Tell whether the data is mapped from a cache file
+         * \return true if mapped, false if generated in memory */
+        bool isMapped() const {return m_file.getData() != NULL;}
+
+    private:
+        friend class MeshCache;
+
+        /* \brief Release the data */
+        void clear();
+
+        MappedFile      m_file;
+        void*           m_memory     = NULL;
+        VertexLayout    m_layout;
+        const void*     m_vertexData = NULL;
+        const uint32_t* m_indices    = NULL;
+        uint32_t        m_nbVertices = 0;
+        uint32_t        m_nbIndices  = 0;
+};
+
+/* \brief Content addressed cache of GPU ready meshes on disk.
+ * A mesh is named by its generator and parameters (e.g. "Sphere(64, 64)") and its vertex format : the file name is a hash of them.
+ * Files hold a versioned header followed by the packed vertices and the indices, so that loading is only a mmap.
+ * Bump MESHCACHE_VERSION (MeshCache.cpp) when a generator or a vertex format changes. */
+class MeshCache
+{
+    public:
+        /* \brief Constructor
+         * \param directory where the files are kept (created if needed) */
+        MeshCache(const char* directory);
+
+        /* \brief Map a mesh from the cache
+         * \param generator the generator and its parameters
+         * \param format the vertex format
+         * \param mesh filled with the mapped data
+         * \return true if the cache has a valid file for this mesh */
+        bool load(const std::string& generator, VertexFormat format, CachedMesh& mesh);
+
+        /* \brief Pack a geometry (in its vertex format) and write it in the cache
+         * \param generator the generator and its parameters
+         * \param geometry the geometry
+         * \return true if the file was written */
+        bool store(const std::string& generator, const Geometry& geometry);
+
+        /* \brief Map a mesh from the cache, generating and storing it first if it is missing
+         * \param generator the generator and its parameters
+         * \param format the vertex format
+         * \param generate called on a miss to build the geometry
+         * \param mesh filled with the data */
+        void getOrCreate(const std::string& generator, VertexFormat format, const std::function<Geometry()>& generate, CachedMesh& mesh);
+
+    private:
+        /* \brief Get the path of the file of a mesh */
+        std::string getPath(const std::string& key) const;
+
+        std::string m_directory;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef  MESHOPTIMIZER_INC
+#define  MESHOPTIMIZER_INC
+
+#include "Geometry.h"
+
+/* \brief Efficiency of an index order for the post-transform vertex cache */
+struct VertexCacheStats
+{
+    float acmr; /*!< Average cache miss ratio : vertices transformed per triangle (0.5 at best, 3 at worst)*/
+    float atvr; /*!< Average transformed vertex ratio : vertices transformed per vertex of the mesh (1 at best)*/
+};
+
+/* \brief Reorder the data of a geometry before upload :
+ * first the triangles, to reuse the post-transform vertex cache (Forsyth's algorithm),
+ * then the vertices, in the order the triangles first use them, for fetch locality. */
+class MeshOptimizer
+{
+    public:
+        /* \brief Optimize a geometry in place. A non indexed geometry is indexed first (identical vertices are welded).
+         * \param geometry the geometry to optimize
+         * \param cacheDir if not NULL, the directory where the results are saved : a geometry already optimized once is then only reordered
+         * \return the statistics of the geometry after the optimization */
+        static VertexCacheStats optimize(Geometry& geometry, const char* cacheDir = NULL);
+
+        /* \brief Simulate a FIFO post-transform cache on an index order
+         * \param indices the indices (3 per triangle)
+         * \param nbIndices the number of indices
+         * \param nbVertices the number of vertices referenced by the indices
+         * \param cacheSize the number of entries of the simulated cache
+         * \return the statistics */
+        static VertexCacheStats analyze(const uint32_t* indices, uint32_t nbIndices, uint32_t nbVertices, uint32_t cacheSize = 32);
+
+        /* \brief Reorder the triangles for the vertex cache (Tom Forsyth, "Linear-Speed Vertex Cache Optimisation")
+         * \param dst the reordered indices (nbIndices entries, not aliasing indices)
+         * \param indices the indices to reorder
+         * \param nbIndices the number of indices
+         * \param nbVertices the number of vertices referenced by the indices */
+        static void optimizeVertexCache(uint32_t* dst, const uint32_t* indices, uint32_t nbIndices, uint32_t nbVertices);
+
+        /* \brief Renumber the vertices in the order of their first use
+         * \param remap filled with the new index of each old vertex (nbVertices entries). Unused vertices are moved at the end
+         * \param indices the indices, rewritten with the new numbers
+         * \param nbIndices the number of indices
+         * \param nbVertices the number of vertices */
+        static void optimizeVertexFetch(uint32_t* remap, uint32_t* indices, uint32_t nbIndices, uint32_t nbVertices);
+
+    private:
+        /* \brief Turn a non indexed geometry into an indexed one by welding the identical vertices */
+        static void weld(Geometry& geometry);
+
+        /* \brief Check the results read from a cache file before apply() writes through them
+         * \return true if every index is a vertex and the remap table is a permutation of the vertices */
+        static bool validate(const uint32_t* indices, uint32_t nbIndices, const uint32_t* remap, uint32_t nbVertices);
+
+        /* \brief Apply a new index order and a vertex renumbering to a geometry */
+        static void apply(Geometry& geometry, const uint32_t* indices, const uint32_t* remap);
+
+        /* \brief Hash of the vertex and index data of a geometry, naming its cache file */
+        static uint64_t hash(const Geometry& geometry);
+};
+
+#endif
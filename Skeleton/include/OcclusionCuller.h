@@ -0,0 +1,116 @@
+#ifndef  OCCLUSIONCULLER_INC
+#define  OCCLUSIONCULLER_INC
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <stdint.h>
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+
+/* \brief Visibility of a body as known from the last query result that came back from the GPU */
+enum OcclusionState
+{
+    OCCLUSION_UNKNOWN,  /*!< No result yet (first frames, or the body was never tested)*/
+    OCCLUSION_VISIBLE,  /*!< At least one sample passed the depth test*/
+    OCCLUSION_OCCLUDED  /*!< No sample passed the depth test*/
+};
+
+/* \brief An occlusion query attached to one body. The result of a query is read back one or more frames
+ * after it was issued, and only once the GPU reports it as available, so the CPU never waits on it. */
+class OcclusionQuery
+{
+    public:
+        /* \brief Constructor. The GL query object is created lazily the first time it is used */
+        OcclusionQuery();
+
+        /* \brief Destructor. Destroy the GL query object */
+        ~OcclusionQuery();
+
+        OcclusionQuery(const OcclusionQuery& copy) = delete;
+        OcclusionQuery& operator=(const OcclusionQuery& copy) = delete;
+
+        /* \brief Fetch the result of the pending query if the GPU has it ready. Never blocks. */
+        void poll();
+
+        /* \brief Start counting the samples passed by the next draw calls */
+        void begin();
+
+        /* \brief Stop counting the samples. The result will be fetched by a later call to poll() */
+        void end();
+
+        /* \brief Get the last known visibility of the body
+         * \return the visibility state */
+        OcclusionState getState() const {return m_state;}
+
+        /* \brief Tell whether a query was issued and its result did not come back yet
+         * \return true if a result is pending */
+        bool isPending() const {return m_pending;}
+
+        /* \brief Get the GL query ID (0 if never used)
+         * \return the query ID*/
+        GLuint getID() const {return m_id;}
+
+    private:
+        GLuint         m_id      = 0;
+        bool           m_pending = false;
+        OcclusionState m_state   = OCCLUSION_UNKNOWN;
+};
+
+/* \brief Coherent occlusion culling of the bodies.
+ * Bodies visible at the previous result are drawn directly, their draw being counted to refresh their state.
+ * Bodies occluded or of unknown visibility first have a cheap proxy sphere tested against the depth buffer,
+ * then their full draw is wrapped in a conditional render which the GPU skips if the proxy was hidden. */
+class OcclusionCuller
+{
+    public:
+        /* \brief Constructor
+         * \param proxyShader the shader used to rasterize the proxies (only writes depth)
+         * \param proxyVAO the VAO containing the indexed proxy sphere (radius 0.5, same as Sphere)
+         * \param proxyFirstIndex the offset (in indices) of the proxy sphere in the element buffer of the VAO
+         * \param proxyNbIndices the number of indices of the proxy sphere
+         * \param proxyScale the scale applied to the proxy so that the coarse mesh encloses the real sphere */
+        OcclusionCuller(Shader* proxyShader, GLuint proxyVAO, uint32_t proxyFirstIndex, uint32_t proxyNbIndices, float proxyScale);
+
+        /* \brief To call before the full draw of a body. Issues the proxy test if needed and starts either the query or the conditional render
+         * \param query the query attached to the body
+         * \param mvp the model view projection matrix of the body */
+        void beginBody(OcclusionQuery& query, const glm::mat4& mvp);
+
+        /* \brief To call after the full draw of a body. Closes what beginBody started
+         * \param query the query attached to the body */
+        void endBody(OcclusionQuery& query);
+
+        /* \brief Enable or disable the culling. When disabled, beginBody and endBody do nothing
+         * \param enabled the new state */
+        void setEnabled(bool enabled) {m_enabled = enabled;}
+
+        /* \brief Is the culling enabled ?
+         * \return true if enabled */
+        bool isEnabled() const {return m_enabled;}
+
+        /* \brief Reset the per-frame counters. To call at the beginning of each frame */
+        void newFrame();
+
+        /* \brief Get how many proxies were tested this frame
+         * \return the number of proxy draws */
+        uint32_t getNbProxyTests() const {return m_nbProxyTests;}
+
+        /* \brief Get how many bodies were drawn under a conditional render this frame
+         * \return the number of conditional draws */
+        uint32_t getNbConditionalDraws() const {return m_nbConditionalDraws;}
+
+    private:
+        Shader*  m_proxyShader;
+        GLuint   m_proxyVAO;
+        uint32_t m_proxyFirstIndex;
+        uint32_t m_proxyNbIndices;
+        float    m_proxyScale;
+        bool     m_enabled            = true;
+        bool     m_conditional        = false;
+        bool     m_counting           = false;
+        uint32_t m_nbProxyTests       = 0;
+        uint32_t m_nbConditionalDraws = 0;
+};
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef  OVERDRAWCOUNTER_INC
+#define  OVERDRAWCOUNTER_INC
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <stdint.h>
+#include <vector>
+#include <deque>
+
+#include "Shader.h"
+
+/* \brief What the samples counted by an OverdrawCounter are */
+enum OverdrawPass
+{
+    OVERDRAW_SHADING,  /*!< Fragments written by the shading draws*/
+    OVERDRAW_DEPTH,    /*!< Fragments written by a depth only pass*/
+    OVERDRAW_COVERAGE, /*!< Pixels something was drawn on (see measureCoverage)*/
+    OVERDRAW_NB_PASSES
+};
+
+/* \brief Counts the fragments of a frame which pass the depth test (GL_SAMPLES_PASSED queries), per pass, against the pixels covered :
+ * the shaded fragments per covered pixel is the overdraw. Like GpuTimer, the results are read back once available and accumulated until reset().
+ * GL cannot nest two GL_SAMPLES_PASSED queries : the occlusion culler must be disabled while counting */
+class OverdrawCounter
+{
+    public:
+        /* \brief Constructor. The queries are created as needed
+         * \param coverageShader the shader of the full screen triangle of measureCoverage (coverage.vert)
+         * \param emptyVAO an empty VAO : the triangle is built from gl_VertexID */
+        OverdrawCounter(Shader* coverageShader, GLuint emptyVAO);
+
+        /* \brief Destructor. Destroy the queries */
+        ~OverdrawCounter();
+
+        OverdrawCounter(const OverdrawCounter& copy) = delete;
+        OverdrawCounter& operator=(const OverdrawCounter& copy) = delete;
+
+        /* \brief Count the samples of the next draws as a pass. Stops the count of the previous pass if one runs
+         * \param pass the pass */
+        void begin(OverdrawPass pass);
+
+        /* \brief Stop counting */
+        void end();
+
+        /* \brief Tell which pass is counted
+         * \return the pass, OVERDRAW_NB_PASSES if none */
+        OverdrawPass getCurrentPass() const {return m_current;}
+
+        /* \brief Count the pixels covered by the frame drawn so far : a triangle over the screen, on the far plane, only passes where the depth was written.
+         * Call it once per frame, after the frame */
+        void measureCoverage();
+
+        /* \brief Wait for every count in flight and collect it */
+        void finish();
+
+        /* \brief Forget the counts collected so far */
+        void reset();
+
+        /* \brief Get the samples of a pass collected since the last reset
+         * \param pass the pass
+         * \return the number of samples */
+        uint64_t getNbSamples(OverdrawPass pass) const {return m_nbSamples[pass];}
+
+        /* \brief Get the fragments of a pass per covered pixel
+         * \param pass the pass
+         * \return the ratio, 0 if nothing was covered */
+        double getPerPixel(OverdrawPass pass) const;
+
+    private:
+        struct PendingQuery
+        {
+            GLuint       id;
+            OverdrawPass pass;
+        };
+
+        /* \brief Collect the results which came back, in the order the queries were issued
+         * \param wait wait for the GPU if a result is not there yet */
+        void collect(bool wait);
+
+        Shader*                  m_coverageShader;
+        GLuint                   m_emptyVAO;
+        OverdrawPass             m_current = OVERDRAW_NB_PASSES;
+        GLuint                   m_currentID = 0;
+        std::deque<PendingQuery> m_pending;
+        std::vector<GLuint>      m_free;    /*!< Queries whose result was collected*/
+        std::vector<GLuint>      m_queries; /*!< Every query created*/
+        uint64_t                 m_nbSamples[OVERDRAW_NB_PASSES];
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef  PARALLEL_INC
+#define  PARALLEL_INC
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <functional>
+
+/* \brief Run a loop over the workers of the shared JobSystem. Returns once every index is done, the calling thread
+ * running jobs meanwhile. Small ranges (less than two grains of minBandSize) run on the calling thread only.
+ * \param begin the first index
+ * \param end the index after the last one
+ * \param minBandSize the smallest number of indices worth a job
+ * \param body called with [first, last) for each piece, from any thread
+ * \param name the name of the pieces for the profiler hook (see JobSystem::setProfilerHook), or NULL */
+void parallelFor(uint32_t begin, uint32_t end, uint32_t minBandSize, const std::function<void(uint32_t first, uint32_t last)>& body, const char* name = NULL);
+
+/* \brief Get how many threads parallelFor uses (the calling thread included)
+ * \return the number of workers */
+uint32_t getNbWorkers();
+
+/* \brief Change how many threads parallelFor uses (the calling thread included). Restarts the shared JobSystem : only while no job runs
+ * \param nbWorkers the number of workers. 0 for the number of hardware threads */
+void setNbWorkers(uint32_t nbWorkers);
+
+/* \brief Pin the calling thread (the GL thread) and the workers to their cores, or unpin the workers. Restarts the shared JobSystem
+ * \param pinned true to pin them */
+void setWorkerPinning(bool pinned);
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef  PLANETNOISE_INC
+#define  PLANETNOISE_INC
+
+#include <stdint.h>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <glm/glm.hpp>
+
+#include "LRUCache.h"
+
+/* \brief Parameters of the relief of a planet */
+struct PlanetNoiseParams
+{
+    uint32_t seed       = 0;     /*!< Same seed, same relief, on every machine and with or without SIMD*/
+    uint32_t octaves    = 8;     /*!< Number of noise layers*/
+    float    frequency  = 2.0f;  /*!< Frequency of the first octave, in features per radius*/
+    float    lacunarity = 2.0f;  /*!< Frequency ratio between two octaves*/
+    float    gain       = 0.5f;  /*!< Amplitude ratio between two octaves*/
+    float    ridged     = 0.5f;  /*!< Mix between fBm (0 : rolling hills) and ridged multifractal (1 : sharp crests)*/
+    float    amplitude  = 0.01f; /*!< Largest height, relative to the radius*/
+};
+
+/* \brief Heights and normals of a square patch of a cube face, one sample per vertex of a terrain node */
+struct PlanetTile
+{
+    uint32_t               resolution; /*!< Samples along a side*/
+    std::vector<glm::vec4> samples;    /*!< Row by row : normal (xyz, model space) and height (w, relative to the radius)*/
+};
+
+/* \brief Procedural relief of a planet : fBm and ridged multifractal mixed, on 3D gradient noise sampled on the unit sphere.
+ * The batch sampling runs 4 samples at once with SSE2 (scalar elsewhere, with bitwise identical results).
+ * Tiles are generated on demand, several at once over the worker threads, and kept in an LRU cache. Thread safe */
+class PlanetNoise
+{
+    public:
+        /* \brief Constructor
+         * \param params the relief
+         * \param tileResolution the number of samples along the side of a tile (the grid size of the terrain + 1)
+         * \param cacheSize the number of tiles kept in the cache */
+        PlanetNoise(const PlanetNoiseParams& params, uint32_t tileResolution = 33, uint32_t cacheSize = 512);
+
+        PlanetNoise(const PlanetNoise& copy) = delete;
+        PlanetNoise& operator=(const PlanetNoise& copy) = delete;
+
+        /* \brief Height of one point
+         * \param direction the point on the unit sphere
+         * \return the height, relative to the radius */
+        float sample(const glm::vec3& direction) const;
+
+        /* \brief Height of several points, on the calling thread
+         * \param x the x coordinates of the points on the unit sphere
+         * \param y the y coordinates
+         * \param z the z coordinates
+         * \param heights filled with the heights, relative to the radius
+         * \param count the number of points */
+        void sample(const float* x, const float* y, const float* z, float* heights, uint32_t count) const;
+
+        /* \brief Height of the texels of an equirectangular map, with the texture mapping of Sphere (u = theta/2PI, v = phi/PI), over the worker threads
+         * \param width the number of texels along u
+         * \param height the number of texels along v
+         * \param heights filled row by row with width*height heights, relative to the radius */
+        void sampleMap(uint32_t width, uint32_t height, float* heights) const;
+
+        /* \brief Get a tile, from the cache or generated on the calling thread
+         * \param face the cube face (as PlanetTerrain)
+         * \param depth the depth of the node in the face quadtree (0 for the whole face)
+         * \param ix the column of the node at this depth
+         * \param iy the row of the node at this depth
+         * \return the tile */
+        std::shared_ptr<const PlanetTile> getTile(uint32_t face, uint32_t depth, uint32_t ix, uint32_t iy);
+
+        /* \brief Generate the tiles which are not in the cache yet, over the worker threads
+         * \param keys the keys of the tiles (see getTileKey) */
+        void prefetchTiles(const std::vector<uint64_t>& keys);
+
+        /* \brief Get the key identifying a tile
+         * \return the key */
+        static uint64_t getTileKey(uint32_t face, uint32_t depth, uint32_t ix, uint32_t iy)
+        {
+            return ((uint64_t)face << 61) | ((uint64_t)depth << 56) | ((uint64_t)ix << 28) | iy;
+        }
+
+        /* \brief Get an upper bound of the absolute heights
+         * \return the bound, relative to the radius */
+        float getMaxHeight() const {return 1.05f*m_params.amplitude;}
+
+        uint32_t getTileResolution() const {return m_tileResolution;}
+        const PlanetNoiseParams& getParams() const {return m_params;}
+
+    private:
+        /* \brief Compute a tile */
+        std::shared_ptr<const PlanetTile> generateTile(uint64_t key) const;
+
+        /* \brief Find a tile in the cache
+         * \return the tile, or an empty pointer */
+        std::shared_ptr<const PlanetTile> findTile(uint64_t key);
+
+        /* \brief Add a tile to the cache (unless another thread did it first) */
+        void storeTile(uint64_t key, const std::shared_ptr<const PlanetTile>& tile);
+
+        PlanetNoiseParams m_params;
+        uint32_t          m_tileResolution;
+
+        std::mutex                                                  m_mutex;
+        LRUCache<uint64_t, std::shared_ptr<const PlanetTile> >      m_cache;
+};
+
+#endif
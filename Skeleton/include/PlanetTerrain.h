@@ -0,0 +1,152 @@
+#ifndef  PLANETTERRAIN_INC
+#define  PLANETTERRAIN_INC
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <stdint.h>
+#include <vector>
+#include <mutex>
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+#include "PlanetNoise.h"
+#include "LRUCache.h"
+#include "JobSystem.h"
+
+//Height textures kept on the GPU per body
+#define TERRAIN_TEXTURE_CACHE_SIZE 512
+
+/* \brief One chunk to draw : a node of a face quadtree, or some quadrants of it */
+struct TerrainChunk
+{
+    uint8_t face;      /*!< Cube face (0 to 5 : +X, -X, +Y, -Y, +Z, -Z)*/
+    uint8_t level;     /*!< LOD level of the node, 0 being the finest*/
+    uint8_t quadrants; /*!< Bit q set : the quadrant q (x + 2*y) of the grid is drawn. 0xf for the whole node*/
+    float   x, y;      /*!< Corner of the node on its face, in [-1, 1]*/
+    float   size;      /*!< Side of the node on its face*/
+};
+
+/* \brief CDLOD planet renderer (Strugar, "Continuous Distance-Dependent Level of Detail for Rendering Heightmaps"), on a sphere of radius 0.5.
+ * The sphere is a cube whose six faces are quadtrees of nodes. Every node is drawn with the same grid of gridSize x gridSize quads,
+ * so a node covers 4 times the area of its children with the same number of triangles.
+ * A node is refined when the camera is within the range of its children. Towards the end of its range, the vertices of a node
+ * morph into the grid of its parent, so that neighbour nodes of different levels meet without cracks and levels do not pop.
+ * Nodes are culled against the view frustum and the horizon.
+ * The selection of each body runs as a job of the shared JobSystem : the chunks drawn in a frame were selected from the previous request of the body.
+ * A body can have a relief (PlanetNoise) : the job also prefetches the tiles of the selected nodes, which are uploaded as textures
+ * read by the vertex shader (one texel per vertex of the grid). */
+class PlanetTerrain
+{
+    public:
+        /* \brief Constructor. Create the grid buffers (a GL context must be current)
+         * \param gridSize the number of quads along the side of a node (even)
+         * \param maxDepth the depth of the quadtrees : the finest nodes are 2^maxDepth times smaller than a face
+         * \param lodDistanceRatio the distance, in node sizes, below which a node is refined */
+        PlanetTerrain(uint32_t gridSize = 32, uint32_t maxDepth = 12, float lodDistanceRatio = 2.0f);
+
+        /* \brief Destructor. Wait for the selection jobs and destroy the buffers */
+        ~PlanetTerrain();
+
+        PlanetTerrain(const PlanetTerrain& copy) = delete;
+        PlanetTerrain& operator=(const PlanetTerrain& copy) = delete;
+
+        /* \brief Register a body drawn with this terrain
+         * \param noise the relief of the body (its tile resolution must be the grid size + 1), or NULL for a smooth sphere. It must outlive the terrain
+         * \return the handle of the body */
+        uint32_t addBody(PlanetNoise* noise = NULL);
+
+        /* \brief Start the selection of the chunks of a body on the workers. Replaces any request not started yet
+         * \param body the handle of the body
+         * \param mvp the model to clip space matrix of the body
+         * \param camera the camera position in the model space of the body */
+        void requestSelection(uint32_t body, const glm::mat4& mvp, const glm::vec3& camera);
+
+        /* \brief Wait for each selection in getSelection(), instead of drawing the last one done. For the views which differ from
+         * one draw to the next, e.g. the tiles of a poster : a selection for the previous view would miss the chunks of this one
+         * \param synchronous true to wait */
+        void setSynchronous(bool synchronous) {m_synchronous = synchronous;}
+
+        /* \brief Get the last chunks selected for a body. Only waits for the selection the first time, or when synchronous
+         * \param body the handle of the body
+         * \return the chunks */
+        const std::vector<TerrainChunk>& getSelection(uint32_t body);
+
+        /* \brief Draw the last chunks selected for a body. The shader (terrain.vert) must be in use with its other uniforms set.
+         * Uses the texture unit 1 for the heights
+         * \param body the handle of the body
+         * \param shader the terrain shader
+         * \param camera the camera position in the model space of the body
+         * \return the number of triangles drawn */
+        uint32_t draw(uint32_t body, const Shader* shader, const glm::vec3& camera);
+
+        /* \brief Select the chunks of a sphere, on the calling thread
+         * \param mvp the model to clip space matrix
+         * \param camera the camera position in model space
+         * \param chunks filled with the selected chunks
+         * \param maxHeight the largest height of the relief, relative to the radius */
+        void select(const glm::mat4& mvp, const glm::vec3& camera, std::vector<TerrainChunk>& chunks, float maxHeight = 0.0f) const;
+
+        uint32_t getGridSize() const {return m_gridSize;}
+
+        /* \brief Get the position on the sphere of a point of a face
+         * \param face the cube face
+         * \param u the first coordinate on the face, in [-1, 1]
+         * \param v the second coordinate on the face, in [-1, 1]
+         * \return the point on the sphere of radius 0.5 */
+        static glm::vec3 faceToSphere(uint32_t face, float u, float v);
+
+    private:
+        /* \brief What the worker needs to select the chunks of a body */
+        struct SelectionRequest
+        {
+            glm::vec4 planes[6]; /*!< Frustum planes in model space, pointing inside*/
+            glm::vec3 camera;
+            float     maxHeight; /*!< Largest height of the relief, relative to the radius*/
+        };
+
+        struct Body
+        {
+            Body(PlanetNoise* noise) : noise(noise), textures(TERRAIN_TEXTURE_CACHE_SIZE) {}
+
+            PlanetNoise*               noise;             /*!< Relief, or NULL*/
+            LRUCache<uint64_t, GLuint> textures;          /*!< Height textures by tile key. Render thread only*/
+            SelectionRequest           request;
+            bool                       pending   = false; /*!< A request is waiting for the job*/
+            bool                       running   = false; /*!< A job is selecting for this body : it takes the new requests too*/
+            bool                       hasResult = false; /*!< A selection was produced at least once*/
+            bool                       fresh     = false; /*!< result is newer than front*/
+            JobCounter                 job;               /*!< The selection job in flight*/
+            std::vector<TerrainChunk>  result;            /*!< Written by the job*/
+            std::vector<TerrainChunk>  front;             /*!< Read by the render thread*/
+        };
+
+        /* \brief Select the chunks of one node (CDLOD) and its children
+         * \return false if the node is out of the range of its level : its parent has to draw this area */
+        bool selectNode(const SelectionRequest& request, uint32_t face, float x, float y, float size, uint32_t level, std::vector<TerrainChunk>& chunks) const;
+
+        /* \brief Get the height texture of a chunk, uploading its tile if needed */
+        GLuint getHeightTexture(Body* body, const TerrainChunk& chunk);
+
+        /* \brief Get the key of the tile of a chunk (see PlanetNoise::getTileKey) */
+        uint64_t getTileKey(const TerrainChunk& chunk) const;
+
+        /* \brief Extract the frustum planes from a model to clip space matrix */
+        static void extractPlanes(const glm::mat4& mvp, glm::vec4* planes);
+
+        /* \brief The selection job of a body : selects until no request is pending */
+        void selectBody(Body* body);
+
+        uint32_t           m_gridSize;
+        uint32_t           m_maxDepth;
+        std::vector<float> m_ranges;       /*!< Refinement distance of each level, in model space*/
+        GLuint             m_VAO = 0;
+        GLuint             m_VBO = 0;
+        GLuint             m_EBO = 0;
+        uint32_t           m_nbQuadrantIndices;
+
+        std::vector<Body*> m_bodies;
+        std::mutex         m_mutex;
+        bool               m_synchronous = false;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef  QUALITYGOVERNOR_INC
+#define  QUALITYGOVERNOR_INC
+
+#include <stdint.h>
+#include <vector>
+
+//Frames of the rolling window the CPU and GPU times are averaged over
+#define QUALITY_WINDOW_FRAMES 60
+
+//Frames over budget it takes to step down : quick, a missed frame shows at once
+#define QUALITY_DOWN_FRAMES 10
+
+//Frames ignored after a change : the GPU times read back meanwhile were measured with the previous level
+#define QUALITY_SETTLE_FRAMES 6
+
+//Frames to wait after a change before stepping up again. Doubled each time a step up had to be undone, up to QUALITY_MAX_COOLDOWN_FRAMES
+#define QUALITY_COOLDOWN_FRAMES     120
+#define QUALITY_MAX_COOLDOWN_FRAMES 1920
+
+//Above this part of the budget the level steps down, below the other one it may step up
+#define QUALITY_DOWN_RATIO 0.95
+#define QUALITY_UP_RATIO   0.70
+
+/* \brief The settings of a quality level */
+struct QualityLevel
+{
+    const char* name;
+    float renderScale;    /*!< Size of the rendered frame over the one of the window, the frame is upscaled*/
+    int   lodBias;        /*!< Added to the levels of the LOD chains (see LODSphere::selectLevel), negative is coarser*/
+    float textureLodBias; /*!< Added to the mipmap level of the textures, positive is blurrier*/
+    bool  effects;        /*!< False to turn the costly modes off (terrain, tessellation) : the bodies fall back to the LOD chain*/
+};
+
+/* \brief What the governor measured and decided */
+struct QualityStats
+{
+    double   cpuMs = 0.0;         /*!< Mean CPU time of a frame over the window*/
+    double   gpuMs = 0.0;         /*!< Mean GPU time of a frame over the window, 0 without timer queries*/
+    double   budgetMs = 0.0;
+    uint32_t level = 0;           /*!< Index of the current level, 0 is the finest*/
+    uint32_t nbFrames = 0;        /*!< Frames measured since the last reset*/
+    uint32_t nbOverBudget = 0;    /*!< Frames of which the CPU or the GPU time was over the budget*/
+    uint32_t nbStepsDown = 0;
+    uint32_t nbStepsUp = 0;
+    uint32_t cooldownFrames = 0;  /*!< Frames the next step up waits for, after a change*/
+};
+
+/* \brief Keeps the frames within a time budget by trading quality for speed. Each frame it is given the CPU time and the GPU time
+ * (GpuTimer::getLastMs) of the frame, the slowest of the two is the cost. The levels, from the finest to the coarsest, lower
+ * the levels of detail first, then blur the textures, then the resolution, and turn the costly modes off last.
+ * The hysteresis keeps it from oscillating : it steps down after QUALITY_DOWN_FRAMES frames over QUALITY_DOWN_RATIO of the budget,
+ * up only after a whole window under QUALITY_UP_RATIO of it and a cooldown which grows every time the step up is undone soon after */
+class QualityGovernor
+{
+    public:
+        /* \brief Constructor. Starts at the finest level
+         * \param budgetMs the time a frame can take, in milliseconds */
+        QualityGovernor(double budgetMs);
+
+        /* \brief Measure a frame and change the level if needed
+         * \param cpuMs the CPU time of the frame, in milliseconds
+         * \param gpuMs the GPU time of the frame, 0 if unknown
+         * \return true if the level changed */
+        bool addFrame(double cpuMs, double gpuMs);
+
+        /* \brief Turn the governor on or off. Off, it goes back to the finest level and measures nothing */
+        void setEnabled(bool enabled);
+        bool isEnabled() const {return m_enabled;}
+
+        /* \brief Forget the measures and go back to the finest level */
+        void reset();
+
+        /* \brief Get the settings to draw the next frame with
+         * \return the current level */
+        const QualityLevel& getLevel() const {return getLevel(m_stats.level);}
+
+        /* \brief Get what was measured and decided
+         * \return the statistics */
+        const QualityStats& getStats() const {return m_stats;}
+
+        /* \brief Get the settings of a level
+         * \param level the index of the level, 0 is the finest
+         * \return the settings */
+        static const QualityLevel& getLevel(uint32_t level);
+
+        static uint32_t getNbLevels();
+
+    private:
+        /* \brief Move to another level and start measuring it */
+        void setLevel(uint32_t level);
+
+        bool                m_enabled = true;
+        QualityStats        m_stats;
+        std::vector<double> m_cpuMs;        /*!< The rolling window*/
+        std::vector<double> m_gpuMs;
+        uint32_t            m_next = 0;     /*!< Slot of the next frame in the window*/
+        uint32_t            m_nbMeasured = 0; /*!< Frames in the window, up to QUALITY_WINDOW_FRAMES*/
+        uint32_t            m_nbSince = 0;  /*!< Frames since the last change*/
+        uint32_t            m_overRun = 0;  /*!< Frames over the budget in a row*/
+        bool                m_steppedUp = false; /*!< The last change was a step up*/
+};
+
+#endif
@@ -17,7 +17,7 @@ class Shader
         Shader();
 
         /* \brief Destructor. Destroy the shader component created */
-        ~Shader();
+        virtual ~Shader();
 
         /** \brief get the program ID stored in the graphic memory of this shader.
          * \return the program ID */
@@ -31,6 +31,22 @@ class Shader
          * \return the fragment ID */
         int getFragID() const;
 
+        /** \brief tell if the program has tessellation stages (it then draws GL_PATCHES).
+         * \return true if it has a tessellation control and a tessellation evaluation shader */
+        bool hasTessellation() const;
+
+        /** \brief tell if the context can run tessellation shaders (GL 4.0 or ARB_tessellation_shader).
+         * \return true if it can */
+        static bool isTessellationSupported();
+
+        /** \brief tell if the program is a compute shader (it is then run with glDispatchCompute).
+         * \return true if it is */
+        bool isCompute() const;
+
+        /** \brief tell if the context can run compute shaders (GL 4.3 or ARB_compute_shader).
+         * \return true if it can */
+        static bool isComputeSupported();
+
         /** \brief create a shader from a vertex and a fragment file.
          * \param vertexFile the vertex file.
          * \param fragmentFile the fragment file.
@@ -38,6 +54,30 @@ class Shader
          * \return the Shader constructed or NULL if error*/
         static Shader* loadFromFiles(FILE* vertexFile, FILE* fragFile);
 
+        /** \brief create a shader from a vertex and a fragment file, the fragment shader using functions shared with other shaders.
+         * \param vertexFile the vertex file.
+         * \param fragmentFile the fragment file.
+         * \param fragLibFile the file of shared functions. Its code is inserted right after the #version line of the fragment file.
+         *
+         * \return the Shader constructed or NULL if error*/
+        static Shader* loadFromFiles(FILE* vertexFile, FILE* fragFile, FILE* fragLibFile);
+
+        /** \brief create a shader with tessellation stages from files, the fragment shader using functions shared with other shaders.
+         * \param vertexFile the vertex file.
+         * \param tessControlFile the tessellation control file.
+         * \param tessEvalFile the tessellation evaluation file.
+         * \param fragmentFile the fragment file.
+         * \param fragLibFile the file of shared functions. Its code is inserted right after the #version line of the fragment file.
+         *
+         * \return the Shader constructed or NULL if error (or if tessellation is not supported)*/
+        static Shader* loadFromFiles(FILE* vertexFile, FILE* tessControlFile, FILE* tessEvalFile, FILE* fragFile, FILE* fragLibFile);
+
+        /** \brief create a compute shader from a file.
+         * \param computeFile the compute file.
+         *
+         * \return the Shader constructed or NULL if error (or if compute shaders are not supported)*/
+        static Shader* loadComputeFromFile(FILE* computeFile);
+
         /** \brief create a shader from a vertex and a fragment string.
          * \param vertexString the vertex string.
          * \param fragmentString the fragment string.
@@ -45,18 +85,53 @@ class Shader
          * \return the Shader constructed or NULL if error
          * */
         static Shader* loadFromStrings(const std::string& vertexString, const std::string& fragString);
+
+        /** \brief create a shader from vertex, tessellation and fragment strings.
+         * \param vertexString the vertex string.
+         * \param tessControlString the tessellation control string (empty for none).
+         * \param tessEvalString the tessellation evaluation string (empty for none).
+         * \param fragmentString the fragment string.
+         *
+         * \return the Shader constructed or NULL if error
+         * */
+        static Shader* loadFromStrings(const std::string& vertexString, const std::string& tessControlString, const std::string& tessEvalString, const std::string& fragString);
+
+        /** \brief create a compute shader from a string.
+         * \param computeString the compute string.
+         *
+         * \return the Shader constructed or NULL if error (or if compute shaders are not supported)
+         * */
+        static Shader* loadComputeFromString(const std::string& computeString);
     private:
-        GLuint m_programID; /*!< The shader   program ID*/
-        GLuint m_vertexID;  /*!< The vertex   shader  ID*/
-        GLuint m_fragID;    /*!< The fragment shader  ID*/
+        GLuint m_programID;     /*!< The shader   program ID*/
+        GLuint m_vertexID;      /*!< The vertex   shader  ID*/
+        GLuint m_tessControlID; /*!< The tessellation control    shader ID (0 if none)*/
+        GLuint m_tessEvalID;    /*!< The tessellation evaluation shader ID (0 if none)*/
+        GLuint m_fragID;        /*!< The fragment shader  ID*/
+        GLuint m_computeID;     /*!< The compute  shader  ID (0 if none)*/
 
         /* \brief Bind the attributes to known locations (vPosition to 0, vColor to 1 for example)*/
         virtual void bindAttributes();
 
+        /** \brief Link the program, its components being attached
+         * \return false if the link failed (the error is printed) */
+        bool link();
+
         /** \brief Bind the attributes key string by an ID 
          * \param code the attribute name
          * \param type the type of this attribute (vertex, fragment, etc.)*/
         static int loadShader(const std::string& code, int type);
+
+        /** \brief Read a whole file
+         * \param file the file to read
+         * \return the content of the file */
+        static std::string readFile(FILE* file);
+
+        /** \brief Insert a library code after the #version line of a shader code
+         * \param code the shader code
+         * \param lib the library code
+         * \return the merged code */
+        static std::string insertLibrary(const std::string& code, const std::string& lib);
 };
 
 #endif
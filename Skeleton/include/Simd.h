@@ -0,0 +1,29 @@
+#ifndef  SIMD_INC
+#define  SIMD_INC
+
+//SSE2 is always there on x86-64, and on x86 when the compiler is allowed to use it. Other targets take the scalar paths
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2
+#include <emmintrin.h>
+
+/* \brief Store 4 points given as separate x, y and z vectors as 12 interleaved floats (xyz xyz xyz xyz)
+ * \param dst where to write (no alignment needed)
+ * \param x the x coordinates of the 4 points
+ * \param y the y coordinates of the 4 points
+ * \param z the z coordinates of the 4 points */
+static inline void storeInterleavedXYZ(float* dst, __m128 x, __m128 y, __m128 z)
+{
+    __m128 xy  = _mm_unpacklo_ps(x, y);                          //x0 y0 x1 y1
+    __m128 zx  = _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0));  //z0 z0 x1 x1
+    __m128 yz1 = _mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1));  //y1 y1 z1 z1
+    __m128 xy2 = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2));  //x2 x2 y2 y2
+    __m128 zx2 = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2));  //z2 z2 x3 x3
+    __m128 yz3 = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3));  //y3 y3 z3 z3
+
+    _mm_storeu_ps(dst,   _mm_shuffle_ps(xy,  zx,  _MM_SHUFFLE(2, 0, 1, 0))); //x0 y0 z0 x1
+    _mm_storeu_ps(dst+4, _mm_shuffle_ps(yz1, xy2, _MM_SHUFFLE(2, 0, 2, 0))); //y1 z1 x2 y2
+    _mm_storeu_ps(dst+8, _mm_shuffle_ps(zx2, yz3, _MM_SHUFFLE(2, 0, 2, 0))); //z2 x3 y3 z3
+}
+#endif
+
+#endif
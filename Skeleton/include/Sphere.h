@@ -5,13 +5,15 @@
 #include <cmath>
 #include <glm/glm.hpp>
 
+/* \brief An indexed UV sphere of radius 0.5 */
 class Sphere : public Geometry
 {
     public:
         /* \brief Constructor
          * \param nbLatitude the number of lattitude for this sphere
-         * \param nbLongitude the number of longitude for this sphere */
-        Sphere(uint32_t nbLatitude, uint32_t nbLongitude);
+         * \param nbLongitude the number of longitude for this sphere
+         * \param allocator where the data is allocated (NULL for the default allocator) */
+        Sphere(uint32_t nbLatitude, uint32_t nbLongitude, Allocator* allocator = NULL);
 };
 
 #endif
@@ -0,0 +1,24 @@
+#ifndef  SPHERICALGEOMETRY_INC
+#define  SPHERICALGEOMETRY_INC
+
+#include "Geometry.h"
+#include <vector>
+#include <glm/glm.hpp>
+
+/* \brief Base of the indexed spheres (radius 0.5) built from points on the unit sphere.
+ * The UVs follow the same mapping as Sphere (u = longitude, v = latitude from the north pole).
+ * Vertices are duplicated where needed so that no triangle interpolates across the u seam or around a pole. */
+class SphericalGeometry : public Geometry
+{
+    protected:
+        /* \brief Constructor
+         * \param allocator where the data is allocated (NULL for the default allocator) */
+        SphericalGeometry(Allocator* allocator = NULL) : Geometry(allocator) {}
+
+        /* \brief Fill the geometry
+         * \param directions the vertices, on the unit sphere
+         * \param triangles the indices of the triangles (3 per triangle), counter clockwise seen from outside */
+        void build(const std::vector<glm::vec3>& directions, const std::vector<uint32_t>& triangles);
+};
+
+#endif
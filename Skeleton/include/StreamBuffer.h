@@ -0,0 +1,87 @@
+#ifndef  STREAMBUFFER_INC
+#define  STREAMBUFFER_INC
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <stdint.h>
+#include <vector>
+
+//Frames the CPU may write ahead of the GPU by default
+#define STREAM_BUFFER_FRAMES 3
+
+/* \brief A buffer for the data rewritten every frame (draw records, indirect commands...), written by the CPU while the GPU reads the previous frames.
+ * With GL 4.4 or ARB_buffer_storage it is one persistent and coherent mapping split in one region per frame in flight :
+ * map() only returns a pointer in the region of the current frame, and a fence guards each region until the GPU is done with it.
+ * Otherwise the buffer is one region, orphaned at each frame (glMapBufferRange with GL_MAP_INVALIDATE_BUFFER_BIT) and mapped
+ * unsynchronized for the next writes of the frame.
+ * The frames are counted by the static newFrame() : every stream buffer moves to its next region the first time it is mapped in a new frame. */
+class StreamBuffer
+{
+    public:
+        /* \brief Constructor. The buffer is allocated at the first map()
+         * \param regionSize the bytes one frame may write (the buffer grows if a frame asks more)
+         * \param framesInFlight the number of regions, i.e. of frames the CPU may write ahead of the GPU (persistent mapping only) */
+        StreamBuffer(uint32_t regionSize, uint32_t framesInFlight = STREAM_BUFFER_FRAMES);
+
+        /* \brief Destructor. Destroy the buffer and its fences */
+        ~StreamBuffer();
+
+        StreamBuffer(const StreamBuffer& copy) = delete;
+        StreamBuffer& operator=(const StreamBuffer& copy) = delete;
+
+        /* \brief Get room for the next data of the frame. Waits only if the GPU still reads the region, framesInFlight frames later.
+         * The buffer may be recreated to grow : getBuffer() has to be read after the call
+         * \param size the bytes to write
+         * \param alignment the alignment of the offset (e.g. GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT), a power of two
+         * \param offset where the data starts in the buffer
+         * \return where to write the data, until unmap() */
+        void* map(uint32_t size, uint32_t alignment, GLintptr* offset);
+
+        /* \brief Make the data written since map() visible to the GPU (nothing to do with the coherent mapping) */
+        void unmap();
+
+        /* \brief Copy data in the buffer
+         * \param data the data
+         * \param size its size in bytes
+         * \param alignment the alignment of the offset, a power of two
+         * \return where the data starts in the buffer */
+        GLintptr write(const void* data, uint32_t size, uint32_t alignment = 4);
+
+        /* \brief Get the GL buffer
+         * \return the buffer (0 before the first map) */
+        GLuint getBuffer() const {return m_buffer;}
+
+        /* \brief Get how many times the CPU had to wait for the GPU to release a region
+         * \return the number of waits */
+        uint32_t getNbWaits() const {return m_nbWaits;}
+
+        /* \brief Start a new frame, for every stream buffer. Call it once per frame, e.g. after the buffer swap */
+        static void newFrame();
+
+        /* \brief Tell if the buffers are persistently mapped (GL 4.4 or ARB_buffer_storage), orphaned otherwise
+         * \return true if they are */
+        static bool isPersistentSupported();
+
+    private:
+        /* \brief (Re)create the buffer with regions of a given size */
+        void allocate(uint32_t regionSize);
+
+        /* \brief Fence the region of the last frame and move to the next one, waiting for the GPU if needed */
+        void nextRegion();
+
+        uint32_t m_regionSize;
+        uint32_t m_framesInFlight;
+        bool     m_persistent;
+        GLuint   m_buffer = 0;
+        uint8_t* m_data   = NULL;         /*!< The persistent mapping of the whole buffer*/
+        std::vector<GLsync> m_fences;     /*!< One per region : set once the frame written in it was submitted*/
+        uint32_t m_region = 0;            /*!< Region of the current frame*/
+        uint32_t m_offset = 0;            /*!< First free byte in this region*/
+        uint64_t m_frame  = 0;            /*!< The frame the region belongs to*/
+        bool     m_mapped = false;        /*!< Mapped by the fallback path, until unmap()*/
+        uint32_t m_nbWaits = 0;
+
+        static uint64_t s_frame;
+};
+
+#endif
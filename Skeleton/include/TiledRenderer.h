@@ -0,0 +1,110 @@
+#ifndef  TILEDRENDERER_INC
+#define  TILEDRENDERER_INC
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <glm/glm.hpp>
+
+#include "Framebuffer.h"
+#include "ImageWriter.h"
+#include "JobSystem.h"
+
+//Pixel buffers the tiles are read in : a tile is mapped this many tiles after its glReadPixels, the GPU drawing the next ones meanwhile
+#define TILED_RENDERER_NB_BUFFERS 2
+
+//Tiles read back but not written yet. Past it, endTile() helps the workers, which bounds the memory to a few tiles whatever the poster
+#define TILED_RENDERER_MAX_PENDING 4
+
+/* \brief A tile of the image */
+struct RenderTile
+{
+    uint32_t  x;          /*!< Its left column in the image*/
+    uint32_t  y;          /*!< Its top row in the image*/
+    uint32_t  width;      /*!< Its size in pixels : the tile size, less on the right and bottom edges*/
+    uint32_t  height;
+    glm::mat4 projection; /*!< The part of the projection of the whole image it covers (an off-center frustum)*/
+};
+
+/* \brief Renders an image far larger than the window or any framebuffer (e.g. a 32768x32768 poster) a tile at a time.
+ * The perspective of the whole image is split in off-center frustums, one per tile, drawn in turn in the same framebuffer object.
+ * Each tile is read in a pixel buffer of a ring of TILED_RENDERER_NB_BUFFERS, mapped once the next one is drawn, then converted
+ * and written by the JobSystem straight to its place in a PPMStream : the GPU draws, the workers write and the image is never in memory.
+ * Usage : start(), then for each tile beginTile(), draw the scene with the projection of the tile, endTile(), and finish() */
+class TiledRenderer
+{
+    public:
+        TiledRenderer();
+
+        /* \brief Destructor. Finish the image */
+        ~TiledRenderer();
+
+        TiledRenderer(const TiledRenderer& copy) = delete;
+        TiledRenderer& operator=(const TiledRenderer& copy) = delete;
+
+        /* \brief Start an image, seen through glm::perspective(fovy, width/height, zNear, zFar)
+         * \param path the path of the image, a binary PPM
+         * \param width the width of the image in pixels
+         * \param height the height of the image in pixels
+         * \param tileSize the size of the square tiles, lowered to what the GL implementation can draw in
+         * \param fovy the vertical field of view in radians
+         * \param zNear the distance of the near plane
+         * \param zFar the distance of the far plane
+         * \return true if the image and the framebuffer could be created */
+        bool start(const char* path, uint32_t width, uint32_t height, uint32_t tileSize, float fovy, float zNear, float zFar);
+
+        /* \brief Start drawing a tile. Binds the framebuffer, sets the viewport to the tile and clears it
+         * \param tile the tile, row after row from the top left one
+         * \return the tile, with its projection */
+        const RenderTile& beginTile(uint32_t tile);
+
+        /* \brief Read the tile drawn. Hands the tile read TILED_RENDERER_NB_BUFFERS tiles ago to the workers */
+        void endTile();
+
+        /* \brief Read back the last tiles, wait for every tile to be written and close the image
+         * \return true if the whole image was written */
+        bool finish();
+
+        bool     isRendering() const {return m_rendering;}
+        uint32_t getNbTiles() const {return m_nbColumns*m_nbRows;}
+        uint32_t getNbColumns() const {return m_nbColumns;}
+        uint32_t getNbRows() const {return m_nbRows;}
+        uint32_t getTileSize() const {return m_tileSize;}
+
+    private:
+        /* \brief Map the pixel buffer of a tile, copy it and hand the copy to the workers */
+        void readBack(uint32_t buffer);
+
+        PPMStream             m_image;
+        std::string           m_path;
+        Framebuffer           m_target;       /*!< Every tile is drawn in it, kept from one image to the next*/
+        uint32_t              m_width = 0;
+        uint32_t              m_height = 0;
+        uint32_t              m_tileSize = 0;
+        uint32_t              m_nbColumns = 0;
+        uint32_t              m_nbRows = 0;
+        float                 m_left = 0.0f;  /*!< The frustum of the whole image, on the near plane*/
+        float                 m_right = 0.0f;
+        float                 m_bottom = 0.0f;
+        float                 m_top = 0.0f;
+        float                 m_near = 0.0f;
+        float                 m_far = 0.0f;
+        bool                  m_rendering = false;
+        std::chrono::steady_clock::time_point m_start;
+
+        RenderTile            m_current;      /*!< The tile being drawn*/
+        GLuint                m_buffers[TILED_RENDERER_NB_BUFFERS];
+        bool                  m_filled[TILED_RENDERER_NB_BUFFERS]; /*!< The buffer holds a tile not read back yet*/
+        RenderTile            m_tiles[TILED_RENDERER_NB_BUFFERS];  /*!< That tile*/
+        uint32_t              m_next = 0;     /*!< The buffer of the next tile*/
+
+        JobCounter            m_jobs;         /*!< The writing jobs in flight*/
+        std::atomic<uint32_t> m_nbPending;    /*!< Tiles read back, not written yet*/
+        std::atomic<bool>     m_failed;       /*!< A tile could not be read or written*/
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef  VERTEXFORMAT_INC
+#define  VERTEXFORMAT_INC
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include "Geometry.h"
+
+/* \brief Where and how one attribute is stored in a vertex buffer (the parameters of glVertexAttribPointer) */
+struct VertexAttribute
+{
+    GLint     size;       /*!< Number of components*/
+    GLenum    type;       /*!< Type of a component*/
+    GLboolean normalized; /*!< Are integer components mapped to [-1, 1] or [0, 1] ?*/
+    uint32_t  offset;     /*!< Offset in bytes of the first element in the buffer*/
+};
+
+/* \brief The layout of the vertex buffer of a geometry */
+struct VertexLayout
+{
+    VertexFormat    format;
+    uint32_t        stride;     /*!< Bytes between two consecutive elements of an attribute (0 : tightly packed)*/
+    uint32_t        size;       /*!< Size in bytes of the whole buffer*/
+    bool            octNormals; /*!< Are the normals two octahedral components the vertex shader has to decode ?*/
+    VertexAttribute position;
+    VertexAttribute normal;
+    VertexAttribute uv;
+};
+
+/* \brief Compute the layout of the vertex buffer of a geometry, from its vertex format
+ * \param geometry the geometry
+ * \return the layout */
+VertexLayout getVertexLayout(const Geometry& geometry);
+
+/* \brief Write the vertices of a geometry in a buffer with a given layout
+ * \param geometry the geometry
+ * \param layout the layout, from getVertexLayout
+ * \param dst the buffer, of layout.size bytes */
+void packVertices(const Geometry& geometry, const VertexLayout& layout, void* dst);
+
+/* \brief Configure the vertex attribute pointers of the bound VAO for a layout, the vertex buffer being bound to GL_ARRAY_BUFFER
+ * \param layout the layout
+ * \param positionLocation the location of the position attribute
+ * \param normalLocation the location of the normal attribute (-1 to skip it)
+ * \param uvLocation the location of the uv attribute (-1 to skip it) */
+void setVertexAttribPointers(const VertexLayout& layout, GLint positionLocation, GLint normalLocation, GLint uvLocation);
+
+/* \brief Convert a float to a IEEE 754 half float (round to nearest)
+ * \param value the float
+ * \return the bits of the half float */
+uint16_t floatToHalf(float value);
+
+#endif
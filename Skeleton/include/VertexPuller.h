@@ -0,0 +1,122 @@
+#ifndef  VERTEXPULLER_INC
+#define  VERTEXPULLER_INC
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <stdint.h>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Geometry.h"
+#include "VertexFormat.h"
+#include "MeshCache.h"
+#include "StreamBuffer.h"
+
+//Draws of one multi-draw (longer lists are split in batches of this size)
+#define VERTEX_PULLER_MAX_DRAWS 1024
+
+//Shader storage binding points (as declared in pulling.vert)
+#define VERTEX_PULLER_DATA_BINDING   0
+#define VERTEX_PULLER_MESHES_BINDING 1
+#define VERTEX_PULLER_DRAWS_BINDING  2
+
+//Location of the draw index attribute (the only vertex attribute of pulling.vert)
+#define VERTEX_PULLER_DRAW_LOCATION  3
+
+/* \brief One draw of a VertexPuller : a range of the indices of a mesh, with its transforms */
+struct PulledDraw
+{
+    uint32_t  mesh;       /*!< Handle from addMesh*/
+    uint32_t  firstIndex; /*!< First index of the range, in the indices of the mesh (in vertices for a non indexed mesh)*/
+    uint32_t  nbIndices;  /*!< Number of indices of the range*/
+    glm::mat4 mvp;        /*!< Model to clip space*/
+    glm::mat4 model;      /*!< Model to world space*/
+};
+
+/* \brief Programmable vertex pulling (GL 4.3).
+ * Every mesh lives in one shader storage buffer, vertices in their packed layout (planar, interleaved or compact) and indices
+ * (16 bits when the mesh is small enough). No vertex attribute points into it : pulling.vert reads the index of gl_VertexID,
+ * then decodes the position, normal and uv itself, from the description of the mesh.
+ * Each draw is a record (mesh, matrices) in a third buffer, selected through the only vertex attribute, instanced,
+ * whose value is the base instance of the draw. Meshes of any layout thus go out in one multi-draw, without any VAO or buffer switch. */
+class VertexPuller
+{
+    public:
+        /* \brief Constructor. The GL buffers are created by upload() */
+        VertexPuller();
+
+        /* \brief Destructor. Destroy the GL buffers */
+        ~VertexPuller();
+
+        VertexPuller(const VertexPuller& copy) = delete;
+        VertexPuller& operator=(const VertexPuller& copy) = delete;
+
+        /* \brief Add a mesh, packed in a given layout. It is on the GPU after the next upload()
+         * \param layout the layout of the vertices (float attributes, or the compact format)
+         * \param vertexData the packed vertices, layout.size bytes
+         * \param nbVertices the number of vertices
+         * \param indices the indices, or NULL if the mesh is not indexed
+         * \param nbIndices the number of indices
+         * \return the handle of the mesh, or -1 if the layout cannot be decoded by pulling.vert */
+        int addMesh(const VertexLayout& layout, const void* vertexData, uint32_t nbVertices, const uint32_t* indices, uint32_t nbIndices);
+
+        /* \brief Add a geometry, in its vertex format
+         * \return the handle of the mesh, or -1 on error */
+        int addMesh(const Geometry& geometry);
+
+        /* \brief Add a mesh of the mesh cache, as mapped
+         * \return the handle of the mesh, or -1 on error */
+        int addMesh(const CachedMesh& mesh);
+
+        /* \brief Send the meshes to the GPU (a GL context must be current)
+         * \return false if they do not fit in a shader storage block */
+        bool upload();
+
+        /* \brief Draw ranges of meshes in one multi-draw (in batches of VERTEX_PULLER_MAX_DRAWS).
+         * The shader (pulling.vert) must be in use with its other uniforms set
+         * \param draws the draws
+         * \param count the number of draws */
+        void draw(const PulledDraw* draws, uint32_t count);
+
+        /* \brief Tell if the context can pull vertices from shader storage buffers
+         * \return true if it can */
+        static bool isSupported();
+
+    private:
+        /* \brief How pulling.vert finds and decodes a mesh (std430 layout of MeshRecord in pulling.vert) */
+        struct MeshRecord
+        {
+            uint32_t positionWord; /*!< Offsets in 32 bits words of the first position, normal, uv and index*/
+            uint32_t normalWord;
+            uint32_t uvWord;
+            uint32_t indexWord;
+            uint32_t positionStride; /*!< Words between two vertices, per attribute*/
+            uint32_t normalStride;
+            uint32_t uvStride;
+            uint32_t flags;          /*!< MESH_* of VertexPuller.cpp*/
+        };
+
+        /* \brief One draw, as read by pulling.vert (std430 layout of DrawRecord in pulling.vert) */
+        struct DrawRecord
+        {
+            glm::mat4 mvp;
+            glm::mat4 model;
+            glm::mat4 normalMatrix; /*!< Transposed inverse of the model matrix, in the upper left corner*/
+            uint32_t  mesh;
+            uint32_t  padding[3];
+        };
+
+        std::vector<uint32_t>   m_words;  /*!< Vertices and indices of every mesh, as in the data buffer*/
+        std::vector<MeshRecord> m_meshes;
+
+        GLuint   m_VAO            = 0; /*!< Only the instanced draw index attribute*/
+        GLuint   m_dataBuffer     = 0;
+        GLuint   m_meshBuffer     = 0;
+        GLuint   m_indexBuffer    = 0; /*!< 0, 1, 2... : the value of the draw index attribute at each base instance*/
+        GLint    m_recordAlignment = 0; /*!< GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT*/
+
+        StreamBuffer m_drawStream;     /*!< The draw records of the frame*/
+        StreamBuffer m_indirectStream; /*!< Their DrawArraysIndirectCommand, 4 words each*/
+};
+
+#endif
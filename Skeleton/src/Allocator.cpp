@@ -0,0 +1,85 @@
+#include "Allocator.h"
+#include "logger.h"
+
+void* HeapAllocator::allocate(size_t size, size_t alignment)
+{
+    //Over allocate, and keep the pointer given by malloc just before the aligned block
+    uint8_t* raw = (uint8_t*)malloc(size + alignment + sizeof(void*));
+    if(raw == NULL)
+        return NULL;
+    uintptr_t aligned = ((uintptr_t)(raw + sizeof(void*)) + alignment-1) & ~(uintptr_t)(alignment-1);
+    ((void**)aligned)[-1] = raw;
+    return (void*)aligned;
+}
+
+void HeapAllocator::deallocate(void* ptr)
+{
+    if(ptr)
+        free(((void**)ptr)[-1]);
+}
+
+Arena::Arena(size_t chunkSize) : m_chunkSize(chunkSize)
+{}
+
+Arena::~Arena()
+{
+    for(uint32_t i = 0; i < m_chunks.size(); i++)
+        free(m_chunks[i].data);
+}
+
+void* Arena::allocate(size_t size, size_t alignment)
+{
+    //Fill the current chunk, then the next ones kept by a previous reset, then new ones
+    for(; m_marker.chunk < m_chunks.size(); m_marker.chunk++, m_marker.offset = 0)
+    {
+        const Chunk& chunk = m_chunks[m_marker.chunk];
+        uintptr_t start    = ((uintptr_t)(chunk.data + m_marker.offset) + alignment-1) & ~(uintptr_t)(alignment-1);
+        size_t offset      = start - (uintptr_t)chunk.data;
+        if(offset + size <= chunk.size)
+        {
+            m_marker.offset = offset + size;
+            return (void*)start;
+        }
+    }
+
+    size_t chunkSize = (size + alignment > m_chunkSize) ? size + alignment : m_chunkSize;
+    Chunk chunk = {(uint8_t*)malloc(chunkSize), chunkSize};
+    if(chunk.data == NULL)
+    {
+        ERROR("Arena : could not allocate a chunk of %lu bytes\n", (unsigned long)chunkSize);
+        return NULL;
+    }
+    m_chunks.push_back(chunk);
+
+    uintptr_t start = ((uintptr_t)chunk.data + alignment-1) & ~(uintptr_t)(alignment-1);
+    m_marker.chunk  = m_chunks.size()-1;
+    m_marker.offset = start - (uintptr_t)chunk.data + size;
+    return (void*)start;
+}
+
+size_t Arena::getCapacity() const
+{
+    size_t capacity = 0;
+    for(uint32_t i = 0; i < m_chunks.size(); i++)
+        capacity += m_chunks[i].size;
+    return capacity;
+}
+
+static HeapAllocator s_heapAllocator;
+static Allocator*    s_defaultAllocator = &s_heapAllocator;
+
+Allocator* getDefaultAllocator()
+{
+    return s_defaultAllocator;
+}
+
+void setDefaultAllocator(Allocator* allocator)
+{
+    s_defaultAllocator = (allocator != NULL) ? allocator : &s_heapAllocator;
+}
+
+Arena& getScratchArena()
+{
+    static thread_local Arena scratch;
+    return scratch;
+}
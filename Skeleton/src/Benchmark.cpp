@@ -0,0 +1,482 @@
+#include "Benchmark.h"
+#include "Sphere.h"
+#include "Icosphere.h"
+#include "CubeSphere.h"
+#include "Cylinder.h"
+#include "Cone.h"
+#include "Circle.h"
+#include "Parallel.h"
+#include "JobSystem.h"
+#include "PlanetNoise.h"
+#include "LODSphere.h"
+#include "FrameBuilder.h"
+#include "logger.h"
+#include <chrono>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//How many times each generator is run (the best time is kept)
+#define BENCHMARK_NB_RUNS 5
+
+MeshQuality measureSphereQuality(const Geometry& geometry)
+{
+    MeshQuality quality;
+    uint32_t nbCorners  = geometry.getIndices() ? geometry.getNbIndices() : geometry.getNbVertices();
+    quality.nbTriangles = nbCorners/3;
+    quality.nbVertices  = geometry.getNbVertices();
+    quality.minAngle    = 180.0f;
+    quality.meanQuality = 0.0f;
+    quality.maxError    = 0.0f;
+
+    float minArea = INFINITY, maxArea = 0.0f;
+    uint32_t nbMeasured = 0;
+    const float* vertices = geometry.getVertices();
+    for(uint32_t t = 0; t < quality.nbTriangles; t++)
+    {
+        glm::vec3 p[3];
+        for(uint32_t k = 0; k < 3; k++)
+        {
+            uint32_t v = geometry.getIndices() ? geometry.getIndices()[3*t+k] : 3*t+k;
+            p[k] = glm::vec3(vertices[3*v], vertices[3*v+1], vertices[3*v+2]);
+        }
+
+        float area = 0.5f*glm::length(glm::cross(p[1]-p[0], p[2]-p[0]));
+        if(area < 1e-12f) //Degenerated triangles (e.g. at the poles of Sphere) are not drawn : skip them
+            continue;
+
+        float sumEdges2 = 0.0f;
+        for(uint32_t k = 0; k < 3; k++)
+        {
+            glm::vec3 e0 = p[(k+1)%3] - p[k];
+            glm::vec3 e1 = p[(k+2)%3] - p[k];
+            float angle  = acosf(glm::clamp(glm::dot(glm::normalize(e0), glm::normalize(e1)), -1.0f, 1.0f)) * 180.0f/M_PI;
+            quality.minAngle = fminf(quality.minAngle, angle);
+            sumEdges2 += glm::dot(e0, e0);
+        }
+
+        quality.meanQuality += 4.0f*sqrtf(3.0f)*area / sumEdges2;
+        quality.maxError     = fmaxf(quality.maxError, 1.0f - glm::length((p[0]+p[1]+p[2])/3.0f)/0.5f);
+        minArea = fminf(minArea, area);
+        maxArea = fmaxf(maxArea, area);
+        nbMeasured++;
+    }
+
+    //Over the triangles measured : the degenerated ones would pull the mean down
+    if(nbMeasured > 0)
+        quality.meanQuality /= nbMeasured;
+    quality.areaRatio    = maxArea/minArea;
+    return quality;
+}
+
+template<typename T, typename P>
+static void benchmarkGenerator(const char* name, P parameter)
+{
+    double bestMs = INFINITY;
+    for(uint32_t i = 0; i < BENCHMARK_NB_RUNS; i++)
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        T geometry(parameter);
+        std::chrono::duration<double, std::milli> duration = std::chrono::high_resolution_clock::now() - start;
+        bestMs = fmin(bestMs, duration.count());
+
+        if(i == BENCHMARK_NB_RUNS-1)
+        {
+            MeshQuality q = measureSphereQuality(geometry);
+            printf("%-22s %10u %10u %10.3f %10.2f %10.3f %10.2f %10.5f\n", name, q.nbTriangles, q.nbVertices, bestMs,
+                   q.minAngle, q.meanQuality, q.areaRatio, q.maxError);
+        }
+    }
+}
+
+//Sphere takes two parameters
+struct SquareSphere : public Sphere
+{
+    SquareSphere(uint32_t resolution) : Sphere(resolution, resolution) {}
+};
+
+void benchmarkSphereGenerators()
+{
+    INFO("Sphere generators at equal triangle counts (best of %d runs)\n", BENCHMARK_NB_RUNS);
+    printf("%-22s %10s %10s %10s %10s %10s %10s %10s\n", "Generator", "Triangles", "Vertices", "Time (ms)",
+           "Min angle", "Quality", "Area ratio", "Max error");
+
+    for(uint32_t subdivisions = 2; subdivisions <= 7; subdivisions++)
+    {
+        //Parameters giving the closest triangle count to the icosphere's 20*4^n
+        double   nbTriangles = 20.0*pow(4.0, subdivisions);
+        uint32_t uvRes       = (uint32_t)(sqrt(nbTriangles/2.0) + 1.5);
+        uint32_t cubeRes     = (uint32_t)(sqrt(nbTriangles/12.0) + 0.5);
+
+        char name[64];
+        sprintf(name, "Sphere(%u, %u)", uvRes, uvRes);
+        benchmarkGenerator<SquareSphere>(name, uvRes);
+        sprintf(name, "Icosphere(%u)", subdivisions);
+        benchmarkGenerator<Icosphere>(name, subdivisions);
+        sprintf(name, "CubeSphere(%u)", cubeRes);
+        benchmarkGenerator<CubeSphere>(name, cubeRes);
+        printf("\n");
+    }
+}
+
+//Best time in milliseconds of a generator, on the current number of workers
+template<typename F>
+static double timeGenerator(F generate, uint32_t& nbVertices)
+{
+    double bestMs = INFINITY;
+    for(uint32_t i = 0; i < BENCHMARK_NB_RUNS; i++)
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        Geometry geometry = generate();
+        std::chrono::duration<double, std::milli> duration = std::chrono::high_resolution_clock::now() - start;
+        bestMs     = fmin(bestMs, duration.count());
+        nbVertices = geometry.getNbVertices();
+    }
+    return bestMs;
+}
+
+template<typename F>
+static void benchmarkMeshGenerator(const char* name, F generate)
+{
+    uint32_t nbWorkers = getNbWorkers();
+    uint32_t nbVertices = 0;
+
+    setNbWorkers(1);
+    double serialMs = timeGenerator(generate, nbVertices);
+    setNbWorkers(nbWorkers);
+    double parallelMs = timeGenerator(generate, nbVertices);
+
+    printf("%-22s %10u %12.3f %12.3f %10.2f %12.1f\n", name, nbVertices, serialMs, parallelMs, serialMs/parallelMs,
+           nbVertices/(parallelMs*1e3));
+}
+
+void benchmarkMeshGenerators()
+{
+    INFO("Mesh generators on 1 and %u worker threads (best of %d runs)\n", getNbWorkers(), BENCHMARK_NB_RUNS);
+    printf("%-22s %10s %12s %12s %10s %12s\n", "Generator", "Vertices", "1 thread", "All threads", "Speedup", "Mvertices/s");
+
+    uint32_t sphereRes[] = {256, 1024, 2048};
+    for(uint32_t i = 0; i < sizeof(sphereRes)/sizeof(sphereRes[0]); i++)
+    {
+        uint32_t res = sphereRes[i];
+        char name[64];
+        sprintf(name, "Sphere(%u, %u)", res, res);
+        benchmarkMeshGenerator(name, [res]() {return Sphere(res, res);});
+    }
+
+    uint32_t nbEdges[] = {1 << 16, 1 << 20};
+    for(uint32_t i = 0; i < sizeof(nbEdges)/sizeof(nbEdges[0]); i++)
+    {
+        uint32_t n = nbEdges[i];
+        char name[64];
+        sprintf(name, "Cylinder(%u)", n);
+        benchmarkMeshGenerator(name, [n]() {return Cylinder(n);});
+        sprintf(name, "Cone(%u, 0.5)", n);
+        benchmarkMeshGenerator(name, [n]() {return Cone(n, 0.5f);});
+        sprintf(name, "Circle(%u)", n);
+        benchmarkMeshGenerator(name, [n]() {return Circle(n);});
+    }
+}
+
+void benchmarkPlanetNoise()
+{
+    PlanetNoiseParams params;
+    params.octaves = 8;
+    INFO("Planet relief, %u octaves (best of %d runs)\n", params.octaves, BENCHMARK_NB_RUNS);
+    printf("%-22s %12s %12s\n", "Path", "Time (ms)", "Msamples/s");
+
+    //Points spread over the sphere
+    const uint32_t nbSamples = 1 << 18;
+    std::vector<float> x(nbSamples), y(nbSamples), z(nbSamples), heights(nbSamples);
+    for(uint32_t i = 0; i < nbSamples; i++)
+    {
+        float phi   = acosf(1.0f - 2.0f*(i + 0.5f)/nbSamples);
+        float theta = i*2.39996323f;
+        x[i] = sinf(phi)*cosf(theta);
+        y[i] = cosf(phi);
+        z[i] = sinf(phi)*sinf(theta);
+    }
+
+    PlanetNoise noise(params);
+    double scalarMs = INFINITY, batchMs = INFINITY;
+    for(uint32_t run = 0; run < BENCHMARK_NB_RUNS; run++)
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        for(uint32_t i = 0; i < nbSamples; i++)
+            heights[i] = noise.sample(glm::vec3(x[i], y[i], z[i]));
+        std::chrono::duration<double, std::milli> duration = std::chrono::high_resolution_clock::now() - start;
+        scalarMs = fmin(scalarMs, duration.count());
+
+        start = std::chrono::high_resolution_clock::now();
+        noise.sample(&x[0], &y[0], &z[0], &heights[0], nbSamples);
+        duration = std::chrono::high_resolution_clock::now() - start;
+        batchMs = fmin(batchMs, duration.count());
+    }
+    printf("%-22s %12.3f %12.2f\n", "Scalar, 1 thread", scalarMs, nbSamples/(scalarMs*1e3));
+    printf("%-22s %12.3f %12.2f\n", "Batch, 1 thread", batchMs, nbSamples/(batchMs*1e3));
+
+    //Tiles of a whole quadtree level, generated over the workers. A fresh cache each run, so that nothing is reused
+    const uint32_t depth = 4;
+    std::vector<uint64_t> keys;
+    for(uint32_t face = 0; face < 6; face++)
+        for(uint32_t iy = 0; iy < (1u << depth); iy++)
+            for(uint32_t ix = 0; ix < (1u << depth); ix++)
+                keys.push_back(PlanetNoise::getTileKey(face, depth, ix, iy));
+
+    double tilesMs = INFINITY;
+    uint32_t tileSamples = 0;
+    for(uint32_t run = 0; run < BENCHMARK_NB_RUNS; run++)
+    {
+        PlanetNoise tiles(params, 33, keys.size());
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        tiles.prefetchTiles(keys);
+        std::chrono::duration<double, std::milli> duration = std::chrono::high_resolution_clock::now() - start;
+        tilesMs = fmin(tilesMs, duration.count());
+        tileSamples = keys.size() * (tiles.getTileResolution()+2) * (tiles.getTileResolution()+2);
+    }
+    char name[64];
+    sprintf(name, "Tiles, %u threads", getNbWorkers());
+    printf("%-22s %12.3f %12.2f\n", name, tilesMs, tileSamples/(tilesMs*1e3));
+}
+
+void benchmarkFramePreparation(uint32_t nbNodes)
+{
+    //Only the level ranges : build() never touches the vertices
+    LODSphere lod(8, 256, NULL, false);
+    MeshRange mesh = {0, 0, 0, 0};
+    FrameBuilder builder(lod, mesh);
+
+    //A ring around the camera, a third of it in the frustum, under one turning root
+    FrameNode root;
+    root.drawn = false;
+    uint32_t rootNode = builder.addNode(root);
+    for(uint32_t i = 0; i < nbNodes; i++)
+    {
+        FrameNode node;
+        node.parent = rootNode;
+        float theta = i*2.39996323f;
+        float radius = 20.0f + 10.0f*(i + 0.5f)/nbNodes;
+        node.propagatedMatrix = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(radius*cosf(theta), 0.0f, radius*sinf(theta))), glm::vec3(0.05f));
+        builder.addNode(node);
+    }
+
+    glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 5.0f, 25.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+    DrawCommandBuilder commands;
+    std::vector<glm::vec4> drawData;
+
+    INFO("Frame preparation of %u nodes (best of %d runs)\n", nbNodes, BENCHMARK_NB_RUNS);
+    printf("%-22s %12s %12s %10s\n", "Workers", "Time (ms)", "Draws", "Speedup");
+
+    uint32_t nbWorkers = getNbWorkers();
+    double serialMs = 0.0;
+    for(uint32_t workers = 1; ; workers = std::min(2*workers, nbWorkers))
+    {
+        setNbWorkers(workers);
+        double bestMs = INFINITY;
+        for(uint32_t run = 0; run < BENCHMARK_NB_RUNS; run++)
+        {
+            builder.setNode(rootNode, glm::rotate(glm::mat4(1.0f), 0.01f*run, glm::vec3(0.0f, 1.0f, 0.0f)), glm::mat4(1.0f));
+            std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+            builder.build(view, projection, 1000.0f, commands, drawData);
+            std::chrono::duration<double, std::milli> duration = std::chrono::high_resolution_clock::now() - start;
+            bestMs = fmin(bestMs, duration.count());
+        }
+        if(workers == 1)
+            serialMs = bestMs;
+        printf("%-22u %12.3f %12u %10.2f\n", workers, bestMs, builder.getNbDraws(), serialMs/bestMs);
+        if(workers == nbWorkers)
+            break;
+    }
+    setNbWorkers(nbWorkers);
+}
+
+/* \brief The reference of benchmarkJobSystem : threads taking their jobs from one locked queue, the caller blocking in wait() */
+class NaiveThreadPool
+{
+    public:
+        NaiveThreadPool(uint32_t nbThreads)
+        {
+            for(uint32_t i = 0; i < nbThreads; i++)
+                m_threads.push_back(std::thread(&NaiveThreadPool::loop, this));
+        }
+
+        ~NaiveThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_quit = true;
+            }
+            m_jobCondition.notify_all();
+            for(uint32_t i = 0; i < m_threads.size(); i++)
+                m_threads[i].join();
+        }
+
+        void run(const std::function<void()>& job)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_jobs.push_back(job);
+                m_nbPending++;
+            }
+            m_jobCondition.notify_one();
+        }
+
+        /* \brief Wait until every job, and the jobs they started, are done */
+        void wait()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_doneCondition.wait(lock, [this]() {return m_nbPending == 0;});
+        }
+
+    private:
+        void loop()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while(true)
+            {
+                m_jobCondition.wait(lock, [this]() {return m_quit || !m_jobs.empty();});
+                if(m_quit)
+                    return;
+                std::function<void()> job = m_jobs.front();
+                m_jobs.pop_front();
+
+                lock.unlock();
+                job();
+                lock.lock();
+                if(--m_nbPending == 0)
+                    m_doneCondition.notify_all();
+            }
+        }
+
+        std::vector<std::thread>          m_threads;
+        std::mutex                        m_mutex;
+        std::condition_variable           m_jobCondition;
+        std::condition_variable           m_doneCondition;
+        std::deque<std::function<void()> > m_jobs;
+        uint32_t                          m_nbPending = 0;
+        bool                              m_quit = false;
+};
+
+//Some work which the compiler cannot remove : n steps of xorshift
+static uint32_t spinWork(uint32_t seed, uint32_t n)
+{
+    uint32_t x = seed | 1;
+    for(uint32_t i = 0; i < n; i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+    }
+    return x;
+}
+
+//Best time in milliseconds of a function
+template<typename F>
+static double timeBest(F function)
+{
+    double bestMs = INFINITY;
+    for(uint32_t run = 0; run < BENCHMARK_NB_RUNS; run++)
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        function();
+        std::chrono::duration<double, std::milli> duration = std::chrono::high_resolution_clock::now() - start;
+        bestMs = fmin(bestMs, duration.count());
+    }
+    return bestMs;
+}
+
+//A binary tree of jobs, each starting its two children : the spawning is spread over the workers
+template<typename R>
+static void spawnTree(R runJob, uint32_t depth, uint32_t node, std::vector<uint32_t>& results)
+{
+    if(depth == 0)
+    {
+        results[node] = spinWork(node, 200);
+        return;
+    }
+    runJob([=, &results]() {spawnTree(runJob, depth-1, 2*node, results);});
+    runJob([=, &results]() {spawnTree(runJob, depth-1, 2*node+1, results);});
+}
+
+void benchmarkJobSystem()
+{
+    uint32_t nbWorkers = getNbWorkers();
+    JobSystem& jobs = JobSystem::getShared();
+    NaiveThreadPool pool(nbWorkers);
+
+    INFO("Work-stealing JobSystem against one locked queue, %u workers (best of %d runs)\n", nbWorkers, BENCHMARK_NB_RUNS);
+    printf("%-26s %12s %12s %10s\n", "Test", "Queue (ms)", "Stealing (ms)", "Ratio");
+
+    //Many small independent jobs, all started by the calling thread
+    const uint32_t nbJobs = 1 << 16;
+    std::vector<uint32_t> results(nbJobs);
+    double queueMs = timeBest([&]()
+    {
+        for(uint32_t i = 0; i < nbJobs; i++)
+            pool.run([i, &results]() {results[i] = spinWork(i, 200);});
+        pool.wait();
+    });
+    double stealingMs = timeBest([&]()
+    {
+        JobCounter counter;
+        for(uint32_t i = 0; i < nbJobs; i++)
+            jobs.run([i, &results]() {results[i] = spinWork(i, 200);}, &counter);
+        jobs.wait(counter);
+    });
+    printf("%-26s %12.3f %12.3f %10.2f\n", "Small jobs", queueMs, stealingMs, queueMs/stealingMs);
+
+    //Jobs starting jobs : the queue takes every one of them through its lock
+    const uint32_t depth = 16;
+    std::vector<uint32_t> leaves(1 << depth);
+    queueMs = timeBest([&]()
+    {
+        spawnTree([&pool](const std::function<void()>& job) {pool.run(job);}, depth, 0, leaves);
+        pool.wait();
+    });
+    stealingMs = timeBest([&]()
+    {
+        JobCounter counter;
+        spawnTree([&jobs, &counter](const std::function<void()>& job) {jobs.run(job, &counter);}, depth, 0, leaves);
+        jobs.wait(counter);
+    });
+    printf("%-26s %12.3f %12.3f %10.2f\n", "Spawn tree", queueMs, stealingMs, queueMs/stealingMs);
+
+    //A loop whose cost grows along the range : the queue gets one job per worker, as the bands of a static split
+    const uint32_t nbIndices = 1 << 16;
+    std::vector<uint32_t> loop(nbIndices);
+    std::function<void(uint32_t, uint32_t)> body = [&loop](uint32_t first, uint32_t last)
+    {
+        for(uint32_t i = first; i < last; i++)
+            loop[i] = spinWork(i, i >> 6);
+    };
+    queueMs = timeBest([&]()
+    {
+        for(uint32_t b = 0; b < nbWorkers; b++)
+            pool.run([&body, b, nbWorkers]() {body((uint64_t)b*nbIndices/nbWorkers, (uint64_t)(b+1)*nbIndices/nbWorkers);});
+        pool.wait();
+    });
+    stealingMs = timeBest([&]() {jobs.parallelFor(0, nbIndices, 64, body);});
+    printf("%-26s %12.3f %12.3f %10.2f\n", "Unbalanced loop", queueMs, stealingMs, queueMs/stealingMs);
+
+    //Where the jobs of the loop ran, from the profiler hook
+    std::vector<std::atomic<uint32_t> > nbRun(nbWorkers+1);
+    std::vector<std::atomic<uint64_t> > busyNs(nbWorkers+1);
+    jobs.setProfilerHook([&](const JobEvent& event)
+    {
+        uint32_t worker = event.worker == JOB_EXTERNAL_WORKER ? nbWorkers : event.worker;
+        nbRun[worker]++;
+        busyNs[worker] += event.endNs - event.beginNs;
+    });
+    jobs.parallelFor(0, nbIndices, 64, body, "Unbalanced loop");
+    jobs.setProfilerHook(JobProfilerHook());
+
+    printf("\n%-26s %12s %12s\n", "Worker", "Jobs", "Busy (ms)");
+    for(uint32_t w = 0; w < nbWorkers; w++)
+        printf("%-26u %12u %12.3f\n", w, nbRun[w].load(), busyNs[w].load()*1e-6);
+}
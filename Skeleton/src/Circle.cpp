@@ -1,31 +1,45 @@
 #include "Circle.h"
+#include "Parallel.h"
 
-Circle::Circle(uint32_t nbEdge) : Geometry()
+//Smallest number of vertices worth a worker thread
+#define CIRCLE_MIN_BAND_VERTICES 16384
+
+Circle::Circle(uint32_t nbEdge, Allocator* allocator) : Geometry(allocator)
 {
-	m_vertices = (float*)malloc(9*nbEdge*sizeof(float));
-    m_uvs      = (float*)malloc(6*nbEdge*sizeof(float));
-	m_normals  = (float*)malloc(9*nbEdge*sizeof(float));
-    m_nbVertices = 3*nbEdge;
+    allocate(3*nbEdge, 0);
 
-	for(uint32_t i=0; i < nbEdge; i++)
-	{
-		float pos[] = {(float)cos(i*2*M_PI/nbEdge), (float)sin(i*2*M_PI/nbEdge), 0.0f,
-                       0.0f, 0.0f, 0.0f,
-                       (float)cos((i+1)*2*M_PI/nbEdge), (float)sin((i+1)*2*M_PI/nbEdge), 0.0f};
+    //cos/sin of every edge, computed once
+    ScratchScope scratch;
+    float* cosTable = scratch.allocate<float>(nbEdge+1);
+    float* sinTable = scratch.allocate<float>(nbEdge+1);
+    for(uint32_t i = 0; i <= nbEdge; i++)
+    {
+        cosTable[i] = cos(i*2*M_PI/nbEdge);
+        sinTable[i] = sin(i*2*M_PI/nbEdge);
+    }
 
-		for(uint32_t j=0; j < 9; j++)
+    parallelFor(0, nbEdge, CIRCLE_MIN_BAND_VERTICES/3, [&](uint32_t first, uint32_t last)
+    {
+        for(uint32_t i = first; i < last; i++)
         {
-			m_vertices[9*i+j] = 0.5*pos[j];
-        }
-        for(uint32_t j=0; j < 3; j++)
-            for(uint32_t k = 0; k < 2; k++)
-                m_uvs[6*i+2*j+k] = m_vertices[9*i+3*j+k]+0.5;
+            float pos[] = {cosTable[i],   sinTable[i],   0.0f,
+                           0.0f,          0.0f,          0.0f,
+                           cosTable[i+1], sinTable[i+1], 0.0f};
 
-        for(uint32_t j=0; j < 3; j++)
-        {
-            float normal[] = {0.0, 0.0, 1.0};
-            for(uint32_t k=0; k < 3; k++)
-                m_normals[9*i+3*j+k] = normal[k];
+            for(uint32_t j=0; j < 9; j++)
+            {
+                m_vertices[9*i+j] = 0.5*pos[j];
+            }
+            for(uint32_t j=0; j < 3; j++)
+                for(uint32_t k = 0; k < 2; k++)
+                    m_uvs[6*i+2*j+k] = m_vertices[9*i+3*j+k]+0.5;
+
+            for(uint32_t j=0; j < 3; j++)
+            {
+                float normal[] = {0.0, 0.0, 1.0};
+                for(uint32_t k=0; k < 3; k++)
+                    m_normals[9*i+3*j+k] = normal[k];
+            }
         }
-	}
+    });
 }
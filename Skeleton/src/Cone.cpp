@@ -1,55 +1,72 @@
 #include "Cone.h"
+#include "Parallel.h"
 #include "logger.h"
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp> 
 
-Cone::Cone(uint32_t nbLattitude, float topRadius) : Geometry()
+//Smallest number of vertices worth a worker thread
+#define CONE_MIN_BAND_VERTICES 16384
+
+Cone::Cone(uint32_t nbLattitude, float topRadius, Allocator* allocator) : Geometry(allocator)
 {
     float radius = 0.5;
-    m_nbVertices = nbLattitude * 6;
-    m_vertices   = (float*)malloc(sizeof(float)*3*6*nbLattitude);
-    m_normals    = (float*)malloc(sizeof(float)*3*6*nbLattitude);
-    m_uvs        = (float*)malloc(sizeof(float)*2*6*nbLattitude);
-
-	for(uint32_t i=0; i < nbLattitude; i++)
-	{
-		double pos[] = {radius*cos(i*2*M_PI/nbLattitude),        radius*sin(i*2*M_PI/nbLattitude), -1.0/2,
-					    radius*cos((i+1)*2*M_PI/nbLattitude),    radius*sin((i+1)*2*M_PI/nbLattitude), -1.0/2,
-					    topRadius*cos((i+1)*2*M_PI/nbLattitude), topRadius*sin((i+1)*2*M_PI/nbLattitude), 1.0/2,
-
-					    radius*cos(i*2*M_PI/nbLattitude),        radius*sin(i*2*M_PI/nbLattitude), -1.0/2,
-					    topRadius*cos((i+1)*2*M_PI/nbLattitude), topRadius*sin((i+1)*2*M_PI/nbLattitude), 1.0/2,
-					    topRadius*cos(i*2*M_PI/nbLattitude),     topRadius*sin(i*2*M_PI/nbLattitude), 1.0/2
-					   };
-
-		double uvPos[] = {
-                         i/(double)nbLattitude,   0.0,
-					     (i+1)/(double)nbLattitude, 0.0,
-					     (i+1)/(double)nbLattitude, 1.0,
-
-					     i/(double)nbLattitude,     0.0,
-					     (i+1)/(double)nbLattitude, 1.0,
-					     i/(double)nbLattitude,    1.0
-					     };
-
-		for(uint32_t j=0; j < 18; j++)
-			m_vertices[18*i+j] = pos[j];
-
-        for(uint32_t j = 0; j < 12; j++)
-            m_uvs[12*i+j] = uvPos[j];
-
-        float angle        = atan2(1.0-topRadius, 1.0);
-        glm::vec3 normalI  = glm::rotate(glm::mat4(1.0f), (float)(i*2*M_PI/nbLattitude), glm::vec3(0.0, 0.0, 1.0))           * glm::vec4(cos(angle), 0.0, sin(angle), 1.0f);
-        glm::vec3 normalI2 = glm::rotate(glm::mat4(1.0f), (float)((i+1.0f)*2.0f*M_PI/nbLattitude), glm::vec3(0.0, 0.0, 1.0)) * glm::vec4(cos(angle), 0.0, sin(angle), 1.0f);
-
-        for(uint32_t j = 0; j < 3; j++)
+    allocate(nbLattitude * 6, 0);
+
+    //cos/sin of every edge of the circles, computed once
+    ScratchScope scratch;
+    float* cosTable = scratch.allocate<float>(nbLattitude+1);
+    float* sinTable = scratch.allocate<float>(nbLattitude+1);
+    for(uint32_t i = 0; i <= nbLattitude; i++)
+    {
+        cosTable[i] = cos(i*2*M_PI/nbLattitude);
+        sinTable[i] = sin(i*2*M_PI/nbLattitude);
+    }
+
+    //The normals of a side are (cos(angle), 0, sin(angle)) rotated around z
+    float angle    = atan2(1.0-topRadius, 1.0);
+    float cosAngle = cos(angle);
+    float sinAngle = sin(angle);
+
+    parallelFor(0, nbLattitude, CONE_MIN_BAND_VERTICES/6, [&](uint32_t first, uint32_t last)
+    {
+        for(uint32_t i = first; i < last; i++)
         {
-            m_normals[18*i+0+j]  = normalI[j];
-            m_normals[18*i+3+j]  = normalI2[j];
-            m_normals[18*i+6+j]  = normalI2[j];
-            m_normals[18*i+9+j]  = normalI[j];
-            m_normals[18*i+12+j] = normalI2[j];
-            m_normals[18*i+15+j] = normalI[j];
+            float pos[] = {radius*cosTable[i],      radius*sinTable[i],      -1.0f/2,
+                           radius*cosTable[i+1],    radius*sinTable[i+1],    -1.0f/2,
+                           topRadius*cosTable[i+1], topRadius*sinTable[i+1],  1.0f/2,
+
+                           radius*cosTable[i],      radius*sinTable[i],      -1.0f/2,
+                           topRadius*cosTable[i+1], topRadius*sinTable[i+1],  1.0f/2,
+                           topRadius*cosTable[i],   topRadius*sinTable[i],    1.0f/2
+                          };
+
+            float u0 = i/(double)nbLattitude, u1 = (i+1)/(double)nbLattitude;
+            float uvPos[] = {
+                             u0, 0.0f,
+                             u1, 0.0f,
+                             u1, 1.0f,
+
+                             u0, 0.0f,
+                             u1, 1.0f,
+                             u0, 1.0f
+                            };
+
+            for(uint32_t j=0; j < 18; j++)
+                m_vertices[18*i+j] = pos[j];
+
+            for(uint32_t j = 0; j < 12; j++)
+                m_uvs[12*i+j] = uvPos[j];
+
+            float normalI[]  = {cosAngle*cosTable[i],   cosAngle*sinTable[i],   sinAngle};
+            float normalI2[] = {cosAngle*cosTable[i+1], cosAngle*sinTable[i+1], sinAngle};
+
+            for(uint32_t j = 0; j < 3; j++)
+            {
+                m_normals[18*i+0+j]  = normalI[j];
+                m_normals[18*i+3+j]  = normalI2[j];
+                m_normals[18*i+6+j]  = normalI2[j];
+                m_normals[18*i+9+j]  = normalI[j];
+                m_normals[18*i+12+j] = normalI2[j];
+                m_normals[18*i+15+j] = normalI[j];
+            }
         }
-	}
+    });
 }
@@ -1,10 +1,8 @@
 #include "Cube.h"
 
-Cube::Cube() : Geometry()
+Cube::Cube(Allocator* allocator) : Geometry(allocator)
 {
-    m_vertices = (float*)malloc(sizeof(float)*3*36);
-    m_normals  = (float*)malloc(sizeof(float)*3*36);
-    m_uvs      = (float*)malloc(sizeof(float)*2*36);
+    allocate(36, 0);
 
     float vertices[3*36] = {
                             //Front
@@ -159,5 +157,4 @@ Cube::Cube() : Geometry()
     }
     for(uint32_t i = 0; i < 2*36; i++)
         m_uvs[i] = uvs[i];
-    m_nbVertices = 36;
 }
@@ -0,0 +1,57 @@
+#include "CubeSphere.h"
+
+CubeSphere::CubeSphere(uint32_t resolution, Allocator* allocator) : SphericalGeometry(allocator)
+{
+    //For each face : its normal, and the two axes its grid goes along
+    const glm::vec3 faces[6][3] = {{glm::vec3( 1, 0, 0), glm::vec3( 0, 0,-1), glm::vec3(0, 1, 0)},
+                                   {glm::vec3(-1, 0, 0), glm::vec3( 0, 0, 1), glm::vec3(0, 1, 0)},
+                                   {glm::vec3( 0, 1, 0), glm::vec3( 1, 0, 0), glm::vec3(0, 0,-1)},
+                                   {glm::vec3( 0,-1, 0), glm::vec3( 1, 0, 0), glm::vec3(0, 0, 1)},
+                                   {glm::vec3( 0, 0, 1), glm::vec3( 1, 0, 0), glm::vec3(0, 1, 0)},
+                                   {glm::vec3( 0, 0,-1), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0)}};
+
+    std::vector<glm::vec3> directions;
+    std::vector<uint32_t>  triangles;
+    directions.reserve(6*(resolution+1)*(resolution+1));
+    triangles.reserve(36*resolution*resolution);
+
+    for(uint32_t f = 0; f < 6; f++)
+    {
+        uint32_t first = directions.size();
+        for(uint32_t j = 0; j <= resolution; j++)
+        {
+            for(uint32_t i = 0; i <= resolution; i++)
+            {
+                //Equal-angle warp : tan maps evenly spaced angles to the face
+                float a = tan((2.0*i/resolution - 1.0) * M_PI/4);
+                float b = tan((2.0*j/resolution - 1.0) * M_PI/4);
+                directions.push_back(glm::normalize(faces[f][0] + a*faces[f][1] + b*faces[f][2]));
+            }
+        }
+
+        for(uint32_t j = 0; j < resolution; j++)
+        {
+            for(uint32_t i = 0; i < resolution; i++)
+            {
+                uint32_t v00 = first + j*(resolution+1) + i;
+                uint32_t v10 = v00 + 1;
+                uint32_t v01 = v00 + resolution+1;
+                uint32_t v11 = v01 + 1;
+
+                //Split the cell along its shorter diagonal
+                if(glm::length(directions[v00] - directions[v11]) <= glm::length(directions[v10] - directions[v01]))
+                {
+                    uint32_t t[] = {v00, v10, v11, v00, v11, v01};
+                    triangles.insert(triangles.end(), t, t+6);
+                }
+                else
+                {
+                    uint32_t t[] = {v00, v10, v01, v10, v11, v01};
+                    triangles.insert(triangles.end(), t, t+6);
+                }
+            }
+        }
+    }
+
+    build(directions, triangles);
+}
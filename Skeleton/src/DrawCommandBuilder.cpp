@@ -0,0 +1,25 @@
+#include "DrawCommandBuilder.h"
+
+DrawCommandBuilder::DrawCommandBuilder() : m_stream(1024*sizeof(DrawElementsIndirectCommand))
+{}
+
+DrawCommandBuilder::~DrawCommandBuilder()
+{}
+
+void DrawCommandBuilder::add(const MeshRange& mesh, uint32_t firstIndex, uint32_t nbIndices, uint32_t drawID)
+{
+    DrawElementsIndirectCommand command;
+    command.count         = nbIndices;
+    command.instanceCount = 1;
+    command.firstIndex    = mesh.firstIndex + firstIndex;
+    command.baseVertex    = mesh.baseVertex;
+    command.baseInstance  = drawID;
+    m_commands.push_back(command);
+}
+
+GLuint DrawCommandBuilder::upload(GLintptr* offset)
+{
+    //In the region of the current frame : the draws of the previous frames may still be read by the GPU
+    *offset = m_stream.write(&m_commands[0], m_commands.size()*sizeof(DrawElementsIndirectCommand));
+    return m_stream.getBuffer();
+}
@@ -0,0 +1,138 @@
+#include "FrameBuilder.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cstring>
+
+FrameBuilder::FrameBuilder(const LODSphere& lod, const MeshRange& mesh) : m_lod(lod), m_mesh(mesh)
+{}
+
+uint32_t FrameBuilder::addNode(const FrameNode& node)
+{
+    uint32_t depth = node.parent < 0 ? 0 : m_depths[node.parent]+1;
+    if(depth >= m_depthNodes.size())
+        m_depthNodes.resize(depth+1);
+    m_depthNodes[depth].push_back(m_nodes.size());
+    m_depths.push_back(depth);
+
+    //No level yet : the first selection has no hysteresis
+    m_lodLevels.push_back(0xffffffff);
+    m_nodes.push_back(node);
+    return m_nodes.size()-1;
+}
+
+void FrameBuilder::setNode(uint32_t node, const glm::mat4& propagatedMatrix, const glm::mat4& localMatrix)
+{
+    m_nodes[node].propagatedMatrix = propagatedMatrix;
+    m_nodes[node].localMatrix      = localMatrix;
+}
+
+void FrameBuilder::build(const glm::mat4& view, const glm::mat4& projection, float viewportHeight, DrawCommandBuilder& commands, std::vector<glm::vec4>& drawData)
+{
+    uint32_t nbNodes = m_nodes.size();
+    m_propagated.resize(nbNodes);
+    m_world.resize(nbNodes);
+
+    //World matrices : a depth only needs the one before it, its nodes are independent
+    for(uint32_t d = 0; d < m_depthNodes.size(); d++)
+    {
+        const std::vector<uint32_t>& nodes = m_depthNodes[d];
+        parallelFor(0, nodes.size(), 1024, [&](uint32_t first, uint32_t last)
+        {
+            for(uint32_t i = first; i < last; i++)
+            {
+                uint32_t n = nodes[i];
+                const FrameNode& node = m_nodes[n];
+                m_propagated[n] = node.parent < 0 ? node.propagatedMatrix : m_propagated[node.parent] * node.propagatedMatrix;
+                m_world[n]      = m_propagated[n] * node.localMatrix;
+            }
+        }, "World matrices");
+    }
+
+    glm::mat4 viewMatrix = glm::inverse(view);
+    glm::mat4 viewProjection = projection * viewMatrix;
+    glm::vec3 camera = glm::vec3(view[3]);
+
+    //Frustum planes of the view-projection (a point p is inside if dot(plane, (p, 1)) >= 0 for the 6 of them)
+    glm::mat4 m = glm::transpose(viewProjection);
+    glm::vec4 planes[6] = {m[3]+m[0], m[3]-m[0], m[3]+m[1], m[3]-m[1], m[3]+m[2], m[3]-m[2]};
+    for(uint32_t i = 0; i < 6; i++)
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+
+    //Culling, level of detail and draw data : each chunk appends to its own lists, nothing is shared
+    uint32_t nbChunks = (nbNodes + FRAME_BUILDER_CHUNK_SIZE-1) / FRAME_BUILDER_CHUNK_SIZE;
+    m_chunks.resize(nbChunks);
+    parallelFor(0, nbChunks, 1, [&](uint32_t first, uint32_t last)
+    {
+        for(uint32_t c = first; c < last; c++)
+        {
+            Chunk& chunk = m_chunks[c];
+            chunk.commands.clear();
+            chunk.drawData.clear();
+
+            uint32_t end = std::min(nbNodes, (c+1)*FRAME_BUILDER_CHUNK_SIZE);
+            for(uint32_t n = c*FRAME_BUILDER_CHUNK_SIZE; n < end; n++)
+            {
+                if(!m_nodes[n].drawn)
+                    continue;
+
+                const glm::mat4& model = m_world[n];
+                glm::vec3 center = glm::vec3(model[3]);
+                float radius = 0.5f*std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+
+                bool inside = true;
+                for(uint32_t p = 0; p < 6 && inside; p++)
+                    inside = glm::dot(glm::vec3(planes[p]), center) + planes[p].w >= -radius;
+                if(!inside)
+                    continue;
+
+                float screenRadius = LODSphere::computeScreenRadius(model, camera, projection, viewportHeight);
+                m_lodLevels[n] = m_lod.selectLevel(screenRadius, m_lodLevels[n], m_lodBias);
+                const LODRange& range = m_lod.getLevel(m_lodLevels[n]);
+
+                //The draw ID is the index in the chunk for now, offset by the merge
+                DrawElementsIndirectCommand command;
+                command.count         = range.nbIndices;
+                command.instanceCount = 1;
+                command.firstIndex    = m_mesh.firstIndex + range.firstIndex;
+                command.baseVertex    = m_mesh.baseVertex;
+                command.baseInstance  = chunk.commands.size();
+                chunk.commands.push_back(command);
+
+                glm::mat4 mvp = viewProjection * model;
+                glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+                for(uint32_t i = 0; i < 4; i++)
+                    chunk.drawData.push_back(mvp[i]);
+                for(uint32_t i = 0; i < 4; i++)
+                    chunk.drawData.push_back(model[i]);
+                for(uint32_t i = 0; i < 3; i++)
+                    chunk.drawData.push_back(glm::vec4(normalMatrix[i], i == 0 ? (float)m_nodes[n].textureLayer : 0.0f));
+            }
+        }
+    }, "Frame culling");
+
+    //Merge in node order : the place of each chunk is known from the sizes of the previous ones, so the copies run in parallel too
+    m_nbDraws = 0;
+    for(uint32_t c = 0; c < nbChunks; c++)
+    {
+        m_chunks[c].firstDraw = m_nbDraws;
+        m_nbDraws += m_chunks[c].commands.size();
+    }
+
+    commands.clear();
+    DrawElementsIndirectCommand* mergedCommands = commands.append(m_nbDraws);
+    drawData.resize(m_nbDraws*FRAME_BUILDER_DRAW_TEXELS);
+    parallelFor(0, nbChunks, 1, [&](uint32_t first, uint32_t last)
+    {
+        for(uint32_t c = first; c < last; c++)
+        {
+            const Chunk& chunk = m_chunks[c];
+            for(uint32_t i = 0; i < chunk.commands.size(); i++)
+            {
+                mergedCommands[chunk.firstDraw + i] = chunk.commands[i];
+                mergedCommands[chunk.firstDraw + i].baseInstance += chunk.firstDraw;
+            }
+            if(!chunk.drawData.empty())
+                memcpy(&drawData[chunk.firstDraw*FRAME_BUILDER_DRAW_TEXELS], &chunk.drawData[0], chunk.drawData.size()*sizeof(glm::vec4));
+        }
+    }, "Frame merge");
+}
@@ -0,0 +1,261 @@
+#include "FrameCapture.h"
+#include "ImageWriter.h"
+#include "logger.h"
+#include <cstring>
+
+#ifdef _WIN32
+#define popen  _popen
+#define pclose _pclose
+#define PIPE_MODE "wb"
+#else
+#include <signal.h>
+#define PIPE_MODE "w"
+#endif
+
+//The pattern is the format of snprintf : it must take the frame number, an unsigned int, and nothing else
+static bool isFramePattern(const char* pattern)
+{
+    uint32_t nbConversions = 0;
+    for(const char* c = pattern; *c != '\0'; c++)
+    {
+        if(*c != '%')
+            continue;
+        c++;
+        if(*c == '%')
+            continue;
+
+        //Flags, width and precision, without '*' nor length modifier, then an integer conversion
+        while(*c != '\0' && strchr("-+ #0", *c) != NULL)
+            c++;
+        while(*c >= '0' && *c <= '9')
+            c++;
+        if(*c == '.')
+            for(c++; *c >= '0' && *c <= '9'; c++);
+        if(*c == '\0' || strchr("diouxX", *c) == NULL)
+            return false;
+        nbConversions++;
+    }
+    return nbConversions == 1;
+}
+
+FrameCapture::FrameCapture() : m_nbPending(0), m_failed(false)
+{
+    for(uint32_t i = 0; i < FRAME_CAPTURE_NB_BUFFERS; i++)
+    {
+        m_buffers[i] = 0;
+        m_filled[i]  = false;
+        m_numbers[i] = 0;
+    }
+}
+
+FrameCapture::~FrameCapture()
+{
+    stop();
+}
+
+bool FrameCapture::startSequence(const char* pattern, uint32_t width, uint32_t height)
+{
+    stop();
+
+    const char* extension = strrchr(pattern, '.');
+    if(extension != NULL && strcmp(extension, ".ppm") == 0)
+        m_format = CAPTURE_PPM;
+    else if(extension != NULL && strcmp(extension, ".qoi") == 0)
+        m_format = CAPTURE_QOI;
+    else if(extension != NULL && strcmp(extension, ".png") == 0)
+        m_format = CAPTURE_PNG;
+    else
+    {
+        ERROR("Unknown image format for %s : .ppm, .qoi or .png expected\n", pattern);
+        return false;
+    }
+    if(!isFramePattern(pattern))
+    {
+        ERROR("The capture pattern %s must have exactly one integer conversion for the frame number (e.g. %%05u), and %%%% for a %%\n", pattern);
+        return false;
+    }
+    m_pattern = pattern;
+    return start(width, height);
+}
+
+bool FrameCapture::startPipe(const char* command, uint32_t width, uint32_t height)
+{
+    stop();
+
+#ifndef _WIN32
+    //An encoder which quits must not take the program with it : the writes fail instead
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    m_pipe = popen(command, PIPE_MODE);
+    if(m_pipe == NULL)
+    {
+        ERROR("Could not start %s\n", command);
+        return false;
+    }
+    m_format  = CAPTURE_PIPE;
+    m_pattern = command;
+    return start(width, height);
+}
+
+bool FrameCapture::start(uint32_t width, uint32_t height)
+{
+    if(m_buffers[0] == 0)
+        glGenBuffers(FRAME_CAPTURE_NB_BUFFERS, m_buffers);
+    for(uint32_t i = 0; i < FRAME_CAPTURE_NB_BUFFERS; i++)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffers[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, 4*(size_t)width*height, NULL, GL_STREAM_READ);
+        m_filled[i] = false;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_width     = width;
+    m_height    = height;
+    m_next      = 0;
+    m_nbFrames  = 0;
+    m_failed    = false;
+    m_capturing = true;
+    INFO("Capturing %ux%u frames to %s\n", width, height, m_pattern.c_str());
+    return true;
+}
+
+void FrameCapture::capture()
+{
+    if(!m_capturing)
+        return;
+
+    //The frame read FRAME_CAPTURE_NB_BUFFERS captures ago : long done on the GPU, mapping it does not wait
+    if(m_filled[m_next])
+        readBack(m_next);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffers[m_next]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_filled[m_next]  = true;
+    m_numbers[m_next] = m_nbFrames++;
+    m_next = (m_next+1) % FRAME_CAPTURE_NB_BUFFERS;
+}
+
+void FrameCapture::stop()
+{
+    if(!m_capturing)
+        return;
+
+    //The oldest first, so that the pipe gets them in order
+    for(uint32_t i = 0; i < FRAME_CAPTURE_NB_BUFFERS; i++)
+    {
+        uint32_t buffer = (m_next + i) % FRAME_CAPTURE_NB_BUFFERS;
+        if(m_filled[buffer])
+            readBack(buffer);
+    }
+    JobSystem::getShared().wait(m_jobs);
+
+    if(m_pipe != NULL)
+    {
+        pclose(m_pipe);
+        m_pipe = NULL;
+    }
+    glDeleteBuffers(FRAME_CAPTURE_NB_BUFFERS, m_buffers);
+    for(uint32_t i = 0; i < FRAME_CAPTURE_NB_BUFFERS; i++)
+        m_buffers[i] = 0;
+
+    m_capturing = false;
+    if(m_failed)
+        ERROR("The capture to %s failed, %u frames captured\n", m_pattern.c_str(), m_nbFrames);
+    else
+        INFO("%u frames captured to %s\n", m_nbFrames, m_pattern.c_str());
+}
+
+void FrameCapture::readBack(uint32_t buffer)
+{
+    m_filled[buffer] = false;
+
+    //Slower workers than frames : wait for them, a frame is never dropped
+    if(m_nbPending.load() >= FRAME_CAPTURE_MAX_PENDING)
+        JobSystem::getShared().wait(m_jobs);
+
+    Frame* frame = new Frame;
+    frame->number = m_numbers[buffer];
+    frame->pixels.resize(4*(size_t)m_width*m_height);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffers[buffer]);
+    void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frame->pixels.size(), GL_MAP_READ_BIT);
+    if(pixels != NULL)
+    {
+        memcpy(&frame->pixels[0], pixels, frame->pixels.size());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if(pixels == NULL)
+    {
+        ERROR("Could not map the pixels of the frame %u\n", frame->number);
+        m_failed = true;
+        delete frame;
+        return;
+    }
+
+    m_nbPending++;
+    if(m_format != CAPTURE_PIPE)
+    {
+        JobSystem::getShared().run([this, frame]() {writeImage(frame);}, &m_jobs, "Frame encoding");
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_pipeMutex);
+        m_pipeFrames.push_back(frame);
+
+        //The job in flight will write it
+        if(m_pipeRunning)
+            return;
+        m_pipeRunning = true;
+    }
+    JobSystem::getShared().run([this]() {writePipe();}, &m_jobs, "Frame pipe");
+}
+
+void FrameCapture::writeImage(Frame* frame)
+{
+    if(!m_failed)
+    {
+        char path[1024];
+        snprintf(path, sizeof(path), m_pattern.c_str(), frame->number);
+
+        bool ok = false;
+        if(m_format == CAPTURE_PPM)
+            ok = writePPM(path, m_width, m_height, &frame->pixels[0], true);
+        else if(m_format == CAPTURE_QOI)
+            ok = writeQOI(path, m_width, m_height, &frame->pixels[0], true);
+        else
+            ok = writePNG(path, m_width, m_height, &frame->pixels[0], true);
+        if(!ok)
+            m_failed = true;
+    }
+    delete frame;
+    m_nbPending--;
+}
+
+void FrameCapture::writePipe()
+{
+    std::unique_lock<std::mutex> lock(m_pipeMutex);
+    while(!m_pipeFrames.empty())
+    {
+        Frame* frame = m_pipeFrames.front();
+        m_pipeFrames.pop_front();
+
+        //Written without holding the lock : the GL thread keeps queueing meanwhile. Top row first, as the encoders expect
+        lock.unlock();
+        size_t rowSize = 4*(size_t)m_width;
+        for(uint32_t y = 0; y < m_height && !m_failed; y++)
+            if(fwrite(&frame->pixels[(m_height-1-y)*rowSize], 1, rowSize, m_pipe) != rowSize)
+            {
+                ERROR("The encoder process stopped reading at the frame %u\n", frame->number);
+                m_failed = true;
+            }
+        delete frame;
+        m_nbPending--;
+        lock.lock();
+    }
+    m_pipeRunning = false;
+}
@@ -0,0 +1,57 @@
+#include "FrameStats.h"
+#include "logger.h"
+
+FrameStats::FrameStats()
+{
+    reset();
+}
+
+void FrameStats::endFrame(bool drawn)
+{
+    m_nbLoops++;
+    if(drawn)
+        m_nbDrawn++;
+}
+
+void FrameStats::reset()
+{
+    m_start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < FRAME_NB_STAGES; i++)
+        m_totalMs[i] = 0.0;
+    m_nbLoops = 0;
+    m_nbDrawn = 0;
+}
+
+double FrameStats::getElapsedMs() const
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+void FrameStats::report() const
+{
+    double elapsedMs = getElapsedMs();
+    INFO("Frames : %u drawn in %.2f s (%.1f FPS), %u loops without drawing\n",
+        m_nbDrawn, elapsedMs * 1e-3, elapsedMs > 0.0 ? m_nbDrawn * 1e3 / elapsedMs : 0.0, m_nbLoops - m_nbDrawn);
+
+    //The GPU overlaps the CPU stages : its share is of its own time, not of the wall time
+    for(uint32_t i = 0; i < FRAME_NB_STAGES; i++)
+    {
+        FrameStage stage = (FrameStage)i;
+        INFO("    %-24s %8.3f ms/frame, %5.1f %% of the time\n",
+            getStageName(stage), getAverageMs(stage), elapsedMs > 0.0 ? 100.0 * m_totalMs[i] / elapsedMs : 0.0);
+    }
+}
+
+const char* FrameStats::getStageName(FrameStage stage)
+{
+    static const char* names[FRAME_NB_STAGES] =
+    {
+        "Events and animation",
+        "CPU submission",
+        "GPU",
+        "Present",
+        "Frame pacing",
+        "Idle, waiting for events",
+    };
+    return names[stage];
+}
@@ -0,0 +1,73 @@
+#include "Framebuffer.h"
+#include "logger.h"
+
+Framebuffer::Framebuffer()
+{}
+
+Framebuffer::~Framebuffer()
+{
+    if(m_id == 0)
+        return;
+    glDeleteFramebuffers(1, &m_id);
+    glDeleteTextures(1, &m_color);
+    glDeleteRenderbuffers(1, &m_depth);
+}
+
+bool Framebuffer::resize(uint32_t width, uint32_t height)
+{
+    if(m_id != 0 && width == m_width && height == m_height)
+        return m_complete;
+
+    if(m_id == 0)
+    {
+        glGenFramebuffers(1, &m_id);
+        glGenTextures(1, &m_color);
+        glGenRenderbuffers(1, &m_depth);
+    }
+    m_width  = width;
+    m_height = height;
+
+    glBindTexture(GL_TEXTURE_2D, m_color);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_id);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_color, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depth);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    m_complete = status == GL_FRAMEBUFFER_COMPLETE;
+    if(!m_complete)
+        ERROR("Framebuffer : %ux%u is incomplete (status 0x%x)\n", width, height, status);
+    return m_complete;
+}
+
+void Framebuffer::bind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_id);
+    glViewport(0, 0, m_width, m_height);
+}
+
+void Framebuffer::bindDefault(uint32_t width, uint32_t height)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+}
+
+void Framebuffer::blit(uint32_t width, uint32_t height, GLuint destination, GLenum filter) const
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_id);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, destination);
+    glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, filter);
+    glBindFramebuffer(GL_FRAMEBUFFER, destination);
+    glViewport(0, 0, width, height);
+}
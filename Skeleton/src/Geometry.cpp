@@ -1,16 +1,21 @@
 #include "Geometry.h"
-#include <cstring>
+#include <new>
 
-Geometry::Geometry(){}
+//Alignment of the block and of each array inside it
+#define GEOMETRY_BLOCK_ALIGNMENT 64
+#define GEOMETRY_ARRAY_ALIGNMENT 16
 
-Geometry::Geometry(Geometry&& geom)
+static size_t alignSize(size_t size, size_t alignment)
 {
-    m_vertices = geom.m_vertices;
-    m_normals  = geom.m_normals;
-    m_uvs      = geom.m_uvs;
-    m_nbVertices = geom.m_nbVertices;
+    return (size + alignment-1) & ~(alignment-1);
+}
 
-    geom.m_vertices = geom.m_normals = geom.m_uvs = NULL;
+Geometry::Geometry(Allocator* allocator) : m_allocator(allocator ? allocator : getDefaultAllocator())
+{}
+
+Geometry::Geometry(Geometry&& geom)
+{
+    *this = std::move(geom);
 }
 
 Geometry::Geometry(const Geometry& geom)
@@ -23,34 +28,95 @@ Geometry& Geometry::operator=(const Geometry& geom)
     if(this == &geom)
         return *this;
 
-    if(geom.m_vertices != NULL)
-    {
-        m_vertices = (float*)malloc(sizeof(float) * 3 * geom.m_nbVertices);
-        memcpy(m_vertices, geom.m_vertices, sizeof(float) * 3 * geom.m_nbVertices);
-    }
+    if(geom.m_storage != NULL)
+        geom.m_storage->refCount++;
+    release();
 
-    if (geom.m_normals != NULL)
-    {
-        m_normals = (float*)malloc(sizeof(float) * 3 * geom.m_nbVertices);
-        memcpy(m_normals, geom.m_normals, sizeof(float) * 3 * geom.m_nbVertices);
-    }
+    m_allocator  = geom.m_allocator;
+    m_storage    = geom.m_storage;
+    m_vertices   = geom.m_vertices;
+    m_normals    = geom.m_normals;
+    m_uvs        = geom.m_uvs;
+    m_indices    = geom.m_indices;
+    m_nbVertices = geom.m_nbVertices;
+    m_nbIndices  = geom.m_nbIndices;
+    m_vertexFormat = geom.m_vertexFormat;
 
-    if (geom.m_uvs != NULL)
-    {
-        m_uvs = (float*)malloc(sizeof(float) * 2 * geom.m_nbVertices);
-        memcpy(m_uvs, geom.m_uvs, sizeof(float) * 2 * geom.m_nbVertices);
-    }
+    return *this;
+}
+
+Geometry& Geometry::operator=(Geometry&& geom)
+{
+    if(this == &geom)
+        return *this;
+
+    release();
+
+    m_allocator  = geom.m_allocator;
+    m_storage    = geom.m_storage;
+    m_vertices   = geom.m_vertices;
+    m_normals    = geom.m_normals;
+    m_uvs        = geom.m_uvs;
+    m_indices    = geom.m_indices;
     m_nbVertices = geom.m_nbVertices;
+    m_nbIndices  = geom.m_nbIndices;
+    m_vertexFormat = geom.m_vertexFormat;
+
+    geom.m_storage  = NULL;
+    geom.m_vertices = geom.m_normals = geom.m_uvs = NULL;
+    geom.m_indices  = NULL;
+    geom.m_nbVertices = geom.m_nbIndices = 0;
 
     return *this;
 }
 
 Geometry::~Geometry()
 {
-    if(m_vertices)
-        free(m_vertices);
-    if(m_normals)
-        free(m_normals);
-    if(m_uvs)
-        free(m_uvs);
+    release();
+}
+
+void Geometry::allocate(uint32_t nbVertices, uint32_t nbIndices)
+{
+    release();
+
+    //[Storage | positions | normals | uvs | indices], every array on its own 16 bytes boundary
+    size_t header    = alignSize(sizeof(Storage),               GEOMETRY_ARRAY_ALIGNMENT);
+    size_t positions = alignSize(sizeof(float)*3*nbVertices,    GEOMETRY_ARRAY_ALIGNMENT);
+    size_t normals   = alignSize(sizeof(float)*3*nbVertices,    GEOMETRY_ARRAY_ALIGNMENT);
+    size_t uvs       = alignSize(sizeof(float)*2*nbVertices,    GEOMETRY_ARRAY_ALIGNMENT);
+    size_t indices   = alignSize(sizeof(uint32_t)*nbIndices,    GEOMETRY_ARRAY_ALIGNMENT);
+
+    uint8_t* block = (uint8_t*)m_allocator->allocate(header + positions + normals + uvs + indices, GEOMETRY_BLOCK_ALIGNMENT);
+    if(block == NULL)
+    {
+        m_nbVertices = m_nbIndices = 0;
+        return;
+    }
+
+    m_storage = new(block) Storage;
+    m_storage->refCount  = 1;
+    m_storage->allocator = m_allocator;
+
+    uint8_t* data = block + header;
+    m_vertices   = (float*)data;                                 data += positions;
+    m_normals    = (float*)data;                                 data += normals;
+    m_uvs        = (float*)data;                                 data += uvs;
+    m_indices    = nbIndices ? (uint32_t*)data : NULL;
+    m_nbVertices = nbVertices;
+    m_nbIndices  = nbIndices;
+}
+
+void Geometry::release()
+{
+    if(m_storage != NULL && --m_storage->refCount == 0)
+    {
+        Allocator* allocator = m_storage->allocator;
+        m_storage->~Storage();
+        allocator->deallocate(m_storage);
+    }
+
+    m_storage  = NULL;
+    m_vertices = m_normals = m_uvs = NULL;
+    m_indices  = NULL;
+    m_nbVertices = m_nbIndices = 0;
 }
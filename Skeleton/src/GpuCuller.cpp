@@ -0,0 +1,237 @@
+#include "GpuCuller.h"
+#include "logger.h"
+#include <algorithm>
+#include <cmath>
+
+GpuCuller::GpuCuller(Shader* cullShader, Shader* hizShader, const MeshBuffer& meshes, uint32_t mesh, const LODSphere& lod, uint32_t maxBodies, uint32_t width, uint32_t height) :
+    m_cullShader(cullShader), m_hizShader(hizShader), m_maxBodies(maxBodies), m_width(width), m_height(height),
+    m_staging(64*sizeof(BodyRecord)), m_viewProjection(1.0f), m_depthViewProjection(1.0f)
+{
+    m_nbLevels = std::min(lod.getNbLevels(), (uint32_t)GPU_CULLER_MAX_LEVELS);
+    if(m_nbLevels < lod.getNbLevels())
+        WARNING("The chain has %u levels, the GPU culling only picks among the %u coarsest\n", lod.getNbLevels(), m_nbLevels);
+
+    //The instances of level l start at l*maxBodies : every body may end up in any level
+    const MeshRange& range = meshes.getMesh(mesh);
+    for(uint32_t i = 0; i < m_nbLevels; i++)
+    {
+        const LODRange& level = lod.getLevel(i);
+        DrawElementsIndirectCommand command;
+        command.count         = level.nbIndices;
+        command.instanceCount = 0;
+        command.firstIndex    = range.firstIndex + level.firstIndex;
+        command.baseVertex    = range.baseVertex;
+        command.baseInstance  = i*maxBodies;
+        m_resetCommands.push_back(command);
+        m_resolutions[i] = level.resolution;
+    }
+
+    glGenBuffers(1, &m_bodyBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_bodyBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, maxBodies*sizeof(BodyRecord), NULL, GL_DYNAMIC_DRAW);
+
+    //No level yet : the first selection has no hysteresis
+    std::vector<GLuint> levels(maxBodies, 0xffffffff);
+    glGenBuffers(1, &m_levelBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_levelBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, maxBodies*sizeof(GLuint), &levels[0], GL_DYNAMIC_COPY);
+
+    glGenBuffers(1, &m_commandBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, m_nbLevels*sizeof(DrawElementsIndirectCommand), &m_resetCommands[0], GL_DYNAMIC_COPY);
+
+    glGenBuffers(1, &m_instanceBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, m_nbLevels*maxBodies*sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    //The meshes of the mesh buffer, and the body indices written by cull.comp as instanced attribute : the base instance of a level selects its list
+    glGenVertexArrays(1, &m_VAO);
+    glBindVertexArray(m_VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, meshes.getVertexBuffer());
+    setVertexAttribPointers(meshes.getLayout(), 0, 1, 2);
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    glVertexAttribIPointer(GPU_CULLER_BODY_LOCATION, 1, GL_UNSIGNED_INT, 0, 0);
+    glVertexAttribDivisor(GPU_CULLER_BODY_LOCATION, 1);
+    glEnableVertexAttribArray(GPU_CULLER_BODY_LOCATION);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshes.getIndexBuffer());
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    //The depth of the frame, and its pyramid : each texel keeps the farthest depth of the 2x2 (or 3x3 at odd borders) texels under it
+    glGenTextures(1, &m_depthTexture);
+    glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+
+    m_nbHiZLevels = 1;
+    while((std::max(width, height) >> m_nbHiZLevels) > 0)
+        m_nbHiZLevels++;
+
+    glGenTextures(1, &m_hizTexture);
+    glBindTexture(GL_TEXTURE_2D, m_hizTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexStorage2D(GL_TEXTURE_2D, m_nbHiZLevels, GL_R32F, width, height);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+GpuCuller::~GpuCuller()
+{
+    GLuint buffers[] = {m_bodyBuffer, m_levelBuffer, m_commandBuffer, m_instanceBuffer};
+    glDeleteBuffers(4, buffers);
+    GLuint textures[] = {m_depthTexture, m_hizTexture};
+    glDeleteTextures(2, textures);
+    glDeleteVertexArrays(1, &m_VAO);
+}
+
+bool GpuCuller::isSupported()
+{
+    return GLEW_VERSION_4_3;
+}
+
+int GpuCuller::addBody(const glm::mat4& model, int layer)
+{
+    if(m_bodies.size() >= m_maxBodies)
+    {
+        ERROR("The GPU culler is full (%u bodies)\n", m_maxBodies);
+        return -1;
+    }
+
+    BodyRecord body;
+    body.normalMatrix[0].w = layer;
+    m_bodies.push_back(body);
+    setBody(m_bodies.size()-1, model);
+    return m_bodies.size()-1;
+}
+
+void GpuCuller::setBody(uint32_t body, const glm::mat4& model)
+{
+    BodyRecord& record = m_bodies[body];
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+    record.model = model;
+    for(uint32_t i = 0; i < 3; i++)
+        record.normalMatrix[i] = glm::vec4(normalMatrix[i], i == 0 ? record.normalMatrix[0].w : 0.0f);
+
+    if(m_dirtyBegin == m_dirtyEnd)
+    {
+        m_dirtyBegin = body;
+        m_dirtyEnd   = body+1;
+    }
+    else
+    {
+        m_dirtyBegin = std::min(m_dirtyBegin, body);
+        m_dirtyEnd   = std::max(m_dirtyEnd, body+1);
+    }
+}
+
+void GpuCuller::cull(const glm::mat4& viewMatrix, const glm::mat4& projection, uint32_t viewportHeight)
+{
+    if(viewportHeight == 0)
+        viewportHeight = m_height;
+
+    //Staged in the region of the frame then copied by the GPU : the bodies and commands stay in use by the previous draws meanwhile
+    if(m_dirtyBegin != m_dirtyEnd)
+    {
+        uint32_t size = (m_dirtyEnd-m_dirtyBegin)*sizeof(BodyRecord);
+        GLintptr offset = m_staging.write(&m_bodies[m_dirtyBegin], size);
+        glBindBuffer(GL_COPY_READ_BUFFER, m_staging.getBuffer());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_bodyBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, m_dirtyBegin*sizeof(BodyRecord), size);
+        m_dirtyBegin = m_dirtyEnd = 0;
+    }
+
+    //No instance in any level before the shader appends the survivors
+    uint32_t size = m_nbLevels*sizeof(DrawElementsIndirectCommand);
+    GLintptr offset = m_staging.write(&m_resetCommands[0], size);
+    glBindBuffer(GL_COPY_READ_BUFFER, m_staging.getBuffer());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_commandBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, 0, size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    m_viewProjection = projection * viewMatrix;
+    glm::vec3 camera = glm::vec3(glm::inverse(viewMatrix)[3]);
+
+    //Frustum planes of the view-projection (a point p is inside if dot(plane, (p, 1)) >= 0 for the 6 of them)
+    glm::mat4 m = glm::transpose(m_viewProjection);
+    glm::vec4 planes[6] = {m[3]+m[0], m[3]-m[0], m[3]+m[1], m[3]-m[1], m[3]+m[2], m[3]-m[2]};
+    for(uint32_t i = 0; i < 6; i++)
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+
+    GLuint program = m_cullShader->getProgramID();
+    glUseProgram(program);
+    glUniform1ui(glGetUniformLocation(program, "uNbBodies"), m_bodies.size());
+    glUniform1ui(glGetUniformLocation(program, "uMaxBodies"), m_maxBodies);
+    glUniform4fv(glGetUniformLocation(program, "uFrustum"), 6, &planes[0][0]);
+    glUniform3fv(glGetUniformLocation(program, "uCamera"), 1, &camera[0]);
+    glUniform1f(glGetUniformLocation(program, "uProjectionScale"), projection[1][1] * 0.5f*viewportHeight);
+    glUniform1f(glGetUniformLocation(program, "uViewportHeight"), viewportHeight);
+    glUniform1i(glGetUniformLocation(program, "uNbLevels"), m_nbLevels);
+    glUniform1fv(glGetUniformLocation(program, "uResolutions"), m_nbLevels, m_resolutions);
+    glUniform1f(glGetUniformLocation(program, "uTargetEdge"), LOD_TARGET_EDGE_PX);
+    glUniform1f(glGetUniformLocation(program, "uHysteresis"), LOD_HYSTERESIS);
+
+    //Occlusion against the depth of the previous frame, projected with the matrices of that frame
+    glUniform1i(glGetUniformLocation(program, "uOcclusion"), m_occlusion && m_hasDepth);
+    glUniformMatrix4fv(glGetUniformLocation(program, "uDepthViewProjection"), 1, GL_FALSE, &m_depthViewProjection[0][0]);
+    glUniform2f(glGetUniformLocation(program, "uViewport"), m_width, m_height);
+    glUniform1i(glGetUniformLocation(program, "uNbHiZLevels"), m_nbHiZLevels);
+    glUniform1i(glGetUniformLocation(program, "uHiZ"), 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_hizTexture);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_CULLER_BODIES_BINDING,    m_bodyBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_CULLER_LEVELS_BINDING,    m_levelBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_CULLER_COMMANDS_BINDING,  m_commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_CULLER_INSTANCES_BINDING, m_instanceBuffer);
+
+    glDispatchCompute((m_bodies.size() + GPU_CULLER_GROUP_SIZE-1) / GPU_CULLER_GROUP_SIZE, 1, 1);
+
+    //The commands and instances written above are read by the draw
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+}
+
+void GpuCuller::draw(GLenum mode)
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_CULLER_BODIES_BINDING, m_bodyBuffer);
+    glBindVertexArray(m_VAO);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+    glMultiDrawElementsIndirect(mode, GL_UNSIGNED_INT, 0, m_nbLevels, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void GpuCuller::updateDepth()
+{
+    glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, m_width, m_height);
+
+    GLuint program = m_hizShader->getProgramID();
+    glUseProgram(program);
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1i(glGetUniformLocation(program, "uDepth"), 0);
+    GLint uFirst = glGetUniformLocation(program, "uFirst");
+
+    //Level 0 is a copy of the depth, each next level the maximum of the previous one
+    for(uint32_t i = 0; i < m_nbHiZLevels; i++)
+    {
+        uint32_t width  = std::max(m_width  >> i, 1u);
+        uint32_t height = std::max(m_height >> i, 1u);
+        glUniform1i(uFirst, i == 0);
+        glBindImageTexture(0, m_hizTexture, i == 0 ? 0 : i-1, GL_FALSE, 0, GL_READ_ONLY,  GL_R32F);
+        glBindImageTexture(1, m_hizTexture, i,                GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glDispatchCompute((width + GPU_CULLER_HIZ_GROUP-1) / GPU_CULLER_HIZ_GROUP, (height + GPU_CULLER_HIZ_GROUP-1) / GPU_CULLER_HIZ_GROUP, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+
+    m_depthViewProjection = m_viewProjection;
+    m_hasDepth = true;
+}
@@ -0,0 +1,89 @@
+#include "GpuTimer.h"
+
+GpuTimer::GpuTimer()
+{
+    for(uint32_t i = 0; i < GPU_TIMER_NB_QUERIES; i++)
+    {
+        m_ids[i]     = 0;
+        m_pending[i] = false;
+    }
+}
+
+GpuTimer::~GpuTimer()
+{
+    if(m_created)
+        glDeleteQueries(GPU_TIMER_NB_QUERIES, m_ids);
+}
+
+bool GpuTimer::isSupported()
+{
+    return GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+}
+
+void GpuTimer::begin()
+{
+    if(!isSupported())
+        return;
+    if(!m_created)
+    {
+        glGenQueries(GPU_TIMER_NB_QUERIES, m_ids);
+        m_created = true;
+    }
+
+    //Oldest first, so that the last measure is the most recent one
+    for(uint32_t i = 0; i < GPU_TIMER_NB_QUERIES; i++)
+        collect((m_next + i) % GPU_TIMER_NB_QUERIES, false);
+
+    //Every query is still in flight (the GPU is more than GPU_TIMER_NB_QUERIES measures late) : wait for the oldest one
+    if(m_pending[m_next])
+        collect(m_next, true);
+
+    glBeginQuery(GL_TIME_ELAPSED, m_ids[m_next]);
+    m_running = true;
+}
+
+void GpuTimer::end()
+{
+    if(!m_running)
+        return;
+    glEndQuery(GL_TIME_ELAPSED);
+    m_pending[m_next] = true;
+    m_next    = (m_next + 1) % GPU_TIMER_NB_QUERIES;
+    m_running = false;
+}
+
+void GpuTimer::finish()
+{
+    for(uint32_t i = 0; i < GPU_TIMER_NB_QUERIES; i++)
+        collect((m_next + i) % GPU_TIMER_NB_QUERIES, true);
+}
+
+void GpuTimer::reset()
+{
+    finish();
+    m_nbMeasures = 0;
+    m_totalMs    = 0.0;
+    m_lastMs     = 0.0;
+}
+
+bool GpuTimer::collect(uint32_t query, bool wait)
+{
+    if(!m_pending[query])
+        return false;
+
+    if(!wait)
+    {
+        GLuint available = 0;
+        glGetQueryObjectuiv(m_ids[query], GL_QUERY_RESULT_AVAILABLE, &available);
+        if(!available)
+            return false;
+    }
+
+    GLuint64 ns = 0;
+    glGetQueryObjectui64v(m_ids[query], GL_QUERY_RESULT, &ns);
+    m_pending[query] = false;
+    m_lastMs   = ns * 1e-6;
+    m_totalMs += m_lastMs;
+    m_nbMeasures++;
+    return true;
+}
@@ -0,0 +1,159 @@
+#include "HeadlessContext.h"
+#include "logger.h"
+#include <cstring>
+
+#ifdef HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+/* \brief Tell if a list of extensions, separated by spaces, has one */
+static bool hasExtension(const char* extensions, const char* name)
+{
+    if(extensions == NULL)
+        return false;
+    size_t length = strlen(name);
+    for(const char* found = strstr(extensions, name); found != NULL; found = strstr(found + length, name))
+        if((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0'))
+            return true;
+    return false;
+}
+#endif
+
+HeadlessContext::HeadlessContext()
+{}
+
+HeadlessContext::~HeadlessContext()
+{
+    destroy();
+}
+
+bool HeadlessContext::isSupported()
+{
+#ifdef HAVE_EGL
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool HeadlessContext::create(int major, int minor)
+{
+#ifdef HAVE_EGL
+    destroy();
+
+    //Surfaceless platform : no display at all. The client extensions are queried without a display
+    EGLDisplay display = EGL_NO_DISPLAY;
+    if(hasExtension(eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS), "EGL_MESA_platform_surfaceless"))
+    {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if(getPlatformDisplay != NULL)
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    if(display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint eglMajor, eglMinor;
+    if(display == EGL_NO_DISPLAY || !eglInitialize(display, &eglMajor, &eglMinor))
+    {
+        ERROR("No EGL display could be initialized (error 0x%x)\n", eglGetError());
+        return false;
+    }
+    m_display = display;
+
+    //Without a surface the framebuffer objects are the only targets : no size, no color nor depth buffer needed
+    m_surfaceless = hasExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+    EGLint configAttributes[] =
+    {
+        EGL_SURFACE_TYPE,    m_surfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE,   8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE,  8,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint nbConfigs = 0;
+    if(!eglChooseConfig(display, configAttributes, &config, 1, &nbConfigs) || nbConfigs == 0)
+    {
+        ERROR("EGL %d.%d has no configuration for desktop OpenGL\n", eglMajor, eglMinor);
+        destroy();
+        return false;
+    }
+
+    if(!eglBindAPI(EGL_OPENGL_API))
+    {
+        ERROR("EGL %d.%d cannot create desktop OpenGL contexts\n", eglMajor, eglMinor);
+        destroy();
+        return false;
+    }
+
+    //The compatibility profile, as the window asks for : the shaders are GLSL 1.30 with the built-in outputs
+    EGLint contextAttributes[] =
+    {
+        EGL_CONTEXT_MAJOR_VERSION_KHR, major,
+        EGL_CONTEXT_MINOR_VERSION_KHR, minor,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT_KHR,
+        EGL_NONE
+    };
+    //The profile is only known from 3.2 on
+    if(major < 3 || (major == 3 && minor < 2))
+        contextAttributes[4] = EGL_NONE;
+    m_context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+    if(m_context == EGL_NO_CONTEXT)
+    {
+        m_context = NULL;
+        ERROR("Could not create an OpenGL %d.%d context with EGL (error 0x%x)\n", major, minor, eglGetError());
+        destroy();
+        return false;
+    }
+
+    if(!m_surfaceless)
+    {
+        EGLint pbufferAttributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        m_surface = eglCreatePbufferSurface(display, config, pbufferAttributes);
+        if(m_surface == EGL_NO_SURFACE)
+        {
+            m_surface = NULL;
+            ERROR("Could not create an EGL pbuffer (error 0x%x)\n", eglGetError());
+            destroy();
+            return false;
+        }
+    }
+
+    EGLSurface surface = m_surface ? (EGLSurface)m_surface : EGL_NO_SURFACE;
+    if(!eglMakeCurrent(display, surface, surface, (EGLContext)m_context))
+    {
+        ERROR("Could not make the EGL context current (error 0x%x)\n", eglGetError());
+        destroy();
+        return false;
+    }
+
+    INFO("Headless OpenGL context through EGL %d.%d, %s\n", eglMajor, eglMinor, m_surfaceless ? "without surface" : "on a pbuffer");
+    return true;
+#else
+    (void)major;
+    (void)minor;
+    ERROR("This program was built without EGL : no headless backend\n");
+    return false;
+#endif
+}
+
+void HeadlessContext::destroy()
+{
+#ifdef HAVE_EGL
+    if(m_display == NULL)
+        return;
+
+    EGLDisplay display = (EGLDisplay)m_display;
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if(m_context != NULL)
+        eglDestroyContext(display, (EGLContext)m_context);
+    if(m_surface != NULL)
+        eglDestroySurface(display, (EGLSurface)m_surface);
+    eglTerminate(display);
+
+    m_display = NULL;
+    m_context = NULL;
+    m_surface = NULL;
+#endif
+}
@@ -0,0 +1,63 @@
+#include "Icosphere.h"
+#include <map>
+
+Icosphere::Icosphere(uint32_t nbSubdivisions, Allocator* allocator) : SphericalGeometry(allocator)
+{
+    //Icosahedron with a vertex on each pole and two rings of 5 vertices
+    std::vector<glm::vec3> directions;
+    directions.push_back(glm::vec3(0.0f, 1.0f, 0.0f));
+    for(uint32_t i = 0; i < 10; i++)
+    {
+        float y     = (i < 5) ? 1.0f/sqrtf(5.0f) : -1.0f/sqrtf(5.0f);
+        float theta = (i < 5) ? i*2*M_PI/5 : (i-5+0.5f)*2*M_PI/5;
+        float r     = 2.0f/sqrtf(5.0f);
+        directions.push_back(glm::vec3(r*sin(theta), y, r*cos(theta)));
+    }
+    directions.push_back(glm::vec3(0.0f, -1.0f, 0.0f));
+
+    std::vector<uint32_t> triangles;
+    for(uint32_t i = 0; i < 5; i++)
+    {
+        uint32_t up0   = 1+i, up1   = 1+(i+1)%5;
+        uint32_t down0 = 6+i, down1 = 6+(i+1)%5;
+        uint32_t t[] = {0,     up0,   up1,
+                        up0,   down0, up1,
+                        up1,   down0, down1,
+                        down0, 11,    down1};
+        triangles.insert(triangles.end(), t, t+12);
+    }
+
+    //Split each triangle in 4, the new vertices being shared between neighbour triangles
+    for(uint32_t s = 0; s < nbSubdivisions; s++)
+    {
+        std::map<uint64_t, uint32_t> middles;
+        std::vector<uint32_t> subdivided;
+        subdivided.reserve(4*triangles.size());
+
+        for(uint32_t t = 0; t < triangles.size(); t += 3)
+        {
+            uint32_t m[3];
+            for(uint32_t k = 0; k < 3; k++)
+            {
+                uint32_t a = triangles[t+k], b = triangles[t+(k+1)%3];
+                uint64_t key = (a < b) ? ((uint64_t)a << 32 | b) : ((uint64_t)b << 32 | a);
+                std::map<uint64_t, uint32_t>::iterator it = middles.find(key);
+                if(it == middles.end())
+                {
+                    it = middles.insert(std::make_pair(key, (uint32_t)directions.size())).first;
+                    directions.push_back(glm::normalize(directions[a] + directions[b]));
+                }
+                m[k] = it->second;
+            }
+
+            uint32_t n[] = {triangles[t],   m[0], m[2],
+                            m[0], triangles[t+1], m[1],
+                            m[2], m[1], triangles[t+2],
+                            m[0], m[1], m[2]};
+            subdivided.insert(subdivided.end(), n, n+12);
+        }
+        triangles.swap(subdivided);
+    }
+
+    build(directions, triangles);
+}
@@ -0,0 +1,226 @@
+#include "ImageWriter.h"
+#include "logger.h"
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+//The images written a block at a time go past 2 GB : the offsets are 64 bits
+#ifdef _WIN32
+#define fseeko _fseeki64
+#endif
+
+bool writePPM(const char* path, uint32_t width, uint32_t height, const uint8_t* rgba, bool bottomUp)
+{
+    FILE* file = fopen(path, "wb");
+    if(file == NULL)
+    {
+        ERROR("Could not open %s for writing\n", path);
+        return false;
+    }
+
+    bool ok = fprintf(file, "P6\n%u %u\n255\n", width, height) > 0;
+    std::vector<uint8_t> row(3*width);
+    for(uint32_t y = 0; y < height && ok; y++)
+    {
+        const uint8_t* source = rgba + 4*(size_t)width*(bottomUp ? height-1-y : y);
+        for(uint32_t x = 0; x < width; x++)
+        {
+            row[3*x+0] = source[4*x+0];
+            row[3*x+1] = source[4*x+1];
+            row[3*x+2] = source[4*x+2];
+        }
+        ok = fwrite(&row[0], 1, row.size(), file) == row.size();
+    }
+
+    if(fclose(file) != 0)
+        ok = false;
+    if(!ok)
+        ERROR("Could not write %s\n", path);
+    return ok;
+}
+
+bool writeQOI(const char* path, uint32_t width, uint32_t height, const uint8_t* rgba, bool bottomUp)
+{
+    //Worst case : a tag and the 4 channels per pixel
+    std::vector<uint8_t> data;
+    data.reserve(14 + 5*(size_t)width*height + 8);
+
+    const uint8_t header[14] = {'q', 'o', 'i', 'f',
+        (uint8_t)(width >> 24), (uint8_t)(width >> 16), (uint8_t)(width >> 8), (uint8_t)width,
+        (uint8_t)(height >> 24), (uint8_t)(height >> 16), (uint8_t)(height >> 8), (uint8_t)height,
+        4, 0};
+    data.insert(data.end(), header, header + 14);
+
+    //The pixels seen last, by their hash : a hit is written as its index
+    uint8_t index[64][4] = {};
+    uint8_t previous[4] = {0, 0, 0, 255};
+    uint32_t run = 0;
+    size_t nbPixels = (size_t)width*height;
+    size_t p = 0;
+    for(uint32_t y = 0; y < height; y++)
+    {
+        const uint8_t* row = rgba + 4*(size_t)width*(bottomUp ? height-1-y : y);
+        for(uint32_t x = 0; x < width; x++, p++)
+        {
+            const uint8_t* pixel = row + 4*x;
+            if(memcmp(pixel, previous, 4) == 0)
+            {
+                run++;
+                if(run == 62 || p == nbPixels-1)
+                {
+                    data.push_back(0xc0 | (run-1));
+                    run = 0;
+                }
+                continue;
+            }
+
+            if(run > 0)
+            {
+                data.push_back(0xc0 | (run-1));
+                run = 0;
+            }
+
+            uint32_t hash = (pixel[0]*3 + pixel[1]*5 + pixel[2]*7 + pixel[3]*11) % 64;
+            if(memcmp(index[hash], pixel, 4) == 0)
+                data.push_back(hash);
+            else
+            {
+                memcpy(index[hash], pixel, 4);
+                if(pixel[3] == previous[3])
+                {
+                    int8_t dr = (int8_t)(pixel[0] - previous[0]);
+                    int8_t dg = (int8_t)(pixel[1] - previous[1]);
+                    int8_t db = (int8_t)(pixel[2] - previous[2]);
+                    int8_t drg = dr - dg;
+                    int8_t dbg = db - dg;
+                    if(dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                        data.push_back(0x40 | (dr+2) << 4 | (dg+2) << 2 | (db+2));
+                    else if(dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7)
+                    {
+                        data.push_back(0x80 | (dg+32));
+                        data.push_back((drg+8) << 4 | (dbg+8));
+                    }
+                    else
+                    {
+                        data.push_back(0xfe);
+                        data.insert(data.end(), pixel, pixel + 3);
+                    }
+                }
+                else
+                {
+                    data.push_back(0xff);
+                    data.insert(data.end(), pixel, pixel + 4);
+                }
+            }
+            memcpy(previous, pixel, 4);
+        }
+    }
+    const uint8_t end[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    data.insert(data.end(), end, end + 8);
+
+    FILE* file = fopen(path, "wb");
+    if(file == NULL)
+    {
+        ERROR("Could not open %s for writing\n", path);
+        return false;
+    }
+    bool ok = fwrite(&data[0], 1, data.size(), file) == data.size();
+    if(fclose(file) != 0)
+        ok = false;
+    if(!ok)
+        ERROR("Could not write %s\n", path);
+    return ok;
+}
+
+bool writePNG(const char* path, uint32_t width, uint32_t height, const uint8_t* rgba, bool bottomUp)
+{
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+    if(surface == NULL)
+    {
+        ERROR("Could not create a %ux%u surface : %s\n", width, height, SDL_GetError());
+        return false;
+    }
+    for(uint32_t y = 0; y < height; y++)
+        memcpy((uint8_t*)surface->pixels + y*surface->pitch, rgba + 4*(size_t)width*(bottomUp ? height-1-y : y), 4*width);
+
+    bool ok = IMG_SavePNG(surface, path) == 0;
+    if(!ok)
+        ERROR("Could not write %s : %s\n", path, IMG_GetError());
+    SDL_FreeSurface(surface);
+    return ok;
+}
+
+PPMStream::PPMStream() : m_file(NULL), m_width(0), m_height(0), m_headerSize(0), m_failed(false)
+{}
+
+PPMStream::~PPMStream()
+{
+    close();
+}
+
+bool PPMStream::open(const char* path, uint32_t width, uint32_t height)
+{
+    close();
+
+    m_file = fopen(path, "wb");
+    if(m_file == NULL)
+    {
+        ERROR("Could not open %s for writing\n", path);
+        return false;
+    }
+
+    int headerSize = fprintf(m_file, "P6\n%u %u\n255\n", width, height);
+    m_width      = width;
+    m_height     = height;
+    m_headerSize = headerSize;
+    m_failed     = headerSize <= 0;
+    if(m_failed)
+        ERROR("Could not write %s\n", path);
+    return !m_failed;
+}
+
+bool PPMStream::writeBlock(uint32_t x, uint32_t y, uint32_t width, uint32_t height, const uint8_t* rgba, bool bottomUp)
+{
+    //Converted outside of the lock : the other threads keep writing meanwhile
+    std::vector<uint8_t> rgb(3*(size_t)width*height);
+    for(uint32_t j = 0; j < height; j++)
+    {
+        const uint8_t* source = rgba + 4*(size_t)width*(bottomUp ? height-1-j : j);
+        uint8_t* destination = &rgb[3*(size_t)width*j];
+        for(uint32_t i = 0; i < width; i++)
+        {
+            destination[3*i+0] = source[4*i+0];
+            destination[3*i+1] = source[4*i+1];
+            destination[3*i+2] = source[4*i+2];
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_file == NULL || m_failed)
+        return false;
+
+    //A block as wide as the image is contiguous in the file : one write. Otherwise one per row
+    size_t rowSize = 3*(size_t)width;
+    uint32_t nbRows = width == m_width ? 1 : height;
+    size_t writeSize = width == m_width ? rgb.size() : rowSize;
+    for(uint32_t j = 0; j < nbRows && !m_failed; j++)
+    {
+        uint64_t offset = m_headerSize + 3*((uint64_t)(y+j)*m_width + x);
+        m_failed = fseeko(m_file, offset, SEEK_SET) != 0 || fwrite(&rgb[j*rowSize], 1, writeSize, m_file) != writeSize;
+    }
+    if(m_failed)
+        ERROR("Could not write the block (%u, %u) of a %ux%u image\n", x, y, m_width, m_height);
+    return !m_failed;
+}
+
+bool PPMStream::close()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_file == NULL)
+        return false;
+
+    if(fclose(m_file) != 0)
+        m_failed = true;
+    m_file = NULL;
+    return !m_failed;
+}
@@ -0,0 +1,363 @@
+#include "JobSystem.h"
+#include "logger.h"
+#include <chrono>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+struct JobCounter::Job
+{
+    JobFunction function;
+    JobCounter* counter;
+    const char* name;
+};
+
+//The workers of the system the calling thread was started by
+static thread_local const JobSystem* s_system = NULL;
+static thread_local uint32_t         s_worker = JOB_EXTERNAL_WORKER;
+
+static std::mutex s_sharedMutex;
+static JobSystem* s_shared = NULL;
+
+bool JobSystem::WorkQueue::push(Job* job)
+{
+    int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+    int64_t top    = m_top.load(std::memory_order_acquire);
+    if(bottom - top >= JOB_QUEUE_CAPACITY)
+        return false;
+
+    m_jobs[bottom & (JOB_QUEUE_CAPACITY-1)].store(job, std::memory_order_relaxed);
+    m_bottom.store(bottom+1, std::memory_order_release);
+    return true;
+}
+
+JobSystem::Job* JobSystem::WorkQueue::pop()
+{
+    int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = m_top.load(std::memory_order_relaxed);
+
+    if(top > bottom)
+    {
+        //Empty
+        m_bottom.store(bottom+1, std::memory_order_relaxed);
+        return NULL;
+    }
+
+    Job* job = m_jobs[bottom & (JOB_QUEUE_CAPACITY-1)].load(std::memory_order_relaxed);
+    if(top == bottom)
+    {
+        //The last job : a thief may be taking it too, the one which moves the top wins
+        if(!m_top.compare_exchange_strong(top, top+1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            job = NULL;
+        m_bottom.store(bottom+1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+JobSystem::Job* JobSystem::WorkQueue::steal()
+{
+    int64_t top = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = m_bottom.load(std::memory_order_acquire);
+    if(top >= bottom)
+        return NULL;
+
+    Job* job = m_jobs[top & (JOB_QUEUE_CAPACITY-1)].load(std::memory_order_relaxed);
+    if(!m_top.compare_exchange_strong(top, top+1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return NULL; //Lost against the owner or another thief
+    return job;
+}
+
+JobSystem::JobSystem(uint32_t nbWorkers, bool pinThreads) : m_owner(std::this_thread::get_id()), m_pinned(pinThreads), m_nbExternal(0), m_nbQueued(0), m_nbSleeping(0), m_quit(false)
+{
+    if(nbWorkers == 0)
+        nbWorkers = std::thread::hardware_concurrency();
+    if(nbWorkers == 0)
+        nbWorkers = 1;
+
+    for(uint32_t i = 0; i < nbWorkers; i++)
+        m_queues.push_back(new WorkQueue());
+
+    if(pinThreads)
+        pinToCore(0);
+
+    //Every queue exists before any thread may steal from it
+    for(uint32_t i = 1; i < nbWorkers; i++)
+        m_threads.push_back(std::thread(&JobSystem::workerLoop, this, i));
+}
+
+JobSystem::~JobSystem()
+{
+    //Run what is left, so that no job is lost with its counter
+    while(Job* job = findJob(0))
+        execute(job, 0);
+
+    m_quit = true;
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_wakeCondition.notify_all();
+    }
+    for(uint32_t i = 0; i < m_threads.size(); i++)
+        m_threads[i].join();
+
+    for(uint32_t i = 0; i < m_queues.size(); i++)
+        delete m_queues[i];
+}
+
+void JobSystem::run(const JobFunction& function, JobCounter* counter, const char* name)
+{
+    if(counter)
+        counter->m_count.fetch_add(1, std::memory_order_relaxed);
+    schedule(new Job{function, counter, name});
+}
+
+void JobSystem::runAfter(JobCounter& dependency, const JobFunction& function, JobCounter* counter, const char* name)
+{
+    if(counter)
+        counter->m_count.fetch_add(1, std::memory_order_relaxed);
+    Job* job = new Job{function, counter, name};
+
+    //The count is read under the lock the last job of the dependency takes when it is done : either it sees this job, or this job sees zero
+    {
+        std::lock_guard<std::mutex> lock(dependency.m_mutex);
+        if(!dependency.isDone())
+        {
+            dependency.m_continuations.push_back(job);
+            return;
+        }
+    }
+    schedule(job);
+}
+
+void JobSystem::wait(const JobCounter& counter)
+{
+    uint32_t worker = getWorker();
+    while(!counter.isDone())
+    {
+        Job* job = findJob(worker);
+        if(job)
+            execute(job, worker);
+        else
+            std::this_thread::yield(); //The last jobs of the group run elsewhere
+    }
+
+    //The thread which released the counter may still hold its lock
+    std::lock_guard<std::mutex> lock(counter.m_mutex);
+}
+
+void JobSystem::parallelFor(uint32_t begin, uint32_t end, uint32_t minGrain, const std::function<void(uint32_t first, uint32_t last)>& body, const char* name)
+{
+    if(end <= begin)
+        return;
+
+    //Small ranges are not worth a job
+    uint32_t count = end - begin;
+    if(minGrain == 0)
+        minGrain = 1;
+    if(getNbWorkers() < 2 || count < 2*minGrain)
+    {
+        body(begin, end);
+        return;
+    }
+
+    uint32_t grain = count / (JOB_PIECES_PER_WORKER*getNbWorkers());
+    if(grain < minGrain)
+        grain = minGrain;
+
+    //A piece gives the upper half of its range away while it is bigger than the grain : the first thieves take the biggest parts
+    JobCounter counter;
+    std::function<void(uint32_t, uint32_t)> piece = [&](uint32_t first, uint32_t last)
+    {
+        while(last - first > grain)
+        {
+            uint32_t middle = first + (last - first)/2;
+            run([&piece, middle, last]() {piece(middle, last);}, &counter, name);
+            last = middle;
+        }
+        body(first, last);
+    };
+    piece(begin, end);
+    wait(counter);
+}
+
+JobSystem& JobSystem::getShared()
+{
+    std::lock_guard<std::mutex> lock(s_sharedMutex);
+    if(s_shared == NULL)
+        s_shared = new JobSystem();
+    return *s_shared;
+}
+
+void JobSystem::resetShared(uint32_t nbWorkers, bool pinThreads)
+{
+    std::lock_guard<std::mutex> lock(s_sharedMutex);
+    delete s_shared;
+    s_shared = new JobSystem(nbWorkers, pinThreads);
+}
+
+void JobSystem::schedule(Job* job)
+{
+    //Nobody to hand it to
+    if(m_threads.empty())
+    {
+        execute(job, getWorker());
+        return;
+    }
+
+    //Counted before it can be taken, so that the count never goes below zero
+    m_nbQueued.fetch_add(1, std::memory_order_seq_cst);
+    uint32_t worker = getWorker();
+    if(worker == JOB_EXTERNAL_WORKER)
+    {
+        std::lock_guard<std::mutex> lock(m_externalMutex);
+        m_external.push_back(job);
+        m_nbExternal.fetch_add(1, std::memory_order_release);
+    }
+    else if(!m_queues[worker]->push(job))
+    {
+        //Full : doing it now is what waiting for it would do anyway
+        m_nbQueued.fetch_sub(1, std::memory_order_relaxed);
+        execute(job, worker);
+        return;
+    }
+
+    //Wake a worker up if some sleep. Sleepers count themselves before checking m_nbQueued : one of the two sees the other
+    if(m_nbSleeping.load(std::memory_order_seq_cst) > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_wakeCondition.notify_one();
+    }
+}
+
+void JobSystem::execute(Job* job, uint32_t worker)
+{
+    if(m_profilerHook)
+    {
+        JobEvent event;
+        event.name    = job->name;
+        event.worker  = worker;
+        event.beginNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        job->function();
+        event.endNs   = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        m_profilerHook(event);
+    }
+    else
+        job->function();
+
+    JobCounter* counter = job->counter;
+    delete job;
+    if(counter == NULL)
+        return;
+
+    //Not the last job of the group : no lock
+    uint32_t count = counter->m_count.load(std::memory_order_relaxed);
+    while(count > 1 && !counter->m_count.compare_exchange_weak(count, count-1, std::memory_order_acq_rel, std::memory_order_relaxed))
+        ;
+    if(count > 1)
+        return;
+
+    //The last one crosses zero under the lock : runAfter cannot add a job meanwhile, and wait() takes the lock before the counter can be destroyed
+    std::vector<Job*> continuations;
+    {
+        std::lock_guard<std::mutex> lock(counter->m_mutex);
+        if(counter->m_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            continuations.swap(counter->m_continuations);
+    }
+    for(uint32_t i = 0; i < continuations.size(); i++)
+        schedule(continuations[i]);
+}
+
+JobSystem::Job* JobSystem::findJob(uint32_t worker)
+{
+    Job* job = NULL;
+    if(worker != JOB_EXTERNAL_WORKER)
+        job = m_queues[worker]->pop();
+
+    if(job == NULL && m_nbExternal.load(std::memory_order_acquire) > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_externalMutex);
+        if(!m_external.empty())
+        {
+            job = m_external.front();
+            m_external.pop_front();
+            m_nbExternal.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    //Steal from the next workers first, so that the thieves spread over the victims
+    uint32_t nbWorkers = m_queues.size();
+    uint32_t start     = worker == JOB_EXTERNAL_WORKER ? 0 : worker+1;
+    for(uint32_t i = 0; i < nbWorkers && job == NULL; i++)
+    {
+        uint32_t victim = (start + i) % nbWorkers;
+        if(victim != worker)
+            job = m_queues[victim]->steal();
+    }
+
+    if(job)
+        m_nbQueued.fetch_sub(1, std::memory_order_relaxed);
+    return job;
+}
+
+uint32_t JobSystem::getWorker() const
+{
+    if(s_system == this)
+        return s_worker;
+    return std::this_thread::get_id() == m_owner ? 0 : JOB_EXTERNAL_WORKER;
+}
+
+void JobSystem::workerLoop(uint32_t worker)
+{
+    s_system = this;
+    s_worker = worker;
+    if(m_pinned)
+        pinToCore(worker);
+
+    while(true)
+    {
+        Job* job = NULL;
+        for(uint32_t i = 0; i < JOB_SPIN_COUNT && job == NULL && !m_quit; i++)
+        {
+            job = findJob(worker);
+            if(job == NULL)
+                std::this_thread::yield();
+        }
+        if(job)
+        {
+            execute(job, worker);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_nbSleeping.fetch_add(1, std::memory_order_seq_cst);
+        m_wakeCondition.wait(lock, [this]() {return m_quit || m_nbQueued.load(std::memory_order_seq_cst) > 0;});
+        m_nbSleeping.fetch_sub(1, std::memory_order_seq_cst);
+        if(m_quit)
+            return;
+    }
+}
+
+void JobSystem::pinToCore(uint32_t core)
+{
+    uint32_t nbCores = std::thread::hardware_concurrency();
+    if(nbCores)
+        core %= nbCores;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    if(pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+        WARNING("JobSystem : could not pin a thread to the core %u\n", core);
+#elif defined(_WIN32)
+    if(SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << core) == 0)
+        WARNING("JobSystem : could not pin a thread to the core %u\n", core);
+#else
+    WARNING("JobSystem : threads cannot be pinned on this platform\n");
+#endif
+}
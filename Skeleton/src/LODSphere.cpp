@@ -0,0 +1,72 @@
+#include "LODSphere.h"
+#include "Sphere.h"
+#include "MeshOptimizer.h"
+#include <cstring>
+#include <algorithm>
+
+LODSphere::LODSphere(uint32_t minResolution, uint32_t maxResolution, const char* cacheDir, bool withData) : Geometry()
+{
+    //The size of every level is known beforehand : the whole chain goes in one block
+    for(uint32_t res = minResolution; res <= maxResolution; res *= 2)
+    {
+        uint32_t nbIndices = (res-1)*(res-1)*6;
+        m_levels.push_back({m_nbIndices, nbIndices, res});
+        m_nbVertices += res*res;
+        m_nbIndices  += nbIndices;
+    }
+    if(!withData)
+        return;
+    allocate(m_nbVertices, m_nbIndices);
+
+    //Each level is built and optimized in a temporary arena, reused by the next level, then merged.
+    //The indices are offset to the level's first vertex
+    Arena levelArena;
+    uint32_t firstVertex = 0;
+    for(uint32_t i = 0; i < m_levels.size(); i++)
+    {
+        levelArena.reset();
+        Sphere sphere(m_levels[i].resolution, m_levels[i].resolution, &levelArena);
+        MeshOptimizer::optimize(sphere, cacheDir);
+
+        uint32_t nbVertices = sphere.getNbVertices();
+        memcpy(m_vertices + 3*firstVertex, sphere.getVertices(), sizeof(float)*3*nbVertices);
+        memcpy(m_normals  + 3*firstVertex, sphere.getNormals(),  sizeof(float)*3*nbVertices);
+        memcpy(m_uvs      + 2*firstVertex, sphere.getUVs(),      sizeof(float)*2*nbVertices);
+
+        const uint32_t* indices = sphere.getIndices();
+        for(uint32_t j = 0; j < m_levels[i].nbIndices; j++)
+            m_indices[m_levels[i].firstIndex + j] = indices[j] + firstVertex;
+
+        firstVertex += nbVertices;
+    }
+}
+
+uint32_t LODSphere::selectLevel(float screenRadius, uint32_t currentLevel, int bias) const
+{
+    //Number of segments needed around the silhouette. Each level doubles the resolution, so the bias scales it by 2^bias
+    float wanted = ldexpf(2.0f*M_PI*screenRadius / LOD_TARGET_EDGE_PX, bias);
+
+    uint32_t ideal = 0;
+    while(ideal < m_levels.size()-1 && m_levels[ideal].resolution < wanted)
+        ideal++;
+
+    if(currentLevel >= m_levels.size() || ideal == currentLevel)
+        return ideal;
+
+    //Refine only once clearly above the current level, coarsen only once clearly below the next coarser one
+    if(ideal > currentLevel)
+        return (wanted > m_levels[currentLevel].resolution*(1.0f+LOD_HYSTERESIS)) ? ideal : currentLevel;
+    return (wanted < m_levels[currentLevel-1].resolution*(1.0f-LOD_HYSTERESIS)) ? ideal : currentLevel;
+}
+
+float LODSphere::computeScreenRadius(const glm::mat4& modelMatrix, const glm::vec3& cameraPosition, const glm::mat4& projection, float viewportHeight)
+{
+    float scale  = std::max(glm::length(glm::vec3(modelMatrix[0])), std::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+    float radius = 0.5f*scale;
+    float dist   = glm::length(glm::vec3(modelMatrix[3]) - cameraPosition);
+    if(dist <= radius)
+        return viewportHeight;
+
+    //projection[1][1] = 1/tan(fovy/2)
+    return radius / sqrtf(dist*dist - radius*radius) * projection[1][1] * 0.5f*viewportHeight;
+}
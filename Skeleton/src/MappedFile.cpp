@@ -0,0 +1,94 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const char* path)
+{
+    close();
+
+#ifdef _WIN32
+    m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if(m_file == INVALID_HANDLE_VALUE)
+    {
+        m_file = NULL;
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx((HANDLE)m_file, &size) || size.QuadPart == 0)
+    {
+        close();
+        return false;
+    }
+
+    m_mapping = CreateFileMappingA((HANDLE)m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(m_mapping == NULL)
+    {
+        close();
+        return false;
+    }
+    m_data = (const uint8_t*)MapViewOfFile((HANDLE)m_mapping, FILE_MAP_READ, 0, 0, 0);
+    m_size = size.QuadPart;
+#else
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); //The mapping keeps its own reference on the file
+    if(data == MAP_FAILED)
+        return false;
+
+    //The whole file is about to be uploaded : start reading it ahead
+    madvise(data, st.st_size, MADV_WILLNEED);
+    m_data = (const uint8_t*)data;
+    m_size = st.st_size;
+#endif
+
+    if(m_data == NULL)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if(m_data)
+        UnmapViewOfFile(m_data);
+    if(m_mapping)
+        CloseHandle((HANDLE)m_mapping);
+    if(m_file)
+        CloseHandle((HANDLE)m_file);
+    m_mapping = m_file = NULL;
+#else
+    if(m_data)
+        munmap((void*)m_data, m_size);
+#endif
+    m_data = NULL;
+    m_size = 0;
+}
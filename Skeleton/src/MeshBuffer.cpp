@@ -0,0 +1,168 @@
+#include "MeshBuffer.h"
+#include "logger.h"
+#include <cstdlib>
+#include <algorithm>
+
+#define INDICE_TO_PTR(x) ((void*)(uintptr_t)(x))
+
+static bool sameAttribute(const VertexAttribute& a, const VertexAttribute& b)
+{
+    return a.size == b.size && a.type == b.type && a.normalized == b.normalized && a.offset == b.offset;
+}
+
+MeshBuffer::MeshBuffer(const VertexLayout& layout, uint32_t maxVertices, uint32_t maxIndices) : m_layout(layout), m_maxVertices(maxVertices), m_maxIndices(maxIndices)
+{
+    m_layout.size = layout.stride * maxVertices;
+
+    glGenVertexArrays(1, &m_VAO);
+    glBindVertexArray(m_VAO);
+
+    glGenBuffers(1, &m_VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+    glBufferData(GL_ARRAY_BUFFER, m_layout.size, NULL, GL_STATIC_DRAW);
+    setVertexAttribPointers(m_layout, 0, 1, 2);
+
+    glGenBuffers(1, &m_EBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, maxIndices*sizeof(uint32_t), NULL, GL_STATIC_DRAW);
+
+    //Without multi-draw the attribute stays disabled : draw() sets its constant value before each draw
+    if(isMultiDrawSupported())
+    {
+        glGenBuffers(1, &m_drawIDs);
+        glBindBuffer(GL_ARRAY_BUFFER, m_drawIDs);
+        glVertexAttribIPointer(MESH_BUFFER_DRAW_LOCATION, 1, GL_UNSIGNED_INT, 0, 0);
+        glVertexAttribDivisor(MESH_BUFFER_DRAW_LOCATION, 1);
+        glEnableVertexAttribArray(MESH_BUFFER_DRAW_LOCATION);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+MeshBuffer::~MeshBuffer()
+{
+    GLuint buffers[] = {m_VBO, m_EBO, m_drawIDs};
+    glDeleteBuffers(3, buffers);
+    glDeleteVertexArrays(1, &m_VAO);
+}
+
+bool MeshBuffer::isSupported()
+{
+    return GLEW_VERSION_3_2 || GLEW_ARB_draw_elements_base_vertex;
+}
+
+bool MeshBuffer::isMultiDrawSupported()
+{
+    return GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+}
+
+int MeshBuffer::addMesh(const Geometry& geometry)
+{
+    //The layout of the buffer, whatever the vertex format of the geometry
+    VertexLayout layout = m_layout;
+    layout.size = m_layout.stride * geometry.getNbVertices();
+    void* data = malloc(layout.size);
+    packVertices(geometry, layout, data);
+
+    int mesh = addMesh(data, geometry.getNbVertices(), geometry.getIndices(), geometry.getNbIndices());
+    free(data);
+    return mesh;
+}
+
+int MeshBuffer::addMesh(const CachedMesh& mesh)
+{
+    const VertexLayout& layout = mesh.getLayout();
+    if(layout.stride != m_layout.stride || layout.octNormals != m_layout.octNormals ||
+       !sameAttribute(layout.position, m_layout.position) || !sameAttribute(layout.normal, m_layout.normal) || !sameAttribute(layout.uv, m_layout.uv))
+    {
+        ERROR("The layout of this mesh is not the one of the mesh buffer\n");
+        return -1;
+    }
+    return addMesh(mesh.getVertexData(), mesh.getNbVertices(), mesh.getIndices(), mesh.getNbIndices());
+}
+
+int MeshBuffer::addMesh(const void* vertexData, uint32_t nbVertices, const uint32_t* indices, uint32_t nbIndices)
+{
+    if(indices == NULL)
+        nbIndices = nbVertices;
+    if(m_nbVertices + nbVertices > m_maxVertices || m_nbIndices + nbIndices > m_maxIndices)
+    {
+        ERROR("The mesh buffer is full (%u vertices and %u indices more asked, %u and %u left)\n",
+              nbVertices, nbIndices, m_maxVertices - m_nbVertices, m_maxIndices - m_nbIndices);
+        return -1;
+    }
+
+    MeshRange mesh;
+    mesh.firstIndex = m_nbIndices;
+    mesh.nbIndices  = nbIndices;
+    mesh.baseVertex = m_nbVertices;
+    mesh.nbVertices = nbVertices;
+
+    //The indices stay relative to the mesh : the base vertex of its draws moves them to its vertices
+    std::vector<uint32_t> sequence;
+    if(indices == NULL)
+    {
+        sequence.resize(nbVertices);
+        for(uint32_t i = 0; i < nbVertices; i++)
+            sequence[i] = i;
+        indices = &sequence[0];
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, m_nbVertices*m_layout.stride, nbVertices*m_layout.stride, vertexData);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    //The element buffer binding belongs to the VAO
+    glBindVertexArray(m_VAO);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, m_nbIndices*sizeof(uint32_t), nbIndices*sizeof(uint32_t), indices);
+    glBindVertexArray(0);
+
+    m_nbVertices += nbVertices;
+    m_nbIndices  += nbIndices;
+    m_meshes.push_back(mesh);
+    return m_meshes.size()-1;
+}
+
+void MeshBuffer::draw(DrawCommandBuilder& commands, GLenum mode)
+{
+    uint32_t nbCommands = commands.getNbCommands();
+    if(nbCommands == 0)
+        return;
+
+    const std::vector<DrawElementsIndirectCommand>& list = commands.getCommands();
+    glBindVertexArray(m_VAO);
+    if(isMultiDrawSupported())
+    {
+        uint32_t maxDrawID = 0;
+        for(uint32_t i = 0; i < nbCommands; i++)
+            maxDrawID = std::max(maxDrawID, list[i].baseInstance);
+
+        //The draw ID attribute has to cover every base instance
+        if(maxDrawID >= m_drawIDCapacity)
+        {
+            m_drawIDCapacity = std::max(2*m_drawIDCapacity, maxDrawID+1);
+            std::vector<GLuint> drawIDs(m_drawIDCapacity);
+            for(uint32_t i = 0; i < m_drawIDCapacity; i++)
+                drawIDs[i] = i;
+            glBindBuffer(GL_ARRAY_BUFFER, m_drawIDs);
+            glBufferData(GL_ARRAY_BUFFER, m_drawIDCapacity*sizeof(GLuint), &drawIDs[0], GL_STATIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+
+        GLintptr offset;
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands.upload(&offset));
+        glMultiDrawElementsIndirect(mode, GL_UNSIGNED_INT, INDICE_TO_PTR(offset), nbCommands, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+    else
+    {
+        for(uint32_t i = 0; i < nbCommands; i++)
+        {
+            const DrawElementsIndirectCommand& command = list[i];
+            glVertexAttribI1ui(MESH_BUFFER_DRAW_LOCATION, command.baseInstance);
+            glDrawElementsBaseVertex(mode, command.count, GL_UNSIGNED_INT, INDICE_TO_PTR(command.firstIndex*sizeof(uint32_t)), command.baseVertex);
+        }
+    }
+    glBindVertexArray(0);
+}
@@ -0,0 +1,219 @@
+#include "MeshCache.h"
+#include "logger.h"
+#include <cstring>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <direct.h>
+#define MAKE_DIRECTORY(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#define MAKE_DIRECTORY(path) mkdir(path, 0755)
+#endif
+
+//Cache files : magic "MSHC" and version of their layout and of the generators
+#define MESHCACHE_MAGIC   0x4348534d
+#define MESHCACHE_VERSION 1
+
+//Alignment of the vertex and index data inside a file
+#define MESHCACHE_DATA_ALIGNMENT 64
+
+/* \brief Header of a cache file, followed by the key, then the vertex data and the index data (both aligned) */
+struct MeshCacheFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t keyLength;
+    uint32_t format;
+    uint32_t stride;
+    uint32_t octNormals;
+    uint32_t attributes[3][4]; /*!< size, type, normalized, offset of the position, normal and uv*/
+    uint32_t nbVertices;
+    uint32_t nbIndices;
+    uint64_t vertexOffset;
+    uint64_t vertexSize;
+    uint64_t indexOffset;
+};
+
+static const char* s_formatNames[] = {"planar", "interleaved", "compact"};
+
+static std::string makeKey(const std::string& generator, VertexFormat format)
+{
+    return generator + "|" + s_formatNames[format];
+}
+
+static uint64_t alignOffset(uint64_t offset)
+{
+    return (offset + MESHCACHE_DATA_ALIGNMENT-1) & ~(uint64_t)(MESHCACHE_DATA_ALIGNMENT-1);
+}
+
+CachedMesh::CachedMesh()
+{
+    memset(&m_layout, 0, sizeof(m_layout));
+}
+
+CachedMesh::~CachedMesh()
+{
+    clear();
+}
+
+void CachedMesh::clear()
+{
+    m_file.close();
+    if(m_memory)
+        free(m_memory);
+    m_memory     = NULL;
+    m_vertexData = NULL;
+    m_indices    = NULL;
+    m_nbVertices = m_nbIndices = 0;
+}
+
+MeshCache::MeshCache(const char* directory) : m_directory(directory)
+{
+    MAKE_DIRECTORY(directory);
+}
+
+std::string MeshCache::getPath(const std::string& key) const
+{
+    //FNV-1a
+    uint64_t h = 14695981039346656037ULL;
+    for(uint32_t i = 0; i < key.size(); i++)
+    {
+        h ^= (uint8_t)key[i];
+        h *= 1099511628211ULL;
+    }
+
+    char name[32];
+    sprintf(name, "/%016llx.mesh", (unsigned long long)h);
+    return m_directory + name;
+}
+
+bool MeshCache::load(const std::string& generator, VertexFormat format, CachedMesh& mesh)
+{
+    mesh.clear();
+
+    std::string key = makeKey(generator, format);
+    if(!mesh.m_file.open(getPath(key).c_str()))
+        return false;
+
+    //Check everything before pointing in the file : a stale or truncated file is a miss
+    const uint8_t* data = mesh.m_file.getData();
+    size_t size         = mesh.m_file.getSize();
+    MeshCacheFileHeader header;
+    if(size < sizeof(header))
+    {
+        mesh.clear();
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+
+    bool valid = header.magic == MESHCACHE_MAGIC && header.version == MESHCACHE_VERSION &&
+                 header.keyLength == key.size() && sizeof(header) + header.keyLength <= size &&
+                 memcmp(data + sizeof(header), key.c_str(), key.size()) == 0 &&
+                 header.vertexOffset + header.vertexSize <= size &&
+                 header.indexOffset + header.nbIndices*sizeof(uint32_t) <= size &&
+                 header.vertexOffset % MESHCACHE_DATA_ALIGNMENT == 0 && header.indexOffset % MESHCACHE_DATA_ALIGNMENT == 0;
+    if(!valid)
+    {
+        mesh.clear();
+        return false;
+    }
+
+    VertexAttribute* attributes[] = {&mesh.m_layout.position, &mesh.m_layout.normal, &mesh.m_layout.uv};
+    for(uint32_t i = 0; i < 3; i++)
+        *attributes[i] = {(GLint)header.attributes[i][0], (GLenum)header.attributes[i][1], (GLboolean)header.attributes[i][2], header.attributes[i][3]};
+    mesh.m_layout.format     = (VertexFormat)header.format;
+    mesh.m_layout.stride     = header.stride;
+    mesh.m_layout.size       = header.vertexSize;
+    mesh.m_layout.octNormals = header.octNormals != 0;
+
+    mesh.m_vertexData = data + header.vertexOffset;
+    mesh.m_indices    = header.nbIndices ? (const uint32_t*)(data + header.indexOffset) : NULL;
+    mesh.m_nbVertices = header.nbVertices;
+    mesh.m_nbIndices  = header.nbIndices;
+    return true;
+}
+
+bool MeshCache::store(const std::string& generator, const Geometry& geometry)
+{
+    std::string key    = makeKey(generator, geometry.getVertexFormat());
+    VertexLayout layout = getVertexLayout(geometry);
+
+    MeshCacheFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic      = MESHCACHE_MAGIC;
+    header.version    = MESHCACHE_VERSION;
+    header.keyLength  = key.size();
+    header.format     = layout.format;
+    header.stride     = layout.stride;
+    header.octNormals = layout.octNormals;
+    const VertexAttribute* attributes[] = {&layout.position, &layout.normal, &layout.uv};
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        header.attributes[i][0] = attributes[i]->size;
+        header.attributes[i][1] = attributes[i]->type;
+        header.attributes[i][2] = attributes[i]->normalized;
+        header.attributes[i][3] = attributes[i]->offset;
+    }
+    header.nbVertices   = geometry.getNbVertices();
+    header.nbIndices    = geometry.getNbIndices();
+    header.vertexOffset = alignOffset(sizeof(header) + key.size());
+    header.vertexSize   = layout.size;
+    header.indexOffset  = alignOffset(header.vertexOffset + header.vertexSize);
+
+    uint64_t fileSize = header.indexOffset + header.nbIndices*sizeof(uint32_t);
+    uint8_t* content  = (uint8_t*)calloc(fileSize, 1);
+    if(content == NULL)
+        return false;
+    memcpy(content, &header, sizeof(header));
+    memcpy(content + sizeof(header), key.c_str(), key.size());
+    packVertices(geometry, layout, content + header.vertexOffset);
+    if(header.nbIndices)
+        memcpy(content + header.indexOffset, geometry.getIndices(), header.nbIndices*sizeof(uint32_t));
+
+    //Written aside then renamed, so that a concurrent or interrupted run never maps a partial file
+    std::string path    = getPath(key);
+    std::string tmpPath = path + ".tmp";
+    FILE* file = fopen(tmpPath.c_str(), "wb");
+    bool written = file != NULL && fwrite(content, 1, fileSize, file) == fileSize;
+    if(file != NULL)
+        written = (fclose(file) == 0) && written;
+    free(content);
+
+    if(written)
+    {
+        remove(path.c_str());
+        written = rename(tmpPath.c_str(), path.c_str()) == 0;
+    }
+    if(!written)
+    {
+        remove(tmpPath.c_str());
+        WARNING("Could not write the mesh cache file %s\n", path.c_str());
+    }
+    return written;
+}
+
+void MeshCache::getOrCreate(const std::string& generator, VertexFormat format, const std::function<Geometry()>& generate, CachedMesh& mesh)
+{
+    if(load(generator, format, mesh))
+        return;
+
+    Geometry geometry = generate();
+    geometry.setVertexFormat(format);
+    if(store(generator, geometry) && load(generator, format, mesh))
+        return;
+
+    //The cache is not writable : keep the packed data in memory
+    VertexLayout layout = getVertexLayout(geometry);
+    size_t indexOffset  = alignOffset(layout.size);
+    mesh.m_memory = malloc(indexOffset + geometry.getNbIndices()*sizeof(uint32_t));
+    packVertices(geometry, layout, mesh.m_memory);
+    if(geometry.getNbIndices())
+        memcpy((uint8_t*)mesh.m_memory + indexOffset, geometry.getIndices(), geometry.getNbIndices()*sizeof(uint32_t));
+
+    mesh.m_layout     = layout;
+    mesh.m_vertexData = mesh.m_memory;
+    mesh.m_indices    = geometry.getNbIndices() ? (const uint32_t*)((uint8_t*)mesh.m_memory + indexOffset) : NULL;
+    mesh.m_nbVertices = geometry.getNbVertices();
+    mesh.m_nbIndices  = geometry.getNbIndices();
+}
@@ -0,0 +1,396 @@
+#include "MeshOptimizer.h"
+#include "logger.h"
+#include "Allocator.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <map>
+#include <string>
+
+#ifdef _WIN32
+#include <direct.h>
+#define MAKE_DIRECTORY(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#define MAKE_DIRECTORY(path) mkdir(path, 0755)
+#endif
+
+//Size of the LRU cache modeled by Forsyth's scores
+#define FORSYTH_CACHE_SIZE 32
+
+//Cache files : magic "VCAC" and version of their layout
+#define VCACHE_MAGIC   0x43414356
+#define VCACHE_VERSION 1
+
+/* \brief Header of a cache file, followed by the indices then the vertex remap table */
+struct VertexCacheFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t nbVertices;
+    uint32_t nbIndices;
+};
+
+static float forsythVertexScore(int cachePos, uint32_t nbRemainingTriangles)
+{
+    if(nbRemainingTriangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if(cachePos >= 0)
+    {
+        //The vertices of the last triangle get a fixed score, so that the next triangle does not reuse them all
+        if(cachePos < 3)
+            score = 0.75f;
+        else
+            score = powf(1.0f - (cachePos-3) * (1.0f/(FORSYTH_CACHE_SIZE-3)), 1.5f);
+    }
+
+    //Favor the vertices with few triangles left, so that they leave the mesh soon
+    return score + 2.0f * powf((float)nbRemainingTriangles, -0.5f);
+}
+
+VertexCacheStats MeshOptimizer::analyze(const uint32_t* indices, uint32_t nbIndices, uint32_t nbVertices, uint32_t cacheSize)
+{
+    std::vector<uint32_t> cache(cacheSize, 0xffffffff);
+    std::vector<bool>     used(nbVertices, false);
+    uint32_t head = 0, nbTransformed = 0, nbUsed = 0;
+
+    for(uint32_t i = 0; i < nbIndices; i++)
+    {
+        uint32_t v = indices[i];
+        if(!used[v])
+        {
+            used[v] = true;
+            nbUsed++;
+        }
+
+        bool hit = false;
+        for(uint32_t j = 0; j < cacheSize && !hit; j++)
+            hit = (cache[j] == v);
+        if(!hit)
+        {
+            cache[head] = v;
+            head = (head+1) % cacheSize;
+            nbTransformed++;
+        }
+    }
+
+    VertexCacheStats stats;
+    stats.acmr = nbIndices ? nbTransformed / (nbIndices/3.0f) : 0.0f;
+    stats.atvr = nbUsed    ? nbTransformed / (float)nbUsed    : 0.0f;
+    return stats;
+}
+
+void MeshOptimizer::optimizeVertexCache(uint32_t* dst, const uint32_t* indices, uint32_t nbIndices, uint32_t nbVertices)
+{
+    uint32_t nbTriangles = nbIndices/3;
+
+    //Every temporary array comes from the scratch arena, given back when the function returns
+    ScratchScope scratch;
+
+    //Triangles of each vertex (compressed lists). The first nbRemaining[v] entries are the triangles not emitted yet
+    uint32_t* nbRemaining = scratch.allocate<uint32_t>(nbVertices);
+    memset(nbRemaining, 0, sizeof(uint32_t)*nbVertices);
+    for(uint32_t i = 0; i < nbIndices; i++)
+        nbRemaining[indices[i]]++;
+
+    uint32_t* firstTriangle = scratch.allocate<uint32_t>(nbVertices+1);
+    uint32_t* fill          = scratch.allocate<uint32_t>(nbVertices);
+    firstTriangle[0] = 0;
+    for(uint32_t v = 0; v < nbVertices; v++)
+    {
+        fill[v]            = firstTriangle[v];
+        firstTriangle[v+1] = firstTriangle[v] + nbRemaining[v];
+    }
+
+    uint32_t* triangles = scratch.allocate<uint32_t>(nbIndices);
+    for(uint32_t i = 0; i < nbIndices; i++)
+        triangles[fill[indices[i]]++] = i/3;
+
+    int*   cachePos    = scratch.allocate<int>(nbVertices);
+    float* vertexScore = scratch.allocate<float>(nbVertices);
+    for(uint32_t v = 0; v < nbVertices; v++)
+    {
+        cachePos[v]    = -1;
+        vertexScore[v] = forsythVertexScore(-1, nbRemaining[v]);
+    }
+
+    float*   triangleScore = scratch.allocate<float>(nbTriangles);
+    uint8_t* emitted       = scratch.allocate<uint8_t>(nbTriangles);
+    memset(emitted, 0, nbTriangles);
+    int bestTriangle = -1;
+    for(uint32_t t = 0; t < nbTriangles; t++)
+    {
+        triangleScore[t] = vertexScore[indices[3*t]] + vertexScore[indices[3*t+1]] + vertexScore[indices[3*t+2]];
+        if(bestTriangle < 0 || triangleScore[t] > triangleScore[bestTriangle])
+            bestTriangle = t;
+    }
+
+    std::vector<uint32_t> cache, newCache;
+    cache.reserve(FORSYTH_CACHE_SIZE+3);
+    newCache.reserve(FORSYTH_CACHE_SIZE+3);
+    uint32_t scanPos = 0;
+
+    for(uint32_t out = 0; out < nbTriangles; out++)
+    {
+        //Nothing in the cache connects to a remaining triangle : restart from the next one not emitted
+        if(bestTriangle < 0)
+        {
+            while(emitted[scanPos])
+                scanPos++;
+            bestTriangle = scanPos;
+        }
+
+        const uint32_t* tri = indices + 3*bestTriangle;
+        memcpy(dst + 3*out, tri, 3*sizeof(uint32_t));
+        emitted[bestTriangle] = 1;
+
+        //Remove the triangle from the lists of its vertices
+        for(uint32_t k = 0; k < 3; k++)
+        {
+            uint32_t v      = tri[k];
+            uint32_t* list  = &triangles[firstTriangle[v]];
+            for(uint32_t j = 0; j < nbRemaining[v]; j++)
+            {
+                if(list[j] == (uint32_t)bestTriangle)
+                {
+                    list[j] = list[nbRemaining[v]-1];
+                    list[nbRemaining[v]-1] = bestTriangle;
+                    break;
+                }
+            }
+            nbRemaining[v]--;
+        }
+
+        //The vertices of the triangle go in front of the LRU cache
+        newCache.assign(tri, tri+3);
+        for(uint32_t j = 0; j < cache.size(); j++)
+            if(cache[j] != tri[0] && cache[j] != tri[1] && cache[j] != tri[2])
+                newCache.push_back(cache[j]);
+        cache.swap(newCache);
+
+        for(uint32_t j = 0; j < cache.size(); j++)
+        {
+            uint32_t v = cache[j];
+            cachePos[v]    = (j < FORSYTH_CACHE_SIZE) ? (int)j : -1;
+            vertexScore[v] = forsythVertexScore(cachePos[v], nbRemaining[v]);
+        }
+
+        //Only the triangles touching the cache changed score : the next best one is among them
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+        for(uint32_t j = 0; j < cache.size(); j++)
+        {
+            uint32_t v = cache[j];
+            for(uint32_t l = 0; l < nbRemaining[v]; l++)
+            {
+                uint32_t t = triangles[firstTriangle[v] + l];
+                triangleScore[t] = vertexScore[indices[3*t]] + vertexScore[indices[3*t+1]] + vertexScore[indices[3*t+2]];
+                if(triangleScore[t] > bestScore)
+                {
+                    bestScore    = triangleScore[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        if(cache.size() > FORSYTH_CACHE_SIZE)
+            cache.resize(FORSYTH_CACHE_SIZE);
+    }
+}
+
+void MeshOptimizer::optimizeVertexFetch(uint32_t* remap, uint32_t* indices, uint32_t nbIndices, uint32_t nbVertices)
+{
+    memset(remap, 0xff, nbVertices*sizeof(uint32_t));
+
+    uint32_t next = 0;
+    for(uint32_t i = 0; i < nbIndices; i++)
+    {
+        uint32_t v = indices[i];
+        if(remap[v] == 0xffffffff)
+            remap[v] = next++;
+        indices[i] = remap[v];
+    }
+
+    for(uint32_t v = 0; v < nbVertices; v++)
+        if(remap[v] == 0xffffffff)
+            remap[v] = next++;
+}
+
+void MeshOptimizer::weld(Geometry& geometry)
+{
+    //Key : the 8 floats of the vertex
+    std::map<std::vector<float>, uint32_t> unique;
+    std::vector<uint32_t> indices(geometry.m_nbVertices);
+    std::vector<uint32_t> firsts;
+
+    for(uint32_t i = 0; i < geometry.m_nbVertices; i++)
+    {
+        std::vector<float> key(8);
+        memcpy(&key[0], geometry.m_vertices + 3*i, 3*sizeof(float));
+        memcpy(&key[3], geometry.m_normals  + 3*i, 3*sizeof(float));
+        memcpy(&key[6], geometry.m_uvs      + 2*i, 2*sizeof(float));
+
+        std::map<std::vector<float>, uint32_t>::iterator it = unique.find(key);
+        if(it == unique.end())
+        {
+            it = unique.insert(std::make_pair(key, (uint32_t)firsts.size())).first;
+            firsts.push_back(i);
+        }
+        indices[i] = it->second;
+    }
+
+    //Keep the first occurrence of each vertex, in order. The data of a geometry is immutable (maybe shared) : fill a new block
+    Geometry welded(geometry.m_allocator);
+    welded.allocate(firsts.size(), geometry.m_nbVertices);
+    for(uint32_t i = 0; i < firsts.size(); i++)
+    {
+        memcpy(welded.m_vertices + 3*i, geometry.m_vertices + 3*firsts[i], 3*sizeof(float));
+        memcpy(welded.m_normals  + 3*i, geometry.m_normals  + 3*firsts[i], 3*sizeof(float));
+        memcpy(welded.m_uvs      + 2*i, geometry.m_uvs      + 2*firsts[i], 2*sizeof(float));
+    }
+    memcpy(welded.m_indices, &indices[0], sizeof(uint32_t)*welded.m_nbIndices);
+
+    welded.m_vertexFormat = geometry.m_vertexFormat;
+    geometry = std::move(welded);
+}
+
+bool MeshOptimizer::validate(const uint32_t* indices, uint32_t nbIndices, const uint32_t* remap, uint32_t nbVertices)
+{
+    for(uint32_t i = 0; i < nbIndices; i++)
+        if(indices[i] >= nbVertices)
+            return false;
+
+    //Each new place taken once : a duplicate would leave a vertex of the reordered geometry unwritten
+    ScratchScope scratch;
+    bool* taken = scratch.allocate<bool>(nbVertices);
+    memset(taken, 0, nbVertices*sizeof(bool));
+    for(uint32_t v = 0; v < nbVertices; v++)
+    {
+        if(remap[v] >= nbVertices || taken[remap[v]])
+            return false;
+        taken[remap[v]] = true;
+    }
+    return true;
+}
+
+void MeshOptimizer::apply(Geometry& geometry, const uint32_t* indices, const uint32_t* remap)
+{
+    uint32_t n = geometry.m_nbVertices;
+    Geometry reordered(geometry.m_allocator);
+    reordered.allocate(n, geometry.m_nbIndices);
+
+    for(uint32_t v = 0; v < n; v++)
+    {
+        memcpy(reordered.m_vertices + 3*remap[v], geometry.m_vertices + 3*v, 3*sizeof(float));
+        memcpy(reordered.m_normals  + 3*remap[v], geometry.m_normals  + 3*v, 3*sizeof(float));
+        memcpy(reordered.m_uvs      + 2*remap[v], geometry.m_uvs      + 2*v, 2*sizeof(float));
+    }
+    memcpy(reordered.m_indices, indices, sizeof(uint32_t)*geometry.m_nbIndices);
+
+    reordered.m_vertexFormat = geometry.m_vertexFormat;
+    geometry = std::move(reordered);
+}
+
+uint64_t MeshOptimizer::hash(const Geometry& geometry)
+{
+    //FNV-1a
+    uint64_t h = 14695981039346656037ULL;
+    struct {const void* data; size_t size;} blocks[] = {
+        {&geometry.m_nbVertices, sizeof(uint32_t)},
+        {&geometry.m_nbIndices,  sizeof(uint32_t)},
+        {geometry.m_vertices,    sizeof(float)*3*geometry.m_nbVertices},
+        {geometry.m_normals,     sizeof(float)*3*geometry.m_nbVertices},
+        {geometry.m_uvs,         sizeof(float)*2*geometry.m_nbVertices},
+        {geometry.m_indices,     sizeof(uint32_t)*geometry.m_nbIndices}
+    };
+
+    for(uint32_t b = 0; b < sizeof(blocks)/sizeof(blocks[0]); b++)
+    {
+        const uint8_t* bytes = (const uint8_t*)blocks[b].data;
+        for(size_t i = 0; i < blocks[b].size; i++)
+        {
+            h ^= bytes[i];
+            h *= 1099511628211ULL;
+        }
+    }
+    return h;
+}
+
+VertexCacheStats MeshOptimizer::optimize(Geometry& geometry, const char* cacheDir)
+{
+    if(geometry.m_indices == NULL)
+        weld(geometry);
+
+    uint32_t nbIndices  = geometry.m_nbIndices;
+    uint32_t nbVertices = geometry.m_nbVertices;
+    VertexCacheStats before = analyze(geometry.m_indices, nbIndices, nbVertices);
+
+    if(nbIndices == 0)
+        return before;
+
+    //The results come from the scratch arena : the geometry itself must not live there, apply allocates its new block after them
+    ScratchScope scratch;
+    uint32_t* indices = scratch.allocate<uint32_t>(nbIndices);
+    uint32_t* remap   = scratch.allocate<uint32_t>(nbVertices);
+
+    //Already optimized in a previous run ?
+    std::string cachePath;
+    bool cached = false;
+    if(cacheDir != NULL)
+    {
+        char name[32];
+        sprintf(name, "/%016llx.vcache", (unsigned long long)hash(geometry));
+        cachePath = std::string(cacheDir) + name;
+
+        FILE* file = fopen(cachePath.c_str(), "rb");
+        if(file != NULL)
+        {
+            VertexCacheFileHeader header;
+            cached = fread(&header, sizeof(header), 1, file) == 1 &&
+                     header.magic == VCACHE_MAGIC && header.version == VCACHE_VERSION &&
+                     header.nbVertices == nbVertices && header.nbIndices == nbIndices &&
+                     fread(indices, sizeof(uint32_t), nbIndices, file) == nbIndices &&
+                     fread(remap, sizeof(uint32_t), nbVertices, file) == nbVertices &&
+                     fgetc(file) == EOF;
+            fclose(file);
+
+            //A truncated or corrupted file is a miss : the geometry is optimized again and the file rewritten
+            if(cached && !validate(indices, nbIndices, remap, nbVertices))
+            {
+                WARNING("The vertex cache file %s is corrupted, the mesh is optimized again\n", cachePath.c_str());
+                cached = false;
+            }
+        }
+    }
+
+    if(!cached)
+    {
+        optimizeVertexCache(indices, geometry.m_indices, nbIndices, nbVertices);
+        optimizeVertexFetch(remap, indices, nbIndices, nbVertices);
+
+        if(cacheDir != NULL)
+        {
+            MAKE_DIRECTORY(cacheDir);
+            FILE* file = fopen(cachePath.c_str(), "wb");
+            if(file != NULL)
+            {
+                VertexCacheFileHeader header = {VCACHE_MAGIC, VCACHE_VERSION, nbVertices, nbIndices};
+                fwrite(&header, sizeof(header), 1, file);
+                fwrite(indices, sizeof(uint32_t), nbIndices, file);
+                fwrite(remap, sizeof(uint32_t), nbVertices, file);
+                fclose(file);
+            }
+            else
+                WARNING("Could not write the vertex cache file %s\n", cachePath.c_str());
+        }
+    }
+
+    apply(geometry, indices, remap);
+
+    VertexCacheStats after = analyze(geometry.m_indices, nbIndices, nbVertices);
+    INFO("Mesh of %u triangles%s : ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", nbIndices/3, cached ? " (cached)" : "",
+         before.acmr, after.acmr, before.atvr, after.atvr);
+    return after;
+}
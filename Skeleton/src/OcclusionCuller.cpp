@@ -0,0 +1,110 @@
+#include "OcclusionCuller.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+OcclusionQuery::OcclusionQuery()
+{}
+
+OcclusionQuery::~OcclusionQuery()
+{
+    if(m_id)
+        glDeleteQueries(1, &m_id);
+}
+
+void OcclusionQuery::poll()
+{
+    if(!m_pending)
+        return;
+
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(m_id, GL_QUERY_RESULT_AVAILABLE, &available);
+    if(available == GL_FALSE)
+        return; //Keep the previous state (temporal coherence) instead of waiting for the GPU
+
+    GLuint nbSamples = 0;
+    glGetQueryObjectuiv(m_id, GL_QUERY_RESULT, &nbSamples);
+    m_state   = (nbSamples > 0) ? OCCLUSION_VISIBLE : OCCLUSION_OCCLUDED;
+    m_pending = false;
+}
+
+void OcclusionQuery::begin()
+{
+    if(m_id == 0)
+        glGenQueries(1, &m_id);
+    glBeginQuery(GL_SAMPLES_PASSED, m_id);
+}
+
+void OcclusionQuery::end()
+{
+    glEndQuery(GL_SAMPLES_PASSED);
+    m_pending = true;
+}
+
+OcclusionCuller::OcclusionCuller(Shader* proxyShader, GLuint proxyVAO, uint32_t proxyFirstIndex, uint32_t proxyNbIndices, float proxyScale) :
+    m_proxyShader(proxyShader), m_proxyVAO(proxyVAO), m_proxyFirstIndex(proxyFirstIndex), m_proxyNbIndices(proxyNbIndices), m_proxyScale(proxyScale)
+{}
+
+void OcclusionCuller::newFrame()
+{
+    m_nbProxyTests       = 0;
+    m_nbConditionalDraws = 0;
+}
+
+void OcclusionCuller::beginBody(OcclusionQuery& query, const glm::mat4& mvp)
+{
+    m_conditional = m_counting = false;
+    if(!m_enabled)
+        return;
+
+    query.poll();
+
+    //Visible last time : draw it for real and count its samples, if the previous count came back
+    if(query.getState() == OCCLUSION_VISIBLE)
+    {
+        if(!query.isPending())
+        {
+            query.begin();
+            m_counting = true;
+        }
+        return;
+    }
+
+    //Occluded or unknown : rasterize the proxy without writing anything, then let the GPU decide
+    if(!query.isPending())
+    {
+        glm::mat4 proxyMVP = glm::scale(mvp, glm::vec3(m_proxyScale));
+
+        glUseProgram(m_proxyShader->getProgramID());
+        glBindVertexArray(m_proxyVAO);
+        GLint uMVP = glGetUniformLocation(m_proxyShader->getProgramID(), "uMVP");
+        glUniformMatrix4fv(uMVP, 1, GL_FALSE, glm::value_ptr(proxyMVP));
+
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+
+        query.begin();
+        glDrawElements(GL_TRIANGLES, m_proxyNbIndices, GL_UNSIGNED_INT, (void*)(m_proxyFirstIndex*sizeof(uint32_t)));
+        query.end();
+
+        glDepthMask(GL_TRUE);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+        glBindVertexArray(0);
+        glUseProgram(0);
+        m_nbProxyTests++;
+    }
+
+    //NO_WAIT : if the result is not there yet when the GPU reaches the draw, it draws
+    glBeginConditionalRender(query.getID(), GL_QUERY_NO_WAIT);
+    m_conditional = true;
+    m_nbConditionalDraws++;
+}
+
+void OcclusionCuller::endBody(OcclusionQuery& query)
+{
+    if(m_counting)
+        query.end();
+    if(m_conditional)
+        glEndConditionalRender();
+    m_conditional = m_counting = false;
+}
@@ -0,0 +1,101 @@
+#include "OverdrawCounter.h"
+
+OverdrawCounter::OverdrawCounter(Shader* coverageShader, GLuint emptyVAO) : m_coverageShader(coverageShader), m_emptyVAO(emptyVAO)
+{
+    for(uint32_t i = 0; i < OVERDRAW_NB_PASSES; i++)
+        m_nbSamples[i] = 0;
+}
+
+OverdrawCounter::~OverdrawCounter()
+{
+    if(!m_queries.empty())
+        glDeleteQueries(m_queries.size(), &m_queries[0]);
+}
+
+void OverdrawCounter::begin(OverdrawPass pass)
+{
+    end();
+    collect(false);
+
+    if(m_free.empty())
+    {
+        GLuint id;
+        glGenQueries(1, &id);
+        m_queries.push_back(id);
+        m_free.push_back(id);
+    }
+    m_currentID = m_free.back();
+    m_free.pop_back();
+    m_current = pass;
+    glBeginQuery(GL_SAMPLES_PASSED, m_currentID);
+}
+
+void OverdrawCounter::end()
+{
+    if(m_current == OVERDRAW_NB_PASSES)
+        return;
+    glEndQuery(GL_SAMPLES_PASSED);
+    m_pending.push_back({m_currentID, m_current});
+    m_current = OVERDRAW_NB_PASSES;
+}
+
+void OverdrawCounter::measureCoverage()
+{
+    //Cleared pixels keep the far depth : the triangle on the far plane is not GREATER there, and writes nothing anywhere
+    glUseProgram(m_coverageShader->getProgramID());
+    glBindVertexArray(m_emptyVAO);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glDepthFunc(GL_GREATER);
+
+    begin(OVERDRAW_COVERAGE);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    end();
+
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
+
+void OverdrawCounter::finish()
+{
+    end();
+    collect(true);
+}
+
+void OverdrawCounter::reset()
+{
+    finish();
+    for(uint32_t i = 0; i < OVERDRAW_NB_PASSES; i++)
+        m_nbSamples[i] = 0;
+}
+
+double OverdrawCounter::getPerPixel(OverdrawPass pass) const
+{
+    if(m_nbSamples[OVERDRAW_COVERAGE] == 0)
+        return 0.0;
+    return (double)m_nbSamples[pass] / m_nbSamples[OVERDRAW_COVERAGE];
+}
+
+void OverdrawCounter::collect(bool wait)
+{
+    while(!m_pending.empty())
+    {
+        const PendingQuery& query = m_pending.front();
+        if(!wait)
+        {
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available);
+            if(available == GL_FALSE)
+                return; //The next ones were issued later : not there either
+        }
+
+        GLuint nbSamples = 0;
+        glGetQueryObjectuiv(query.id, GL_QUERY_RESULT, &nbSamples);
+        m_nbSamples[query.pass] += nbSamples;
+        m_free.push_back(query.id);
+        m_pending.pop_front();
+    }
+}
@@ -0,0 +1,22 @@
+#include "Parallel.h"
+#include "JobSystem.h"
+
+uint32_t getNbWorkers()
+{
+    return JobSystem::getShared().getNbWorkers();
+}
+
+void setNbWorkers(uint32_t nbWorkers)
+{
+    JobSystem::resetShared(nbWorkers, JobSystem::getShared().isPinned());
+}
+
+void setWorkerPinning(bool pinned)
+{
+    JobSystem::resetShared(getNbWorkers(), pinned);
+}
+
+void parallelFor(uint32_t begin, uint32_t end, uint32_t minBandSize, const std::function<void(uint32_t first, uint32_t last)>& body, const char* name)
+{
+    JobSystem::getShared().parallelFor(begin, end, minBandSize, body, name);
+}
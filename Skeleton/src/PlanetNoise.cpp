@@ -0,0 +1,382 @@
+#include "PlanetNoise.h"
+#include "PlanetTerrain.h"
+#include "Allocator.h"
+#include "Parallel.h"
+#include "Simd.h"
+#include <cmath>
+
+//Lattice hash : each coordinate is multiplied by its own odd constant, the three are mixed with the seed, then scrambled.
+//The gradient is taken from the top 4 bits, which depend on every bit of the input
+#define HASH_X   0x8da6b343u
+#define HASH_Y   0xd8163841u
+#define HASH_Z   0xcb1ab31fu
+#define HASH_MIX 0x2c1b3c6du
+
+//Seed increment between two octaves, so that they are not correlated
+#define OCTAVE_SEED_STEP 0x9e3779b9u
+
+#define MAX_OCTAVES 32
+
+/* \brief Per octave constants shared by the scalar and SIMD paths, so that both compute exactly the same operations */
+struct OctaveTable
+{
+    uint32_t nbOctaves;
+    float    frequency[MAX_OCTAVES];
+    float    amplitude[MAX_OCTAVES];
+    uint32_t seed[MAX_OCTAVES];
+    float    offset[MAX_OCTAVES]; /*!< Shift of the lattice, so that the lattices of the octaves do not line up (the noise is 0 on their points)*/
+    float    norm; /*!< Sum of the amplitudes*/
+};
+
+static void buildOctaveTable(const PlanetNoiseParams& params, OctaveTable& table)
+{
+    table.nbOctaves = params.octaves < MAX_OCTAVES ? params.octaves : MAX_OCTAVES;
+    table.norm = 0.0f;
+    float frequency = params.frequency, amplitude = 1.0f;
+    uint32_t seed = params.seed;
+    for(uint32_t o = 0; o < table.nbOctaves; o++)
+    {
+        table.frequency[o] = frequency;
+        table.amplitude[o] = amplitude;
+        table.seed[o]      = seed;
+        table.offset[o]    = ((seed*HASH_MIX) >> 16) / 256.0f;
+        table.norm        += amplitude;
+        frequency *= params.lacunarity;
+        amplitude *= params.gain;
+        seed      += OCTAVE_SEED_STEP;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/*                                   Scalar                                   */
+/*----------------------------------------------------------------------------*/
+
+static inline uint32_t hashCorner(uint32_t hx, uint32_t hy, uint32_t hz, uint32_t seed)
+{
+    uint32_t h = hx ^ hy ^ hz ^ seed;
+    h ^= h >> 15;
+    h *= HASH_MIX;
+    return h >> 28;
+}
+
+//The 12 edge gradients of the improved Perlin noise (4 of them twice)
+static inline float gradient(uint32_t g, float x, float y, float z)
+{
+    float u = g < 8 ? x : y;
+    float v = g < 4 ? y : ((g == 12 || g == 14) ? x : z);
+    return ((g & 1) ? -u : u) + ((g & 2) ? -v : v);
+}
+
+static inline float fade(float t)
+{
+    return t*t*t*(t*(t*6.0f - 15.0f) + 10.0f);
+}
+
+static inline float lerp(float a, float b, float t)
+{
+    return a + t*(b - a);
+}
+
+static float gradientNoise(float x, float y, float z, uint32_t seed)
+{
+    float flx = floorf(x), fly = floorf(y), flz = floorf(z);
+    float fx  = x - flx,   fy  = y - fly,   fz  = z - flz;
+    float fx1 = fx - 1.0f, fy1 = fy - 1.0f, fz1 = fz - 1.0f;
+
+    //(i+1)*H = i*H + H : one multiplication per axis
+    uint32_t hx0 = (uint32_t)(int32_t)flx * HASH_X, hx1 = hx0 + HASH_X;
+    uint32_t hy0 = (uint32_t)(int32_t)fly * HASH_Y, hy1 = hy0 + HASH_Y;
+    uint32_t hz0 = (uint32_t)(int32_t)flz * HASH_Z, hz1 = hz0 + HASH_Z;
+
+    float g000 = gradient(hashCorner(hx0, hy0, hz0, seed), fx,  fy,  fz);
+    float g100 = gradient(hashCorner(hx1, hy0, hz0, seed), fx1, fy,  fz);
+    float g010 = gradient(hashCorner(hx0, hy1, hz0, seed), fx,  fy1, fz);
+    float g110 = gradient(hashCorner(hx1, hy1, hz0, seed), fx1, fy1, fz);
+    float g001 = gradient(hashCorner(hx0, hy0, hz1, seed), fx,  fy,  fz1);
+    float g101 = gradient(hashCorner(hx1, hy0, hz1, seed), fx1, fy,  fz1);
+    float g011 = gradient(hashCorner(hx0, hy1, hz1, seed), fx,  fy1, fz1);
+    float g111 = gradient(hashCorner(hx1, hy1, hz1, seed), fx1, fy1, fz1);
+
+    float u = fade(fx), v = fade(fy), w = fade(fz);
+    float a00 = lerp(g000, g100, u), a10 = lerp(g010, g110, u);
+    float a01 = lerp(g001, g101, u), a11 = lerp(g011, g111, u);
+    return lerp(lerp(a00, a10, v), lerp(a01, a11, v), w);
+}
+
+static float relief(const PlanetNoiseParams& params, const OctaveTable& table, float x, float y, float z)
+{
+    float fbm = 0.0f, ridged = 0.0f, weight = 1.0f;
+    for(uint32_t o = 0; o < table.nbOctaves; o++)
+    {
+        float f = table.frequency[o], s = table.offset[o];
+        float n = gradientNoise(x*f + s, y*f + s, z*f + s, table.seed[o]);
+        fbm += table.amplitude[o]*n;
+
+        //Ridged multifractal (Musgrave) : crests where the noise crosses 0, and details only on the crests of the previous octaves
+        float r = 1.0f - fabsf(n);
+        r = r*r*weight;
+        weight = (2.0f*r < 1.0f) ? 2.0f*r : 1.0f;
+        ridged += table.amplitude[o]*r;
+    }
+    return params.amplitude*(((1.0f - params.ridged)*fbm + params.ridged*(2.0f*ridged - table.norm)) / table.norm);
+}
+
+/*----------------------------------------------------------------------------*/
+/*                                    SSE2                                    */
+/*----------------------------------------------------------------------------*/
+
+#ifdef USE_SSE2
+//32 bits multiplication (SSE4.1 has _mm_mullo_epi32, SSE2 only 32x32->64 on the even lanes)
+static inline __m128i mullo(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd  = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+//mask ? ifTrue : ifFalse
+static inline __m128 blend(__m128 mask, __m128 ifFalse, __m128 ifTrue)
+{
+    return _mm_or_ps(_mm_and_ps(mask, ifTrue), _mm_andnot_ps(mask, ifFalse));
+}
+
+static inline __m128 floor4(__m128 x, __m128i& i)
+{
+    __m128i t    = _mm_cvttps_epi32(x);
+    __m128  ft   = _mm_cvtepi32_ps(t);
+    __m128  mask = _mm_cmpgt_ps(ft, x); //Truncated towards 0 above x : negative non integer x
+    i = _mm_add_epi32(t, _mm_castps_si128(mask));
+    return _mm_sub_ps(ft, _mm_and_ps(mask, _mm_set1_ps(1.0f)));
+}
+
+static inline __m128i hashCorner4(__m128i hx, __m128i hy, __m128i hz, __m128i seed)
+{
+    __m128i h = _mm_xor_si128(_mm_xor_si128(hx, hy), _mm_xor_si128(hz, seed));
+    h = _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+    h = mullo(h, _mm_set1_epi32(HASH_MIX));
+    return _mm_srli_epi32(h, 28);
+}
+
+static inline __m128 gradient4(__m128i g, __m128 x, __m128 y, __m128 z)
+{
+    __m128 lt8 = _mm_castsi128_ps(_mm_cmplt_epi32(g, _mm_set1_epi32(8)));
+    __m128 lt4 = _mm_castsi128_ps(_mm_cmplt_epi32(g, _mm_set1_epi32(4)));
+    __m128 useX = _mm_castsi128_ps(_mm_or_si128(_mm_cmpeq_epi32(g, _mm_set1_epi32(12)), _mm_cmpeq_epi32(g, _mm_set1_epi32(14))));
+    __m128 u = blend(lt8, y, x);
+    __m128 v = blend(lt4, blend(useX, z, x), y);
+
+    //The low bits of g, moved to the sign bit, negate u and v
+    __m128 signU = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(g, _mm_set1_epi32(1)), 31));
+    __m128 signV = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(g, _mm_set1_epi32(2)), 30));
+    return _mm_add_ps(_mm_xor_ps(u, signU), _mm_xor_ps(v, signV));
+}
+
+static inline __m128 fade4(__m128 t)
+{
+    __m128 poly = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f));
+    return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), poly);
+}
+
+static inline __m128 lerp4(__m128 a, __m128 b, __m128 t)
+{
+    return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+}
+
+static __m128 gradientNoise4(__m128 x, __m128 y, __m128 z, __m128i seed)
+{
+    __m128i ix, iy, iz;
+    __m128 flx = floor4(x, ix), fly = floor4(y, iy), flz = floor4(z, iz);
+    __m128 fx  = _mm_sub_ps(x, flx), fy = _mm_sub_ps(y, fly), fz = _mm_sub_ps(z, flz);
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 fx1 = _mm_sub_ps(fx, one), fy1 = _mm_sub_ps(fy, one), fz1 = _mm_sub_ps(fz, one);
+
+    __m128i hx0 = mullo(ix, _mm_set1_epi32(HASH_X)), hx1 = _mm_add_epi32(hx0, _mm_set1_epi32(HASH_X));
+    __m128i hy0 = mullo(iy, _mm_set1_epi32(HASH_Y)), hy1 = _mm_add_epi32(hy0, _mm_set1_epi32(HASH_Y));
+    __m128i hz0 = mullo(iz, _mm_set1_epi32(HASH_Z)), hz1 = _mm_add_epi32(hz0, _mm_set1_epi32(HASH_Z));
+
+    __m128 g000 = gradient4(hashCorner4(hx0, hy0, hz0, seed), fx,  fy,  fz);
+    __m128 g100 = gradient4(hashCorner4(hx1, hy0, hz0, seed), fx1, fy,  fz);
+    __m128 g010 = gradient4(hashCorner4(hx0, hy1, hz0, seed), fx,  fy1, fz);
+    __m128 g110 = gradient4(hashCorner4(hx1, hy1, hz0, seed), fx1, fy1, fz);
+    __m128 g001 = gradient4(hashCorner4(hx0, hy0, hz1, seed), fx,  fy,  fz1);
+    __m128 g101 = gradient4(hashCorner4(hx1, hy0, hz1, seed), fx1, fy,  fz1);
+    __m128 g011 = gradient4(hashCorner4(hx0, hy1, hz1, seed), fx,  fy1, fz1);
+    __m128 g111 = gradient4(hashCorner4(hx1, hy1, hz1, seed), fx1, fy1, fz1);
+
+    __m128 u = fade4(fx), v = fade4(fy), w = fade4(fz);
+    __m128 a00 = lerp4(g000, g100, u), a10 = lerp4(g010, g110, u);
+    __m128 a01 = lerp4(g001, g101, u), a11 = lerp4(g011, g111, u);
+    return lerp4(lerp4(a00, a10, v), lerp4(a01, a11, v), w);
+}
+
+static __m128 relief4(const PlanetNoiseParams& params, const OctaveTable& table, __m128 x, __m128 y, __m128 z)
+{
+    __m128 fbm = _mm_setzero_ps(), ridged = _mm_setzero_ps(), weight = _mm_set1_ps(1.0f);
+    __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    for(uint32_t o = 0; o < table.nbOctaves; o++)
+    {
+        __m128 f = _mm_set1_ps(table.frequency[o]);
+        __m128 a = _mm_set1_ps(table.amplitude[o]);
+        __m128 s = _mm_set1_ps(table.offset[o]);
+        __m128 n = gradientNoise4(_mm_add_ps(_mm_mul_ps(x, f), s), _mm_add_ps(_mm_mul_ps(y, f), s), _mm_add_ps(_mm_mul_ps(z, f), s), _mm_set1_epi32(table.seed[o]));
+        fbm = _mm_add_ps(fbm, _mm_mul_ps(a, n));
+
+        __m128 r = _mm_sub_ps(_mm_set1_ps(1.0f), _mm_and_ps(n, absMask));
+        r = _mm_mul_ps(_mm_mul_ps(r, r), weight);
+        weight = _mm_min_ps(_mm_mul_ps(_mm_set1_ps(2.0f), r), _mm_set1_ps(1.0f));
+        ridged = _mm_add_ps(ridged, _mm_mul_ps(a, r));
+    }
+    __m128 mixed = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(1.0f - params.ridged), fbm),
+                              _mm_mul_ps(_mm_set1_ps(params.ridged), _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(2.0f), ridged), _mm_set1_ps(table.norm))));
+    return _mm_mul_ps(_mm_set1_ps(params.amplitude), _mm_div_ps(mixed, _mm_set1_ps(table.norm)));
+}
+#endif
+
+/*----------------------------------------------------------------------------*/
+/*                                 PlanetNoise                                */
+/*----------------------------------------------------------------------------*/
+
+PlanetNoise::PlanetNoise(const PlanetNoiseParams& params, uint32_t tileResolution, uint32_t cacheSize) : m_params(params), m_tileResolution(tileResolution), m_cache(cacheSize)
+{}
+
+float PlanetNoise::sample(const glm::vec3& direction) const
+{
+    OctaveTable table;
+    buildOctaveTable(m_params, table);
+    return relief(m_params, table, direction.x, direction.y, direction.z);
+}
+
+void PlanetNoise::sample(const float* x, const float* y, const float* z, float* heights, uint32_t count) const
+{
+    OctaveTable table;
+    buildOctaveTable(m_params, table);
+
+    uint32_t i = 0;
+#ifdef USE_SSE2
+    for(; i+4 <= count; i+=4)
+        _mm_storeu_ps(heights+i, relief4(m_params, table, _mm_loadu_ps(x+i), _mm_loadu_ps(y+i), _mm_loadu_ps(z+i)));
+#endif
+    for(; i < count; i++)
+        heights[i] = relief(m_params, table, x[i], y[i], z[i]);
+}
+
+void PlanetNoise::sampleMap(uint32_t width, uint32_t height, float* heights) const
+{
+    parallelFor(0, height, 8, [&](uint32_t first, uint32_t last)
+    {
+        ScratchScope scratch;
+        float* x = scratch.allocate<float>(width);
+        float* y = scratch.allocate<float>(width);
+        float* z = scratch.allocate<float>(width);
+        for(uint32_t j = first; j < last; j++)
+        {
+            //Texel centers, same position formula as Sphere
+            float phi = M_PI * (j + 0.5f) / height;
+            for(uint32_t i = 0; i < width; i++)
+            {
+                float theta = 2.0f*M_PI * (i + 0.5f) / width;
+                x[i] = sinf(phi)*sinf(theta);
+                y[i] = cosf(phi);
+                z[i] = cosf(theta)*sinf(phi);
+            }
+            sample(x, y, z, heights + j*width, width);
+        }
+    });
+}
+
+std::shared_ptr<const PlanetTile> PlanetNoise::getTile(uint32_t face, uint32_t depth, uint32_t ix, uint32_t iy)
+{
+    uint64_t key = getTileKey(face, depth, ix, iy);
+    std::shared_ptr<const PlanetTile> tile = findTile(key);
+    if(!tile)
+    {
+        tile = generateTile(key);
+        storeTile(key, tile);
+    }
+    return tile;
+}
+
+void PlanetNoise::prefetchTiles(const std::vector<uint64_t>& keys)
+{
+    std::vector<uint64_t> missing;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(uint32_t i = 0; i < keys.size(); i++)
+            if(!m_cache.contains(keys[i]))
+                missing.push_back(keys[i]);
+    }
+
+    //One tile per task : a tile is too small to be worth splitting
+    std::vector<std::shared_ptr<const PlanetTile> > tiles(missing.size());
+    parallelFor(0, missing.size(), 2, [&](uint32_t first, uint32_t last)
+    {
+        for(uint32_t i = first; i < last; i++)
+            tiles[i] = generateTile(missing[i]);
+    });
+
+    for(uint32_t i = 0; i < missing.size(); i++)
+        storeTile(missing[i], tiles[i]);
+}
+
+std::shared_ptr<const PlanetTile> PlanetNoise::generateTile(uint64_t key) const
+{
+    uint32_t face  = key >> 61;
+    uint32_t depth = (key >> 56) & 0x1f;
+    uint32_t ix    = (key >> 28) & 0xfffffff;
+    uint32_t iy    = key & 0xfffffff;
+
+    //One more sample on each side, for the normals of the edges
+    uint32_t res  = m_tileResolution;
+    uint32_t n    = res+2;
+    float size    = 2.0f / (1 << depth);
+    float step    = size / (res-1);
+    float x0      = -1.0f + ix*size - step;
+    float y0      = -1.0f + iy*size - step;
+
+    ScratchScope scratch;
+    float* x = scratch.allocate<float>(n*n);
+    float* y = scratch.allocate<float>(n*n);
+    float* z = scratch.allocate<float>(n*n);
+    float* h = scratch.allocate<float>(n*n);
+    for(uint32_t j = 0; j < n; j++)
+        for(uint32_t i = 0; i < n; i++)
+        {
+            glm::vec3 direction = 2.0f*PlanetTerrain::faceToSphere(face, x0 + i*step, y0 + j*step);
+            x[j*n+i] = direction.x;
+            y[j*n+i] = direction.y;
+            z[j*n+i] = direction.z;
+        }
+    sample(x, y, z, h, n*n);
+
+    std::shared_ptr<PlanetTile> tile = std::make_shared<PlanetTile>();
+    tile->resolution = res;
+    tile->samples.resize(res*res);
+    auto position = [&](uint32_t i, uint32_t j)
+    {
+        uint32_t k = j*n+i;
+        return glm::vec3(x[k], y[k], z[k]) * (1.0f + h[k]);
+    };
+    for(uint32_t j = 0; j < res; j++)
+        for(uint32_t i = 0; i < res; i++)
+        {
+            //Central differences along u and v : u x v points outwards on every face
+            glm::vec3 du = position(i+2, j+1) - position(i, j+1);
+            glm::vec3 dv = position(i+1, j+2) - position(i+1, j);
+            tile->samples[j*res+i] = glm::vec4(glm::normalize(glm::cross(du, dv)), h[(j+1)*n+i+1]);
+        }
+    return tile;
+}
+
+std::shared_ptr<const PlanetTile> PlanetNoise::findTile(uint64_t key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::shared_ptr<const PlanetTile>* tile = m_cache.find(key);
+    return tile ? *tile : std::shared_ptr<const PlanetTile>();
+}
+
+void PlanetNoise::storeTile(uint64_t key, const std::shared_ptr<const PlanetTile>& tile)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(!m_cache.contains(key))
+        m_cache.insert(key, tile);
+}
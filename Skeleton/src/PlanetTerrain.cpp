@@ -0,0 +1,372 @@
+#include "PlanetTerrain.h"
+#include "logger.h"
+#include <cfloat>
+#include <cmath>
+#include <glm/gtc/type_ptr.hpp>
+
+#define PLANET_RADIUS 0.5f
+
+//Where the morph to the parent grid starts, between the range of the previous level and the range of the node
+#define MORPH_START_RATIO 0.66f
+
+//The selection is used one frame after it was requested : the bounds are inflated so that a turning camera does not uncover missing nodes
+#define SELECTION_MARGIN 1.25f
+
+//Sample points per side of a node to bound it
+#define BOUND_SAMPLES 5
+
+#define INDICE_TO_PTR(x) ((void*)(uintptr_t)(x))
+
+//Cube faces : u axis, v axis, normal (u x v = normal)
+static const float s_faces[6][3][3] = {
+    {{ 0, 0,-1}, {0, 1, 0}, { 1, 0, 0}},
+    {{ 0, 0, 1}, {0, 1, 0}, {-1, 0, 0}},
+    {{ 1, 0, 0}, {0, 0,-1}, { 0, 1, 0}},
+    {{ 1, 0, 0}, {0, 0, 1}, { 0,-1, 0}},
+    {{ 1, 0, 0}, {0, 1, 0}, { 0, 0, 1}},
+    {{-1, 0, 0}, {0, 1, 0}, { 0, 0,-1}}
+};
+
+PlanetTerrain::PlanetTerrain(uint32_t gridSize, uint32_t maxDepth, float lodDistanceRatio) : m_gridSize(gridSize), m_maxDepth(maxDepth)
+{
+    //Range of each level : the distance below which its nodes are refined. The root faces are never out of range
+    m_ranges.resize(maxDepth+1);
+    for(uint32_t level = 0; level < maxDepth; level++)
+    {
+        float nodeSize = PLANET_RADIUS * (M_PI/2) / (1 << (maxDepth - level)); //Arc length of a side
+        m_ranges[level] = lodDistanceRatio * nodeSize;
+    }
+    m_ranges[maxDepth] = FLT_MAX;
+
+    //The grid shared by every node, indexed quadrant by quadrant so that a node can draw only some of them
+    uint32_t n = gridSize+1;
+    std::vector<float> vertices(2*n*n);
+    for(uint32_t y = 0; y < n; y++)
+        for(uint32_t x = 0; x < n; x++)
+        {
+            vertices[2*(y*n+x)]   = x / (float)gridSize;
+            vertices[2*(y*n+x)+1] = y / (float)gridSize;
+        }
+
+    uint32_t half = gridSize/2;
+    m_nbQuadrantIndices = half*half*6;
+    std::vector<uint32_t> indices;
+    indices.reserve(4*m_nbQuadrantIndices);
+    for(uint32_t q = 0; q < 4; q++)
+        for(uint32_t y = (q/2)*half; y < (q/2+1)*half; y++)
+            for(uint32_t x = (q%2)*half; x < (q%2+1)*half; x++)
+            {
+                uint32_t a = y*n+x, b = a+1, c = a+n+1, d = a+n;
+                uint32_t quad[] = {a, b, c, a, c, d};
+                indices.insert(indices.end(), quad, quad+6);
+            }
+
+    glGenVertexArrays(1, &m_VAO);
+    glBindVertexArray(m_VAO);
+
+    glGenBuffers(1, &m_VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size()*sizeof(float), &vertices[0], GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(0);
+
+    glGenBuffers(1, &m_EBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size()*sizeof(uint32_t), &indices[0], GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+}
+
+PlanetTerrain::~PlanetTerrain()
+{
+    for(uint32_t i = 0; i < m_bodies.size(); i++)
+    {
+        JobSystem::getShared().wait(m_bodies[i]->job);
+
+        const LRUCache<uint64_t, GLuint>::EntryList& textures = m_bodies[i]->textures.getEntries();
+        for(LRUCache<uint64_t, GLuint>::EntryList::const_iterator it = textures.begin(); it != textures.end(); ++it)
+            glDeleteTextures(1, &it->second);
+        delete m_bodies[i];
+    }
+
+    glDeleteBuffers(1, &m_VBO);
+    glDeleteBuffers(1, &m_EBO);
+    glDeleteVertexArrays(1, &m_VAO);
+}
+
+uint32_t PlanetTerrain::addBody(PlanetNoise* noise)
+{
+    if(noise && noise->getTileResolution() != m_gridSize+1)
+    {
+        WARNING("PlanetTerrain : tiles of %u samples do not match a grid of %u quads, the body is drawn without relief\n", noise->getTileResolution(), m_gridSize);
+        noise = NULL;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_bodies.push_back(new Body(noise));
+    return m_bodies.size()-1;
+}
+
+void PlanetTerrain::requestSelection(uint32_t body, const glm::mat4& mvp, const glm::vec3& camera)
+{
+    Body* b;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        b = m_bodies[body];
+        extractPlanes(mvp, b->request.planes);
+        b->request.camera    = camera;
+        b->request.maxHeight = b->noise ? b->noise->getMaxHeight() : 0.0f;
+        b->pending        = true;
+
+        //The job in flight will see the request
+        if(b->running)
+            return;
+        b->running = true;
+    }
+    JobSystem::getShared().run([this, b]() {selectBody(b);}, &b->job, "Terrain selection");
+}
+
+const std::vector<TerrainChunk>& PlanetTerrain::getSelection(uint32_t body)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Body* b = m_bodies[body];
+    if(!b->hasResult || m_synchronous)
+    {
+        //Only the first time : the calling thread helps with the jobs until the selection is there. The job selects until no request
+        //is pending, so once it is done the selection is the one of the last request
+        lock.unlock();
+        JobSystem::getShared().wait(b->job);
+        lock.lock();
+    }
+    if(b->fresh)
+    {
+        b->front.swap(b->result);
+        b->fresh = false;
+    }
+    return b->front;
+}
+
+uint32_t PlanetTerrain::draw(uint32_t body, const Shader* shader, const glm::vec3& camera)
+{
+    const std::vector<TerrainChunk>& chunks = getSelection(body);
+    Body* b = m_bodies[body];
+
+    GLint uFace     = glGetUniformLocation(shader->getProgramID(), "uFace");
+    GLint uChunk    = glGetUniformLocation(shader->getProgramID(), "uChunk");
+    GLint uMorph    = glGetUniformLocation(shader->getProgramID(), "uMorph");
+    GLint uGridSize = glGetUniformLocation(shader->getProgramID(), "uGridSize");
+    GLint uCamera   = glGetUniformLocation(shader->getProgramID(), "uCamera");
+    GLint uDisplaced = glGetUniformLocation(shader->getProgramID(), "uDisplaced");
+    GLint uHeights  = glGetUniformLocation(shader->getProgramID(), "uHeights");
+    glUniform1f(uGridSize, (float)m_gridSize);
+    glUniform3fv(uCamera, 1, glm::value_ptr(camera));
+    glUniform1i(uDisplaced, b->noise != NULL);
+    glUniform1i(uHeights, 1);
+    glActiveTexture(GL_TEXTURE1);
+
+    glBindVertexArray(m_VAO);
+    uint32_t nbTriangles = 0;
+    int currentFace = -1;
+    for(uint32_t i = 0; i < chunks.size(); i++)
+    {
+        const TerrainChunk& chunk = chunks[i];
+        if(chunk.face != currentFace)
+        {
+            glUniformMatrix3fv(uFace, 1, GL_FALSE, &s_faces[chunk.face][0][0]);
+            currentFace = chunk.face;
+        }
+
+        float end   = m_ranges[chunk.level];
+        float prev  = chunk.level > 0 ? m_ranges[chunk.level-1] : 0.0f;
+        float start = prev + (end - prev)*MORPH_START_RATIO;
+        glUniform3f(uChunk, chunk.x, chunk.y, chunk.size);
+        glUniform2f(uMorph, start, end);
+        if(b->noise)
+            glBindTexture(GL_TEXTURE_2D, getHeightTexture(b, chunk));
+
+        if(chunk.quadrants == 0xf)
+        {
+            glDrawElements(GL_TRIANGLES, 4*m_nbQuadrantIndices, GL_UNSIGNED_INT, 0);
+            nbTriangles += 4*m_nbQuadrantIndices/3;
+            continue;
+        }
+        for(uint32_t q = 0; q < 4; q++)
+        {
+            if(chunk.quadrants & (1 << q))
+            {
+                glDrawElements(GL_TRIANGLES, m_nbQuadrantIndices, GL_UNSIGNED_INT, INDICE_TO_PTR(q*m_nbQuadrantIndices*sizeof(uint32_t)));
+                nbTriangles += m_nbQuadrantIndices/3;
+            }
+        }
+    }
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    return nbTriangles;
+}
+
+GLuint PlanetTerrain::getHeightTexture(Body* body, const TerrainChunk& chunk)
+{
+    uint64_t key = getTileKey(chunk);
+    GLuint* cached = body->textures.find(key);
+    if(cached)
+        return *cached;
+
+    //Usually prefetched by the worker along with the selection : only the upload happens here
+    uint32_t depth = m_maxDepth - chunk.level;
+    std::shared_ptr<const PlanetTile> tile = body->noise->getTile(chunk.face, depth, (key >> 28) & 0xfffffff, key & 0xfffffff);
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, tile->resolution, tile->resolution, 0, GL_RGBA, GL_FLOAT, &tile->samples[0]);
+
+    GLuint evicted;
+    if(body->textures.insert(key, texture, &evicted))
+        glDeleteTextures(1, &evicted);
+    return texture;
+}
+
+uint64_t PlanetTerrain::getTileKey(const TerrainChunk& chunk) const
+{
+    uint32_t ix = (uint32_t)((chunk.x + 1.0f)/chunk.size + 0.5f);
+    uint32_t iy = (uint32_t)((chunk.y + 1.0f)/chunk.size + 0.5f);
+    return PlanetNoise::getTileKey(chunk.face, m_maxDepth - chunk.level, ix, iy);
+}
+
+glm::vec3 PlanetTerrain::faceToSphere(uint32_t face, float u, float v)
+{
+    //Equal-angle mapping, as CubeSphere
+    float wu = tanf(M_PI/4 * u);
+    float wv = tanf(M_PI/4 * v);
+    const float (*axes)[3] = s_faces[face];
+    glm::vec3 p(axes[0][0]*wu + axes[1][0]*wv + axes[2][0],
+                axes[0][1]*wu + axes[1][1]*wv + axes[2][1],
+                axes[0][2]*wu + axes[1][2]*wv + axes[2][2]);
+    return PLANET_RADIUS * glm::normalize(p);
+}
+
+void PlanetTerrain::select(const glm::mat4& mvp, const glm::vec3& camera, std::vector<TerrainChunk>& chunks, float maxHeight) const
+{
+    SelectionRequest request;
+    extractPlanes(mvp, request.planes);
+    request.camera    = camera;
+    request.maxHeight = maxHeight;
+
+    chunks.clear();
+    for(uint32_t face = 0; face < 6; face++)
+        selectNode(request, face, -1.0f, -1.0f, 2.0f, m_maxDepth, chunks);
+}
+
+bool PlanetTerrain::selectNode(const SelectionRequest& request, uint32_t face, float x, float y, float size, uint32_t level, std::vector<TerrainChunk>& chunks) const
+{
+    //Bounding sphere : samples of the patch, plus the bulge of the surface between two samples
+    glm::vec3 samples[BOUND_SAMPLES*BOUND_SAMPLES];
+    glm::vec3 center(0.0f);
+    for(uint32_t j = 0; j < BOUND_SAMPLES; j++)
+        for(uint32_t i = 0; i < BOUND_SAMPLES; i++)
+        {
+            glm::vec3 p = faceToSphere(face, x + size*i/(BOUND_SAMPLES-1), y + size*j/(BOUND_SAMPLES-1));
+            samples[j*BOUND_SAMPLES+i] = p;
+            center += p;
+        }
+    center /= (float)(BOUND_SAMPLES*BOUND_SAMPLES);
+
+    float radius = 0.0f;
+    for(uint32_t i = 0; i < BOUND_SAMPLES*BOUND_SAMPLES; i++)
+        radius = fmaxf(radius, glm::length(samples[i] - center));
+    float spacing = glm::length(samples[1] - samples[0]); //Largest at the edges of a face
+    radius += spacing*spacing / (8.0f*PLANET_RADIUS) + PLANET_RADIUS*request.maxHeight;
+
+    //Out of the range of its level : the parent draws this area
+    float distance = glm::length(center - request.camera) - radius;
+    if(distance > m_ranges[level])
+        return false;
+
+    //Culled : handled, nothing to draw
+    float margin = SELECTION_MARGIN*radius;
+    for(uint32_t p = 0; p < 6; p++)
+        if(glm::dot(glm::vec3(request.planes[p]), center) + request.planes[p].w < -margin)
+            return true;
+
+    //Behind the horizon : farther than the horizon of the lowest ground, plus the distance from which the highest peaks rise above it
+    float minRadius = PLANET_RADIUS*(1.0f - request.maxHeight);
+    float maxRadius = PLANET_RADIUS*(1.0f + request.maxHeight);
+    float cameraDistance = glm::length(request.camera);
+    if(cameraDistance > minRadius)
+    {
+        float horizon = sqrtf(cameraDistance*cameraDistance - minRadius*minRadius) + sqrtf(maxRadius*maxRadius - minRadius*minRadius);
+        if(distance + radius - margin > horizon)
+            return true;
+    }
+
+    TerrainChunk chunk = {(uint8_t)face, (uint8_t)level, 0xf, x, y, size};
+    if(level == 0 || distance > m_ranges[level-1])
+    {
+        chunks.push_back(chunk);
+        return true;
+    }
+
+    //Children in range draw themselves, the others are drawn as quadrants of this node
+    float half = 0.5f*size;
+    chunk.quadrants = 0;
+    for(uint32_t q = 0; q < 4; q++)
+        if(!selectNode(request, face, x + (q%2)*half, y + (q/2)*half, half, level-1, chunks))
+            chunk.quadrants |= 1 << q;
+
+    if(chunk.quadrants)
+        chunks.push_back(chunk);
+    return true;
+}
+
+void PlanetTerrain::extractPlanes(const glm::mat4& mvp, glm::vec4* planes)
+{
+    //Gribb / Hartmann : the planes are combinations of the rows of the matrix
+    glm::vec4 rows[4];
+    for(uint32_t i = 0; i < 4; i++)
+        rows[i] = glm::vec4(mvp[0][i], mvp[1][i], mvp[2][i], mvp[3][i]);
+
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        planes[2*i]   = rows[3] + rows[i];
+        planes[2*i+1] = rows[3] - rows[i];
+    }
+    for(uint32_t i = 0; i < 6; i++)
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+void PlanetTerrain::selectBody(Body* body)
+{
+    std::vector<TerrainChunk> chunks;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(body->pending)
+    {
+        SelectionRequest request = body->request;
+        PlanetNoise* noise = body->noise;
+        body->pending = false;
+
+        //Select without holding the lock : the render thread keeps requesting and drawing meanwhile
+        lock.unlock();
+        chunks.clear();
+        for(uint32_t face = 0; face < 6; face++)
+            selectNode(request, face, -1.0f, -1.0f, 2.0f, m_maxDepth, chunks);
+
+        //Generate the relief of the new nodes now, rather than on the render thread when they are drawn
+        if(noise)
+        {
+            std::vector<uint64_t> keys(chunks.size());
+            for(uint32_t c = 0; c < chunks.size(); c++)
+                keys[c] = getTileKey(chunks[c]);
+            noise->prefetchTiles(keys);
+        }
+        lock.lock();
+
+        body->result.swap(chunks);
+        body->hasResult = body->fresh = true;
+    }
+    body->running = false;
+}
@@ -0,0 +1,113 @@
+#include "QualityGovernor.h"
+#include <algorithm>
+
+//From the finest to the coarsest : what costs the least to the image goes first
+static const QualityLevel s_levels[] =
+{
+    {"Full",   1.00f,  0, 0.0f, true},
+    {"High",   1.00f, -1, 0.5f, true},
+    {"Medium", 0.85f, -1, 1.0f, true},
+    {"Low",    0.70f, -2, 1.5f, false},
+    {"Lowest", 0.50f, -3, 2.0f, false},
+};
+
+QualityGovernor::QualityGovernor(double budgetMs) : m_cpuMs(QUALITY_WINDOW_FRAMES), m_gpuMs(QUALITY_WINDOW_FRAMES)
+{
+    m_stats.budgetMs = budgetMs;
+    m_stats.cooldownFrames = QUALITY_COOLDOWN_FRAMES;
+}
+
+const QualityLevel& QualityGovernor::getLevel(uint32_t level)
+{
+    return s_levels[std::min(level, getNbLevels()-1)];
+}
+
+uint32_t QualityGovernor::getNbLevels()
+{
+    return sizeof(s_levels) / sizeof(s_levels[0]);
+}
+
+bool QualityGovernor::addFrame(double cpuMs, double gpuMs)
+{
+    if(!m_enabled)
+        return false;
+
+    m_stats.nbFrames++;
+    m_nbSince++;
+    if(m_nbSince <= QUALITY_SETTLE_FRAMES)
+        return false;
+
+    m_cpuMs[m_next] = cpuMs;
+    m_gpuMs[m_next] = gpuMs;
+    m_next = (m_next+1) % QUALITY_WINDOW_FRAMES;
+    m_nbMeasured = std::min(m_nbMeasured+1, (uint32_t)QUALITY_WINDOW_FRAMES);
+
+    double cpuTotal = 0.0;
+    double gpuTotal = 0.0;
+    for(uint32_t i = 0; i < m_nbMeasured; i++)
+    {
+        cpuTotal += m_cpuMs[i];
+        gpuTotal += m_gpuMs[i];
+    }
+    m_stats.cpuMs = cpuTotal / m_nbMeasured;
+    m_stats.gpuMs = gpuTotal / m_nbMeasured;
+
+    double cost = std::max(cpuMs, gpuMs);
+    if(cost > m_stats.budgetMs)
+        m_stats.nbOverBudget++;
+    m_overRun = cost > QUALITY_DOWN_RATIO*m_stats.budgetMs ? m_overRun+1 : 0;
+
+    //A step up which held a whole window was right : the cooldown can shrink back
+    if(m_steppedUp && m_nbSince > QUALITY_SETTLE_FRAMES + QUALITY_WINDOW_FRAMES)
+    {
+        m_steppedUp = false;
+        m_stats.cooldownFrames = QUALITY_COOLDOWN_FRAMES;
+    }
+
+    //Down on a run of slow frames, not on their mean : a hitch of the window must not hold it back
+    if(m_overRun >= QUALITY_DOWN_FRAMES && m_stats.level+1 < getNbLevels())
+    {
+        if(m_steppedUp)
+            m_stats.cooldownFrames = std::min(2*m_stats.cooldownFrames, (uint32_t)QUALITY_MAX_COOLDOWN_FRAMES);
+        m_steppedUp = false;
+        m_stats.nbStepsDown++;
+        setLevel(m_stats.level+1);
+        return true;
+    }
+
+    //Up on the mean of a whole window well under the budget
+    if(m_stats.level > 0 && m_nbSince >= m_stats.cooldownFrames && m_nbMeasured == QUALITY_WINDOW_FRAMES &&
+       std::max(m_stats.cpuMs, m_stats.gpuMs) < QUALITY_UP_RATIO*m_stats.budgetMs)
+    {
+        m_steppedUp = true;
+        m_stats.nbStepsUp++;
+        setLevel(m_stats.level-1);
+        return true;
+    }
+    return false;
+}
+
+void QualityGovernor::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    reset();
+}
+
+void QualityGovernor::reset()
+{
+    double budgetMs = m_stats.budgetMs;
+    m_stats = QualityStats();
+    m_stats.budgetMs = budgetMs;
+    m_stats.cooldownFrames = QUALITY_COOLDOWN_FRAMES;
+    m_steppedUp = false;
+    setLevel(0);
+}
+
+void QualityGovernor::setLevel(uint32_t level)
+{
+    m_stats.level = level;
+    m_next = 0;
+    m_nbMeasured = 0;
+    m_nbSince = 0;
+    m_overRun = 0;
+}
@@ -1,83 +1,159 @@
 #include "Shader.h"
 
-Shader::Shader() : m_programID(0), m_vertexID(0), m_fragID(0)
+Shader::Shader() : m_programID(0), m_vertexID(0), m_tessControlID(0), m_tessEvalID(0), m_fragID(0), m_computeID(0)
 {}
 
 Shader::~Shader()
 {
     glDeleteProgram(m_programID);
     glDeleteShader(m_vertexID);
+    glDeleteShader(m_tessControlID);
+    glDeleteShader(m_tessEvalID);
     glDeleteShader(m_fragID);
+    glDeleteShader(m_computeID);
 }
 
 Shader* Shader::loadFromFiles(FILE* vertexFile, FILE* fragFile)
 {
-    uint32_t vertexFileSize = 0;
-    uint32_t fragFileSize   = 0;
-    char* vertexCodeC;
-    char* fragCodeC;
+    return loadFromStrings(readFile(vertexFile), readFile(fragFile));
+}
 
-    /* Determine the vertex and fragment shader sizes */
-    fseek(vertexFile, 0, SEEK_END);
-    vertexFileSize = ftell(vertexFile);
-    fseek(vertexFile, 0, SEEK_SET);
+Shader* Shader::loadFromFiles(FILE* vertexFile, FILE* fragFile, FILE* fragLibFile)
+{
+    return loadFromStrings(readFile(vertexFile), insertLibrary(readFile(fragFile), readFile(fragLibFile)));
+}
 
-    fseek(fragFile, 0, SEEK_END);
-    fragFileSize = ftell(fragFile);
-    fseek(fragFile, 0, SEEK_SET);
+Shader* Shader::loadFromFiles(FILE* vertexFile, FILE* tessControlFile, FILE* tessEvalFile, FILE* fragFile, FILE* fragLibFile)
+{
+    if(!isTessellationSupported())
+        return NULL;
+    return loadFromStrings(readFile(vertexFile), readFile(tessControlFile), readFile(tessEvalFile), insertLibrary(readFile(fragFile), readFile(fragLibFile)));
+}
 
-    /* Read the files */
-    vertexCodeC = (char*)malloc(vertexFileSize+1);
-    fragCodeC   = (char*)malloc(fragFileSize+1);
+Shader* Shader::loadComputeFromFile(FILE* computeFile)
+{
+    if(!isComputeSupported())
+        return NULL;
+    return loadComputeFromString(readFile(computeFile));
+}
 
-    fread(vertexCodeC, 1, vertexFileSize, vertexFile);
-    vertexCodeC[vertexFileSize] = '\0';
-    fread(fragCodeC, 1, fragFileSize, fragFile);
-    fragCodeC[fragFileSize] = '\0';
+std::string Shader::readFile(FILE* file)
+{
+    uint32_t fileSize = 0;
+    char* codeC;
+
+    /* Determine the file size */
+    fseek(file, 0, SEEK_END);
+    fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
 
-    /* Return the shader and free everything*/
-    Shader* s = loadFromStrings(std::string(vertexCodeC), std::string(fragCodeC));
+    /* Read the file */
+    codeC = (char*)malloc(fileSize+1);
+    fileSize = fread(codeC, 1, fileSize, file);
+    codeC[fileSize] = '\0';
 
-    free(vertexCodeC);
-    free(fragCodeC);
+    std::string code(codeC);
+    free(codeC);
+
+    return code;
+}
 
-    return s;
+std::string Shader::insertLibrary(const std::string& code, const std::string& lib)
+{
+    /* #version has to stay the first line of the shader */
+    size_t versionPos = code.find("#version");
+    size_t insertPos  = (versionPos == std::string::npos) ? 0 : code.find('\n', versionPos);
+    if(insertPos == std::string::npos)
+        insertPos = code.size();
+    else if(versionPos != std::string::npos)
+        insertPos++;
+
+    return code.substr(0, insertPos) + lib + "\n" + code.substr(insertPos);
 }
 
 Shader* Shader::loadFromStrings(const std::string& vertexString, const std::string& fragString)
+{
+    return loadFromStrings(vertexString, "", "", fragString);
+}
+
+Shader* Shader::loadFromStrings(const std::string& vertexString, const std::string& tessControlString, const std::string& tessEvalString, const std::string& fragString)
 {
     Shader* shader = new Shader();
 
-    /* Create a program and compile each shader component (vertex, fragment) */
+    /* Create a program and compile each shader component (vertex, tessellation, fragment) */
     shader->m_programID = glCreateProgram();
     shader->m_vertexID = loadShader(vertexString, GL_VERTEX_SHADER);
     shader->m_fragID = loadShader(fragString, GL_FRAGMENT_SHADER);
+    if(!tessControlString.empty() && !tessEvalString.empty())
+    {
+        shader->m_tessControlID = loadShader(tessControlString, GL_TESS_CONTROL_SHADER);
+        shader->m_tessEvalID    = loadShader(tessEvalString, GL_TESS_EVALUATION_SHADER);
+    }
 
     /* Attach the shader components to the program */
     glAttachShader(shader->m_programID, shader->m_vertexID);
     glAttachShader(shader->m_programID, shader->m_fragID);
+    if(shader->m_tessControlID != 0 && shader->m_tessEvalID != 0)
+    {
+        glAttachShader(shader->m_programID, shader->m_tessControlID);
+        glAttachShader(shader->m_programID, shader->m_tessEvalID);
+    }
+    else if(!tessControlString.empty() || !tessEvalString.empty())
+    {
+        delete shader;
+        return NULL;
+    }
 
     /* Do the attributes binding */
     shader->bindAttributes();
 
     /* Link the program. */
-    glLinkProgram(shader->m_programID);
+    if(!shader->link())
+    {
+        delete shader;
+        return NULL;
+    }
+
+    return shader;
+}
+
+Shader* Shader::loadComputeFromString(const std::string& computeString)
+{
+    if(!isComputeSupported())
+        return NULL;
+
+    Shader* shader = new Shader();
+
+    /* A compute program has a single component */
+    shader->m_programID = glCreateProgram();
+    shader->m_computeID = loadShader(computeString, GL_COMPUTE_SHADER);
+    glAttachShader(shader->m_programID, shader->m_computeID);
+
+    if(!shader->link())
+    {
+        delete shader;
+        return NULL;
+    }
+
+    return shader;
+}
+
+bool Shader::link()
+{
+    glLinkProgram(m_programID);
 
     /* Check for errors and print error message */
     int linkStatus;
-    glGetProgramiv(shader->m_programID, GL_LINK_STATUS, &linkStatus);
+    glGetProgramiv(m_programID, GL_LINK_STATUS, &linkStatus);
     if(linkStatus == GL_FALSE)
     {
         char* error = (char*) malloc(ERROR_MAX_LENGTH * sizeof(char));
         int length=0;
-        glGetProgramInfoLog(shader->m_programID, ERROR_MAX_LENGTH, &length, error);
+        glGetProgramInfoLog(m_programID, ERROR_MAX_LENGTH, &length, error);
         ERROR("Could not link shader-> : \n %s", error);
-
-        delete shader;
-        return NULL;
+        return false;
     }
-
-    return shader;
+    return true;
 }
 
 int Shader::loadShader(const std::string& code, int type)
@@ -121,10 +197,31 @@ int Shader::getFragID() const
     return m_fragID;
 }
 
+bool Shader::hasTessellation() const
+{
+    return m_tessEvalID != 0;
+}
+
+bool Shader::isTessellationSupported()
+{
+    return GLEW_VERSION_4_0 || GLEW_ARB_tessellation_shader;
+}
+
+bool Shader::isCompute() const
+{
+    return m_computeID != 0;
+}
+
+bool Shader::isComputeSupported()
+{
+    return GLEW_VERSION_4_3 || GLEW_ARB_compute_shader;
+}
+
 void Shader::bindAttributes()
 {
     //vposition = 0 et vnormal .... td2 pdf ligne de code a copier coller et vUV = 2)
-        glBindAttribLocation(m_programID, 0, "vPosition");
+        glBindAttribLocation(m_programID, 0, "vPositions");
         glBindAttribLocation(m_programID, 1, "vNormals");
         glBindAttribLocation(m_programID, 2, "vUV");
+        glBindAttribLocation(m_programID, 3, "vDraw"); //Draw ID of the batched draws (MeshBuffer)
 }
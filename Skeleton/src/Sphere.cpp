@@ -1,60 +1,93 @@
 #include "Sphere.h"
+#include "Parallel.h"
+#include "Simd.h"
 
-Sphere::Sphere(uint32_t nbLatitude, uint32_t nbLongitude)
+//Smallest number of vertices worth a worker thread
+#define SPHERE_MIN_BAND_VERTICES 16384
+
+Sphere::Sphere(uint32_t nbLatitude, uint32_t nbLongitude, Allocator* allocator) : Geometry(allocator)
 {
     float radius = 0.5;
-    //Determine position
-	glm::vec3* vertexCoord = (glm::vec3*)malloc(nbLongitude*nbLatitude*sizeof(glm::vec3));
-    glm::vec2* uvCoord     = (glm::vec2*)malloc(nbLongitude*nbLatitude*sizeof(glm::vec2));
-	for(unsigned int i=0; i < nbLongitude; i++)
-	{
-		double theta = 2*M_PI/(nbLongitude-1) * i;
-		for(unsigned int j=0; j < nbLatitude; j++)
-		{
-			double phi = M_PI/(nbLatitude-1) * j;
-			double pos[] = {sin(phi)*sin(theta), cos(phi), cos(theta)*sin(phi)};
-            double uvs[] = {i/(double)(nbLongitude), j/(double)(nbLatitude)};
-			for(unsigned int k=0; k < 3; k++)
-				vertexCoord[i*nbLatitude + j][k] = radius*pos[k];
-            for(unsigned int k=0; k < 2; k++)
-                uvCoord[i*nbLatitude+j][k] = uvs[k];
-		}
-	}
+    allocate(nbLongitude*nbLatitude, (nbLongitude-1)*(nbLatitude-1)*6);
 
-    //Determine draw orders
-	unsigned int* order = (unsigned int*)malloc(nbLongitude*(nbLatitude-1)*sizeof(unsigned int)*6);
-	for(unsigned int i=0; i < nbLongitude; i++)
-	{
-		for(unsigned int j=0; j < nbLatitude-1; j++)
-		{
-			unsigned int o[] = {i*(nbLatitude) + j, (i+1)*(nbLatitude)%(nbLatitude*nbLongitude) + (j+1)%nbLatitude, (i+1)*(nbLatitude)%(nbLatitude*nbLongitude)+j,
-								i*(nbLatitude) + j, i*(nbLatitude) + (j+1)%nbLatitude, (i+1)*(nbLatitude)%(nbLatitude*nbLongitude) + (j+1)%nbLatitude
-						        
-			};
-
-			for(unsigned int k=0; k < 6; k++)
-				order[(nbLatitude-1)*i*6 + j*6 + k] = o[k];
-		}
-	}
-
-    //Merge everything
-    m_nbVertices = nbLongitude*(nbLatitude-1)*6;
-    m_vertices = (float*)malloc(sizeof(float)*m_nbVertices*3);
-    m_uvs      = (float*)malloc(sizeof(float)*m_nbVertices*2);
-    m_normals  = (float*)malloc(sizeof(float)*m_nbVertices*3);
-    for(uint32_t i = 0; i < nbLatitude*(nbLongitude-1)*6; i++)
+    //sin/cos of every longitude and latitude, computed once. The last longitude duplicates the first one so that the UVs do not wrap inside a triangle
+    ScratchScope scratch;
+    float* sinTheta = scratch.allocate<float>(nbLongitude);
+    float* cosTheta = scratch.allocate<float>(nbLongitude);
+    float* sinPhi   = scratch.allocate<float>(nbLatitude);
+    float* cosPhi   = scratch.allocate<float>(nbLatitude);
+    float* vs       = scratch.allocate<float>(nbLatitude);
+    for(uint32_t i = 0; i < nbLongitude; i++)
+    {
+        double theta = 2*M_PI/(nbLongitude-1) * i;
+        sinTheta[i]  = sin(theta);
+        cosTheta[i]  = cos(theta);
+    }
+    for(uint32_t j = 0; j < nbLatitude; j++)
     {
-        uint32_t indice   = order[i];
-        for(uint32_t j = 0; j < 3; j++)
+        double phi = M_PI/(nbLatitude-1) * j;
+        sinPhi[j]  = sin(phi);
+        cosPhi[j]  = cos(phi);
+        vs[j]      = j/(double)(nbLatitude-1);
+    }
+
+    //Determine position. Each band of longitudes is filled by one worker, 4 latitudes at a time
+    parallelFor(0, nbLongitude, SPHERE_MIN_BAND_VERTICES/nbLatitude + 1, [&](uint32_t first, uint32_t last)
+    {
+        for(uint32_t i = first; i < last; i++)
         {
-            m_vertices[3*i+j] = vertexCoord[indice][j];
-            m_normals [3*i+j] = glm::normalize(vertexCoord[indice])[j];
+            float* vertices = m_vertices + 3*i*nbLatitude;
+            float* normals  = m_normals  + 3*i*nbLatitude;
+            float* uvs      = m_uvs      + 2*i*nbLatitude;
+            float  u        = i/(double)(nbLongitude-1);
+
+            uint32_t j = 0;
+#ifdef USE_SSE2
+            __m128 sT = _mm_set1_ps(sinTheta[i]);
+            __m128 cT = _mm_set1_ps(cosTheta[i]);
+            __m128 r  = _mm_set1_ps(radius);
+            __m128 uu = _mm_set1_ps(u);
+            for(; j+4 <= nbLatitude; j += 4)
+            {
+                __m128 sP = _mm_loadu_ps(sinPhi + j);
+                __m128 x  = _mm_mul_ps(sP, sT);
+                __m128 y  = _mm_loadu_ps(cosPhi + j);
+                __m128 z  = _mm_mul_ps(cT, sP);
+                storeInterleavedXYZ(normals  + 3*j, x, y, z);
+                storeInterleavedXYZ(vertices + 3*j, _mm_mul_ps(r, x), _mm_mul_ps(r, y), _mm_mul_ps(r, z));
+
+                __m128 v = _mm_loadu_ps(vs + j);
+                _mm_storeu_ps(uvs + 2*j,   _mm_unpacklo_ps(uu, v));
+                _mm_storeu_ps(uvs + 2*j+4, _mm_unpackhi_ps(uu, v));
+            }
+#endif
+            for(; j < nbLatitude; j++)
+            {
+                float pos[] = {sinPhi[j]*sinTheta[i], cosPhi[j], cosTheta[i]*sinPhi[j]};
+                for(uint32_t k = 0; k < 3; k++)
+                {
+                    vertices[3*j+k] = radius*pos[k];
+                    normals [3*j+k] = pos[k];
+                }
+                uvs[2*j]   = u;
+                uvs[2*j+1] = vs[j];
+            }
         }
-        for(uint32_t j = 0; j < 2; j++)
-            m_uvs[2*i+j] = uvCoord[indice][j];
-    }
+    });
 
-    free(order);
-    free(vertexCoord);
-    free(uvCoord);
+    //Determine draw orders
+    parallelFor(0, nbLongitude-1, SPHERE_MIN_BAND_VERTICES/nbLatitude + 1, [&](uint32_t first, uint32_t last)
+    {
+        for(uint32_t i = first; i < last; i++)
+        {
+            for(uint32_t j = 0; j < nbLatitude-1; j++)
+            {
+                uint32_t o[] = {i*nbLatitude + j, (i+1)*nbLatitude + j+1, (i+1)*nbLatitude + j,
+                                i*nbLatitude + j, i*nbLatitude + j+1,     (i+1)*nbLatitude + j+1};
+
+                for(uint32_t k = 0; k < 6; k++)
+                    m_indices[(nbLatitude-1)*i*6 + j*6 + k] = o[k];
+            }
+        }
+    });
 }
@@ -0,0 +1,81 @@
+#include "SphericalGeometry.h"
+#include <cmath>
+#include <map>
+
+//|y| above which a vertex is considered to be a pole, where u is undefined
+#define POLE_EPSILON 1e-6f
+
+void SphericalGeometry::build(const std::vector<glm::vec3>& directions, const std::vector<uint32_t>& triangles)
+{
+    std::vector<glm::vec3> positions(directions);
+    std::vector<glm::vec2> uvs(directions.size());
+    for(uint32_t i = 0; i < directions.size(); i++)
+    {
+        const glm::vec3& d = directions[i];
+        float u = atan2f(d.x, d.z) / (2*M_PI);
+        uvs[i] = glm::vec2(u < 0.0f ? u+1.0f : u, acosf(glm::clamp(d.y, -1.0f, 1.0f)) / M_PI);
+    }
+
+    //Seam : a triangle spanning more than half of the u range crosses it. Its vertices at the start of the range get a copy at u+1 (shared between the triangles)
+    std::vector<uint32_t> indices(triangles);
+    std::map<uint32_t, uint32_t> seamCopies;
+    for(uint32_t t = 0; t < indices.size(); t += 3)
+    {
+        float uMin = 1.0f, uMax = 0.0f;
+        for(uint32_t k = 0; k < 3; k++)
+        {
+            uint32_t v = indices[t+k];
+            if(fabsf(positions[v].y) >= 1.0f-POLE_EPSILON)
+                continue;
+            uMin = fminf(uMin, uvs[v].x);
+            uMax = fmaxf(uMax, uvs[v].x);
+        }
+        if(uMax - uMin <= 0.5f)
+            continue;
+
+        for(uint32_t k = 0; k < 3; k++)
+        {
+            uint32_t v = indices[t+k];
+            if(uvs[v].x >= 0.5f || fabsf(positions[v].y) >= 1.0f-POLE_EPSILON)
+                continue;
+            std::map<uint32_t, uint32_t>::iterator it = seamCopies.find(v);
+            if(it == seamCopies.end())
+            {
+                it = seamCopies.insert(std::make_pair(v, (uint32_t)positions.size())).first;
+                positions.push_back(positions[v]);
+                uvs.push_back(glm::vec2(uvs[v].x+1.0f, uvs[v].y));
+            }
+            indices[t+k] = it->second;
+        }
+    }
+
+    //Poles : one copy per triangle, at the mean u of the two other vertices
+    for(uint32_t t = 0; t < indices.size(); t += 3)
+    {
+        for(uint32_t k = 0; k < 3; k++)
+        {
+            uint32_t v = indices[t+k];
+            if(fabsf(positions[v].y) < 1.0f-POLE_EPSILON)
+                continue;
+            float u = 0.5f*(uvs[indices[t+(k+1)%3]].x + uvs[indices[t+(k+2)%3]].x);
+            indices[t+k] = positions.size();
+            positions.push_back(positions[v]);
+            uvs.push_back(glm::vec2(u, uvs[v].y));
+        }
+    }
+
+    allocate(positions.size(), indices.size());
+
+    for(uint32_t i = 0; i < m_nbVertices; i++)
+    {
+        for(uint32_t k = 0; k < 3; k++)
+        {
+            m_vertices[3*i+k] = 0.5f*positions[i][k];
+            m_normals [3*i+k] = positions[i][k];
+        }
+        for(uint32_t k = 0; k < 2; k++)
+            m_uvs[2*i+k] = uvs[i][k];
+    }
+    for(uint32_t i = 0; i < m_nbIndices; i++)
+        m_indices[i] = indices[i];
+}
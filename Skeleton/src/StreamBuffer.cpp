@@ -0,0 +1,135 @@
+#include "StreamBuffer.h"
+#include <cstring>
+#include <algorithm>
+
+uint64_t StreamBuffer::s_frame = 0;
+
+StreamBuffer::StreamBuffer(uint32_t regionSize, uint32_t framesInFlight) : m_regionSize(regionSize), m_framesInFlight(std::max(framesInFlight, 1u)), m_persistent(false)
+{}
+
+StreamBuffer::~StreamBuffer()
+{
+    for(GLsync fence : m_fences)
+        if(fence != 0)
+            glDeleteSync(fence);
+    if(m_buffer != 0)
+        glDeleteBuffers(1, &m_buffer);
+}
+
+bool StreamBuffer::isPersistentSupported()
+{
+    return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+}
+
+void StreamBuffer::newFrame()
+{
+    s_frame++;
+}
+
+void StreamBuffer::allocate(uint32_t regionSize)
+{
+    //The draws already submitted keep the old storage alive : GL only frees it once they are done
+    for(GLsync& fence : m_fences)
+        if(fence != 0)
+            glDeleteSync(fence);
+    if(m_buffer != 0)
+        glDeleteBuffers(1, &m_buffer);
+
+    m_persistent = isPersistentSupported();
+    m_regionSize = (regionSize + 255) & ~255u;
+    m_fences.assign(m_persistent ? m_framesInFlight : 1, 0);
+    m_region = 0;
+    m_offset = 0;
+    m_frame  = s_frame;
+    m_data   = NULL;
+
+    //Bound to a target no draw reads from, so that no VAO or indirect binding is disturbed
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+    if(m_persistent)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, m_regionSize*m_fences.size(), NULL, flags);
+        m_data = (uint8_t*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, m_regionSize*m_fences.size(), flags);
+    }
+    else
+        glBufferData(GL_COPY_WRITE_BUFFER, m_regionSize, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void StreamBuffer::nextRegion()
+{
+    m_offset = 0;
+    m_frame  = s_frame;
+    if(!m_persistent)
+        return;
+
+    //Every command reading the region was issued before this fence
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_region = (m_region + 1) % m_fences.size();
+
+    GLsync fence = m_fences[m_region];
+    if(fence == 0)
+        return;
+
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if(status == GL_TIMEOUT_EXPIRED)
+    {
+        m_nbWaits++;
+        do
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        while(status == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(fence);
+    m_fences[m_region] = 0;
+}
+
+void* StreamBuffer::map(uint32_t size, uint32_t alignment, GLintptr* offset)
+{
+    if(m_buffer == 0)
+        allocate(std::max(m_regionSize, size));
+    else if(m_frame != s_frame)
+        nextRegion();
+
+    //A frame writing more than a region gets a larger buffer rather than waiting for the GPU
+    uint32_t start = (m_offset + alignment-1) & ~(alignment-1);
+    if(start + size > m_regionSize)
+    {
+        uint32_t regionSize = std::max(m_regionSize, 1u);
+        while(regionSize < size)
+            regionSize *= 2;
+        allocate(regionSize == m_regionSize ? 2*regionSize : regionSize);
+        start = 0;
+    }
+
+    *offset  = m_region*m_regionSize + start;
+    m_offset = start + size;
+    if(m_persistent)
+        return m_data + *offset;
+
+    //First write of the frame : new storage. Next ones : the range is known to be unused by the draws already submitted
+    GLbitfield flags = GL_MAP_WRITE_BIT | (start == 0 ? GL_MAP_INVALIDATE_BUFFER_BIT : (GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+    void* data = glMapBufferRange(GL_COPY_WRITE_BUFFER, *offset, size, flags);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    m_mapped = true;
+    return data;
+}
+
+void StreamBuffer::unmap()
+{
+    if(!m_mapped)
+        return;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    m_mapped = false;
+}
+
+GLintptr StreamBuffer::write(const void* data, uint32_t size, uint32_t alignment)
+{
+    GLintptr offset;
+    memcpy(map(size, alignment, &offset), data, size);
+    unmap();
+    return offset;
+}
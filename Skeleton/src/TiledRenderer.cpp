@@ -0,0 +1,183 @@
+#include "TiledRenderer.h"
+#include "logger.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+
+TiledRenderer::TiledRenderer() : m_nbPending(0), m_failed(false)
+{
+    for(uint32_t i = 0; i < TILED_RENDERER_NB_BUFFERS; i++)
+    {
+        m_buffers[i] = 0;
+        m_filled[i]  = false;
+    }
+}
+
+TiledRenderer::~TiledRenderer()
+{
+    finish();
+}
+
+bool TiledRenderer::start(const char* path, uint32_t width, uint32_t height, uint32_t tileSize, float fovy, float zNear, float zFar)
+{
+    finish();
+
+    //The tiles must fit in a renderbuffer, a texture and the viewport
+    GLint maxRenderbuffer = 0, maxTexture = 0, maxViewport[2] = {0, 0};
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxRenderbuffer);
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexture);
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, maxViewport);
+    GLint maxSize = std::min(std::min(maxRenderbuffer, maxTexture), std::min(maxViewport[0], maxViewport[1]));
+    if(maxSize > 0 && tileSize > (uint32_t)maxSize)
+    {
+        WARNING("Tiles of %u pixels are too large for this GL implementation : %d used instead\n", tileSize, maxSize);
+        tileSize = maxSize;
+    }
+    tileSize = std::max(std::min(tileSize, std::max(width, height)), 1u);
+
+    if(!m_target.resize(tileSize, tileSize))
+    {
+        ERROR("Could not create a %ux%u framebuffer for the tiles\n", tileSize, tileSize);
+        return false;
+    }
+    if(!m_image.open(path, width, height))
+        return false;
+
+    if(m_buffers[0] == 0)
+        glGenBuffers(TILED_RENDERER_NB_BUFFERS, m_buffers);
+    for(uint32_t i = 0; i < TILED_RENDERER_NB_BUFFERS; i++)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffers[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, 4*(size_t)tileSize*tileSize, NULL, GL_STREAM_READ);
+        m_filled[i] = false;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    //The frustum of glm::perspective, on the near plane. Each tile takes its share of it
+    m_top       = zNear * tanf(0.5f*fovy);
+    m_bottom    = -m_top;
+    m_right     = m_top * width / height;
+    m_left      = -m_right;
+    m_near      = zNear;
+    m_far       = zFar;
+
+    m_path      = path;
+    m_width     = width;
+    m_height    = height;
+    m_tileSize  = tileSize;
+    m_nbColumns = (width + tileSize-1) / tileSize;
+    m_nbRows    = (height + tileSize-1) / tileSize;
+    m_next      = 0;
+    m_failed    = false;
+    m_rendering = true;
+    m_start     = std::chrono::steady_clock::now();
+    INFO("Rendering a %ux%u image to %s : %u tiles of %ux%u\n", width, height, path, getNbTiles(), tileSize, tileSize);
+    return true;
+}
+
+const RenderTile& TiledRenderer::beginTile(uint32_t tile)
+{
+    RenderTile& current = m_current;
+    current.x      = (tile % m_nbColumns) * m_tileSize;
+    current.y      = (tile / m_nbColumns) * m_tileSize;
+    current.width  = std::min(m_tileSize, m_width - current.x);
+    current.height = std::min(m_tileSize, m_height - current.y);
+
+    //The rows of the image go down, the frustum up
+    float scaleX = (m_right - m_left) / m_width;
+    float scaleY = (m_top - m_bottom) / m_height;
+    current.projection = glm::frustum(m_left + current.x*scaleX, m_left + (current.x + current.width)*scaleX,
+                                      m_top - (current.y + current.height)*scaleY, m_top - current.y*scaleY, m_near, m_far);
+
+    m_target.bind();
+    glViewport(0, 0, current.width, current.height);
+    glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+    return current;
+}
+
+void TiledRenderer::endTile()
+{
+    if(!m_rendering)
+        return;
+
+    //The tile read TILED_RENDERER_NB_BUFFERS tiles ago : done on the GPU while the next ones were submitted
+    if(m_filled[m_next])
+        readBack(m_next);
+
+    m_target.bind();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffers[m_next]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, m_current.width, m_current.height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_filled[m_next] = true;
+    m_tiles[m_next]  = m_current;
+    m_next = (m_next+1) % TILED_RENDERER_NB_BUFFERS;
+}
+
+bool TiledRenderer::finish()
+{
+    if(!m_rendering)
+        return false;
+
+    for(uint32_t i = 0; i < TILED_RENDERER_NB_BUFFERS; i++)
+    {
+        uint32_t buffer = (m_next + i) % TILED_RENDERER_NB_BUFFERS;
+        if(m_filled[buffer])
+            readBack(buffer);
+    }
+    JobSystem::getShared().wait(m_jobs);
+
+    glDeleteBuffers(TILED_RENDERER_NB_BUFFERS, m_buffers);
+    for(uint32_t i = 0; i < TILED_RENDERER_NB_BUFFERS; i++)
+        m_buffers[i] = 0;
+
+    if(!m_image.close())
+        m_failed = true;
+    m_rendering = false;
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    if(m_failed)
+        ERROR("The image %s could not be written\n", m_path.c_str());
+    else
+        INFO("%ux%u image written to %s in %.2f s (%.1f Mpixels/s)\n", m_width, m_height, m_path.c_str(), seconds, 1e-6 * m_width * m_height / seconds);
+    return !m_failed;
+}
+
+void TiledRenderer::readBack(uint32_t buffer)
+{
+    m_filled[buffer] = false;
+
+    //Slower workers than the GPU : wait for them rather than holding more tiles
+    if(m_nbPending.load() >= TILED_RENDERER_MAX_PENDING)
+        JobSystem::getShared().wait(m_jobs);
+
+    RenderTile tile = m_tiles[buffer];
+    std::vector<uint8_t>* pixels = new std::vector<uint8_t>(4*(size_t)tile.width*tile.height);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffers[buffer]);
+    void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, pixels->size(), GL_MAP_READ_BIT);
+    if(data != NULL)
+    {
+        memcpy(&(*pixels)[0], data, pixels->size());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if(data == NULL)
+    {
+        ERROR("Could not map the pixels of the tile (%u, %u)\n", tile.x, tile.y);
+        m_failed = true;
+        delete pixels;
+        return;
+    }
+
+    m_nbPending++;
+    JobSystem::getShared().run([this, tile, pixels]()
+    {
+        if(!m_failed && !m_image.writeBlock(tile.x, tile.y, tile.width, tile.height, &(*pixels)[0], true))
+            m_failed = true;
+        delete pixels;
+        m_nbPending--;
+    }, &m_jobs, "Tile writing");
+}
@@ -0,0 +1,162 @@
+#include "VertexFormat.h"
+#include <cstring>
+#include <cmath>
+
+#define INDICE_TO_PTR(x) ((void*)(uintptr_t)(x))
+
+VertexLayout getVertexLayout(const Geometry& geometry)
+{
+    uint32_t n = geometry.getNbVertices();
+    VertexLayout layout;
+    layout.format     = geometry.getVertexFormat();
+    layout.octNormals = false;
+
+    switch(layout.format)
+    {
+        case VERTEX_FORMAT_INTERLEAVED:
+            layout.stride   = 8*sizeof(float);
+            layout.position = {3, GL_FLOAT, GL_FALSE, 0};
+            layout.normal   = {3, GL_FLOAT, GL_FALSE, 3*sizeof(float)};
+            layout.uv       = {2, GL_FLOAT, GL_FALSE, 6*sizeof(float)};
+            break;
+
+        case VERTEX_FORMAT_COMPACT:
+        {
+            //UVs outside [0, 1] (seam copies of SphericalGeometry) do not fit in unorm16 : half floats take the same room
+            bool unitUVs = true;
+            for(uint32_t i = 0; i < 2*n && unitUVs; i++)
+                unitUVs = (geometry.getUVs()[i] >= 0.0f && geometry.getUVs()[i] <= 1.0f);
+
+            layout.stride     = 16;
+            layout.octNormals = true;
+            layout.position   = {3, GL_HALF_FLOAT, GL_FALSE, 0}; //+ 2 bytes of padding
+            layout.normal     = {2, GL_SHORT, GL_TRUE, 8};
+            layout.uv         = {2, unitUVs ? (GLenum)GL_UNSIGNED_SHORT : (GLenum)GL_HALF_FLOAT, unitUVs ? (GLboolean)GL_TRUE : (GLboolean)GL_FALSE, 12};
+            break;
+        }
+
+        case VERTEX_FORMAT_PLANAR:
+        default:
+            layout.stride   = 0;
+            layout.position = {3, GL_FLOAT, GL_FALSE, 0};
+            layout.normal   = {3, GL_FLOAT, GL_FALSE, (uint32_t)(3*sizeof(float)*n)};
+            layout.uv       = {2, GL_FLOAT, GL_FALSE, (uint32_t)(6*sizeof(float)*n)};
+            break;
+    }
+
+    layout.size = (layout.stride ? layout.stride : 8*sizeof(float)) * n;
+    return layout;
+}
+
+uint16_t floatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint16_t sign     = (bits >> 16) & 0x8000;
+    int32_t  exponent = ((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    if(((bits >> 23) & 0xff) == 0xff) //Inf / NaN
+        return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+    if(exponent >= 31) //Too large : infinity
+        return sign | 0x7c00;
+    if(exponent <= 0) //Subnormal half (or zero)
+    {
+        if(exponent < -10)
+            return sign;
+        mantissa |= 0x800000;
+        uint32_t shift = 14 - exponent;
+        uint32_t half  = mantissa >> shift;
+        if((mantissa >> (shift-1)) & 1) //Round to nearest
+            half++;
+        return sign | half;
+    }
+
+    uint16_t half = sign | (exponent << 10) | (mantissa >> 13);
+    if(mantissa & 0x1000) //Round to nearest (may carry into the exponent, which is still correct)
+        half++;
+    return half;
+}
+
+static int16_t toSnorm16(float value)
+{
+    value = fmaxf(-1.0f, fminf(1.0f, value));
+    return (int16_t)lrintf(value * 32767.0f);
+}
+
+static void encodeOctahedral(const float* normal, int16_t* dst)
+{
+    //Project on the octahedron |x|+|y|+|z| = 1, then fold the lower half (z < 0) on the outside of the upper one
+    float l1 = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+    float x  = (l1 > 0.0f) ? normal[0]/l1 : 0.0f;
+    float y  = (l1 > 0.0f) ? normal[1]/l1 : 0.0f;
+    if(normal[2] < 0.0f)
+    {
+        float ox = x;
+        x = (1.0f - fabsf(y))  * (ox >= 0.0f ? 1.0f : -1.0f);
+        y = (1.0f - fabsf(ox)) * (y  >= 0.0f ? 1.0f : -1.0f);
+    }
+    dst[0] = toSnorm16(x);
+    dst[1] = toSnorm16(y);
+}
+
+void packVertices(const Geometry& geometry, const VertexLayout& layout, void* dst)
+{
+    uint32_t n = geometry.getNbVertices();
+    const float* vertices = geometry.getVertices();
+    const float* normals  = geometry.getNormals();
+    const float* uvs      = geometry.getUVs();
+    uint8_t* bytes        = (uint8_t*)dst;
+
+    switch(layout.format)
+    {
+        case VERTEX_FORMAT_INTERLEAVED:
+            for(uint32_t i = 0; i < n; i++)
+            {
+                float* vertex = (float*)(bytes + i*layout.stride);
+                memcpy(vertex,   vertices + 3*i, 3*sizeof(float));
+                memcpy(vertex+3, normals  + 3*i, 3*sizeof(float));
+                memcpy(vertex+6, uvs      + 2*i, 2*sizeof(float));
+            }
+            break;
+
+        case VERTEX_FORMAT_COMPACT:
+            for(uint32_t i = 0; i < n; i++)
+            {
+                uint8_t* vertex    = bytes + i*layout.stride;
+                uint16_t* position = (uint16_t*)vertex;
+                for(uint32_t k = 0; k < 3; k++)
+                    position[k] = floatToHalf(vertices[3*i+k]);
+                position[3] = 0;
+
+                encodeOctahedral(normals + 3*i, (int16_t*)(vertex + layout.normal.offset));
+
+                uint16_t* uv = (uint16_t*)(vertex + layout.uv.offset);
+                for(uint32_t k = 0; k < 2; k++)
+                    uv[k] = (layout.uv.type == GL_UNSIGNED_SHORT) ? (uint16_t)lrintf(uvs[2*i+k] * 65535.0f) : floatToHalf(uvs[2*i+k]);
+            }
+            break;
+
+        case VERTEX_FORMAT_PLANAR:
+        default:
+            memcpy(bytes + layout.position.offset, vertices, 3*sizeof(float)*n);
+            memcpy(bytes + layout.normal.offset,   normals,  3*sizeof(float)*n);
+            memcpy(bytes + layout.uv.offset,       uvs,      2*sizeof(float)*n);
+            break;
+    }
+}
+
+void setVertexAttribPointers(const VertexLayout& layout, GLint positionLocation, GLint normalLocation, GLint uvLocation)
+{
+    const VertexAttribute* attributes[] = {&layout.position, &layout.normal, &layout.uv};
+    GLint locations[] = {positionLocation, normalLocation, uvLocation};
+
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        if(locations[i] < 0)
+            continue;
+        glVertexAttribPointer(locations[i], attributes[i]->size, attributes[i]->type, attributes[i]->normalized, layout.stride, INDICE_TO_PTR(attributes[i]->offset));
+        glEnableVertexAttribArray(locations[i]);
+    }
+}
@@ -0,0 +1,193 @@
+#include "VertexPuller.h"
+#include "logger.h"
+#include <cstring>
+#include <algorithm>
+
+#define INDICE_TO_PTR(x) ((void*)(uintptr_t)(x))
+
+//MeshRecord flags (same values in pulling.vert)
+#define MESH_COMPACT       1 //Half float position, octahedral normal, 16 bits uv
+#define MESH_UNORM_UV      2 //The compact uvs are unorm16 (half floats otherwise)
+#define MESH_INDEXED       4
+#define MESH_SHORT_INDICES 8 //Two 16 bits indices per word
+
+VertexPuller::VertexPuller() : m_drawStream(VERTEX_PULLER_MAX_DRAWS*sizeof(DrawRecord)), m_indirectStream(VERTEX_PULLER_MAX_DRAWS*4*sizeof(GLuint))
+{}
+
+VertexPuller::~VertexPuller()
+{
+    GLuint buffers[] = {m_dataBuffer, m_meshBuffer, m_indexBuffer};
+    glDeleteBuffers(3, buffers);
+    glDeleteVertexArrays(1, &m_VAO);
+}
+
+bool VertexPuller::isSupported()
+{
+    return GLEW_VERSION_4_3;
+}
+
+int VertexPuller::addMesh(const VertexLayout& layout, const void* vertexData, uint32_t nbVertices, const uint32_t* indices, uint32_t nbIndices)
+{
+    //The shader reads whole words : every attribute has to start on one
+    const VertexAttribute* attributes[] = {&layout.position, &layout.normal, &layout.uv};
+    bool aligned = (layout.stride % 4) == 0;
+    for(uint32_t i = 0; i < 3; i++)
+        aligned = aligned && (attributes[i]->offset % 4) == 0;
+
+    bool floats  = layout.position.type == GL_FLOAT && layout.normal.type == GL_FLOAT && layout.uv.type == GL_FLOAT && !layout.octNormals;
+    bool compact = layout.format == VERTEX_FORMAT_COMPACT && layout.stride != 0 && layout.position.type == GL_HALF_FLOAT &&
+                   layout.octNormals && layout.normal.type == GL_SHORT && (layout.uv.type == GL_UNSIGNED_SHORT || layout.uv.type == GL_HALF_FLOAT);
+    if(!aligned || !(floats || compact))
+    {
+        ERROR("This vertex layout cannot be decoded by the vertex pulling shader\n");
+        return -1;
+    }
+
+    MeshRecord mesh;
+    uint32_t base = m_words.size();
+    m_words.resize(base + (layout.size + 3)/4, 0);
+    memcpy(&m_words[base], vertexData, layout.size);
+
+    mesh.positionWord   = base + layout.position.offset/4;
+    mesh.normalWord     = base + layout.normal.offset/4;
+    mesh.uvWord         = base + layout.uv.offset/4;
+    mesh.positionStride = layout.stride ? layout.stride/4 : layout.position.size;
+    mesh.normalStride   = layout.stride ? layout.stride/4 : layout.normal.size;
+    mesh.uvStride       = layout.stride ? layout.stride/4 : layout.uv.size;
+    mesh.flags          = 0;
+    if(compact)
+        mesh.flags |= MESH_COMPACT | (layout.uv.type == GL_UNSIGNED_SHORT ? MESH_UNORM_UV : 0);
+
+    mesh.indexWord = m_words.size();
+    if(indices != NULL)
+    {
+        mesh.flags |= MESH_INDEXED;
+        if(nbVertices <= 0x10000)
+        {
+            //Small meshes : half the room, the shader picks the low or high half of the word
+            mesh.flags |= MESH_SHORT_INDICES;
+            m_words.resize(mesh.indexWord + (nbIndices + 1)/2, 0);
+            for(uint32_t i = 0; i < nbIndices; i++)
+                m_words[mesh.indexWord + i/2] |= indices[i] << (16*(i & 1));
+        }
+        else
+            m_words.insert(m_words.end(), indices, indices + nbIndices);
+    }
+
+    m_meshes.push_back(mesh);
+    return m_meshes.size()-1;
+}
+
+int VertexPuller::addMesh(const Geometry& geometry)
+{
+    VertexLayout layout = getVertexLayout(geometry);
+    void* data = malloc(layout.size);
+    packVertices(geometry, layout, data);
+
+    int mesh = addMesh(layout, data, geometry.getNbVertices(), geometry.getIndices(), geometry.getNbIndices());
+    free(data);
+    return mesh;
+}
+
+int VertexPuller::addMesh(const CachedMesh& mesh)
+{
+    return addMesh(mesh.getLayout(), mesh.getVertexData(), mesh.getNbVertices(), mesh.getIndices(), mesh.getNbIndices());
+}
+
+bool VertexPuller::upload()
+{
+    if(m_meshes.empty())
+        return false;
+
+    GLint maxBlockSize = 0;
+    glGetIntegerv(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &maxBlockSize);
+    size_t size = m_words.size()*sizeof(uint32_t);
+    if(size > (size_t)maxBlockSize)
+    {
+        ERROR("The meshes take %lu bytes, the shader storage blocks are limited to %d bytes\n", (unsigned long)size, maxBlockSize);
+        return false;
+    }
+
+    if(m_VAO == 0)
+    {
+        glGenBuffers(1, &m_dataBuffer);
+        glGenBuffers(1, &m_meshBuffer);
+        glGenBuffers(1, &m_indexBuffer);
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &m_recordAlignment);
+
+        //The draw index attribute : instanced, so the base instance of a draw selects its value, i.e. its record
+        std::vector<GLuint> drawIndices(VERTEX_PULLER_MAX_DRAWS);
+        for(uint32_t i = 0; i < VERTEX_PULLER_MAX_DRAWS; i++)
+            drawIndices[i] = i;
+
+        glGenVertexArrays(1, &m_VAO);
+        glBindVertexArray(m_VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, m_indexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, drawIndices.size()*sizeof(GLuint), &drawIndices[0], GL_STATIC_DRAW);
+        glVertexAttribIPointer(VERTEX_PULLER_DRAW_LOCATION, 1, GL_UNSIGNED_INT, 0, 0);
+        glVertexAttribDivisor(VERTEX_PULLER_DRAW_LOCATION, 1);
+        glEnableVertexAttribArray(VERTEX_PULLER_DRAW_LOCATION);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_dataBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, size, &m_words[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_meshBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, m_meshes.size()*sizeof(MeshRecord), &m_meshes[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return true;
+}
+
+void VertexPuller::draw(const PulledDraw* draws, uint32_t count)
+{
+    if(m_VAO == 0 || count == 0)
+        return;
+
+    glBindVertexArray(m_VAO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VERTEX_PULLER_DATA_BINDING,   m_dataBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VERTEX_PULLER_MESHES_BINDING, m_meshBuffer);
+
+    while(count > 0)
+    {
+        uint32_t batch = std::min(count, (uint32_t)VERTEX_PULLER_MAX_DRAWS);
+
+        //Written straight in the regions of the frame : the GPU still reads the ones of the previous frames
+        GLintptr recordOffset;
+        DrawRecord* records = (DrawRecord*)m_drawStream.map(batch*sizeof(DrawRecord), m_recordAlignment, &recordOffset);
+        for(uint32_t i = 0; i < batch; i++)
+        {
+            const PulledDraw& draw = draws[i];
+            DrawRecord& record  = records[i];
+            record.mvp          = draw.mvp;
+            record.model        = draw.model;
+            record.normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(draw.model))));
+            record.mesh         = draw.mesh;
+        }
+        m_drawStream.unmap();
+
+        //count, instanceCount, first, baseInstance : gl_VertexID runs over the index range, the base instance selects the record of the batch
+        GLintptr commandOffset;
+        GLuint* commands = (GLuint*)m_indirectStream.map(batch*4*sizeof(GLuint), 4, &commandOffset);
+        for(uint32_t i = 0; i < batch; i++)
+        {
+            GLuint* command = &commands[4*i];
+            command[0] = draws[i].nbIndices;
+            command[1] = 1;
+            command[2] = draws[i].firstIndex;
+            command[3] = i;
+        }
+        m_indirectStream.unmap();
+
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, VERTEX_PULLER_DRAWS_BINDING, m_drawStream.getBuffer(), recordOffset, batch*sizeof(DrawRecord));
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectStream.getBuffer());
+        glMultiDrawArraysIndirect(GL_TRIANGLES, INDICE_TO_PTR(commandOffset), batch, 0);
+
+        draws += batch;
+        count -= batch;
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindVertexArray(0);
+}
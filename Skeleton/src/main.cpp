@@ -5,6 +5,10 @@
 #include <stack>
 #include <cmath>
 #include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <memory>
 //OpenGL Libraries
 #include <GL/glew.h>
 #include <GL/gl.h>
@@ -15,22 +19,51 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "Shader.h"
+#include "OcclusionCuller.h"
 
 
 #include "logger.h"
 
 #include "Cube.h"
 #include "Sphere.h"
+#include "LODSphere.h"
+#include "Benchmark.h"
+#include "VertexFormat.h"
+#include "MeshCache.h"
+#include "PlanetTerrain.h"
+#include "GpuTimer.h"
+#include "VertexPuller.h"
+#include "MeshBuffer.h"
+#include "GpuCuller.h"
+#include "StreamBuffer.h"
+#include "FrameBuilder.h"
+#include "Parallel.h"
+#include "OverdrawCounter.h"
+#include "Framebuffer.h"
+#include "QualityGovernor.h"
+#include "FrameStats.h"
+#include "HeadlessContext.h"
+#include "ImageWriter.h"
+#include "FrameCapture.h"
+#include "TiledRenderer.h"
 
 #define vPositions 0
 #define vNormals 1
 #define vUV 2
 
-#define WIDTH     1000
+#define WIDTH     1000 //Default size of the frame, see --size
 #define HEIGHT    1000
 #define FRAMERATE 60
 #define TIME_PER_FRAME_MS  (1.0f/FRAMERATE * 1e3)
 #define INDICE_TO_PTR(x) ((void*)(x))
+#define BENCHMARK_FRAMES  300
+#define DRAW_DATA_TEXELS  11 //vec4 per batched draw : mvp, model matrix, normal matrix and texture layer (see scene.vert)
+#define ASTEROIDS         100000 //Bodies of the asteroid belt, only drawn by the GPU driven path and the multithreaded preparation
+#define IDLE_SETTLE_FRAMES 8     //Frames still drawn once nothing moves : the occlusion queries, the GPU culling depth and the terrain selections lag a few frames behind
+#define IDLE_TIMEOUT_MS   1000   //Longest wait for an event while idle : one frame then picks up what finished without any event
+#define STATS_PERIOD_MS   5000   //Period of the frame cost reports
+#define MAX_TIME_WARP     64.0f
+#define POSTER_TILE_SIZE  2048   //Default size of the tiles a poster is drawn in, see --tile-size
 
 struct Objet
 {
@@ -44,6 +77,25 @@ struct Objet
     glm::vec3 Constants = glm::vec3(0.2, 0.5, 0.4);
     float Alpha = 50.0;
     GLuint texture;
+    OcclusionQuery occlusion;
+    LODSphere* lod = NULL;  //If set, the VAO contains this LOD chain and the level is chosen each frame
+    uint32_t lodLevel = 0;
+    int terrainBody = -1;   //Handle in the PlanetTerrain, for the bodies we can fly close to
+    GLuint heightMap = 0;   //Relief of the tessellated sphere (0 : smooth)
+    int textureLayer = -1;  //Layer of its texture in the texture array of the batched draws (-1 : untextured)
+    int gpuBody = -1;       //Handle in the GpuCuller
+    int frameNode = -1;     //Node in the FrameBuilder
+};
+
+//A body of the plain mesh path, kept for after the traversal when the opaques are sorted or depth pre-passed (DrawOpaques)
+struct OpaqueDraw
+{
+    Objet*    objet;
+    glm::mat4 modelMatrix;
+    glm::mat4 mvp;
+    uint32_t  firstIndex; //Range of the level of its LOD chain, or of its vertices without LOD
+    uint32_t  count;
+    float     distance;   //From the camera to the front of its bounding sphere
 };
 
 struct Light {
@@ -52,20 +104,62 @@ struct Light {
     glm::vec3 lightColor = glm::vec3(1.0, 1.0, 1.0);
 };
 
-void Draw(std::stack<glm::mat4>& modelstack, const glm::mat4& view, const glm::mat4& projection, Shader* shader, Objet& objet, Light& light)
+struct SceneBatch
 {
-    glUseProgram(shader->getProgramID());
-    glBindVertexArray(objet.VAO);
-
-    modelstack.push(modelstack.top() * objet.propagatedMatrix);
-
-    glm::mat4 modelMatrix = modelstack.top() * objet.localMatrix;
-    glm::mat3 inv_modelMatrix = glm::inverse(glm::mat3(modelMatrix));
+    MeshBuffer* meshes;               //Every mesh of the scene in one vertex and one index buffer
+    int     sphere;                   //Handle of the LOD chain in the mesh buffer
+    Shader* shader;                   //Shader of the batched draws
+    GLuint  textures;                 //Texture array of the bodies (see Objet::textureLayer)
+    StreamBuffer* drawDataStream;     //drawData on the GPU, in the region of the frame...
+    GLuint  drawDataTexture;          //...read through this buffer texture
+    DrawCommandBuilder commands;      //The draws of the frame, their ID being their index
+    std::vector<glm::vec4> drawData;  //DRAW_DATA_TEXELS texels per draw of the frame
+    glm::vec3 constants;              //The material is the same for every body : the one of the first draw
+    float   alpha;
+};
 
-    glm::mat4 mvp = projection * glm::inverse(view) * modelMatrix;
+struct RenderContext
+{
+    Shader* shader;                   //Shader of the meshes
+    Shader* impostorShader;           //Shader of the ray-cast spheres
+    GLuint  emptyVAO;                 //Empty VAO : the impostor quads and the procedural spheres are built from gl_VertexID
+    bool    impostors = false;        //Draw the spheres as impostors instead of meshes
+    bool    procedural = false;       //Draw the spheres without vertex buffer, from the grid size only
+    PlanetTerrain* terrain;           //Chunked LOD of the rocky bodies
+    Shader* terrainShader;            //Shader of the terrain chunks
+    bool    terrainEnabled = false;   //Draw the rocky bodies with the terrain instead of the LOD chain
+    Shader* tessellationShader = NULL; //Shader refining a coarse sphere on the GPU (NULL without GL 4.0)
+    bool    tessellation = false;     //Draw the spheres with the tessellation shader instead of the LOD chain
+    float   edgePixels = 8.0f;        //Target length on screen of the tessellated edges
+    VertexPuller* puller = NULL;      //Every mesh in shader storage buffers (NULL without GL 4.3)
+    Shader* pullingShader = NULL;     //Shader decoding the vertices from the puller buffers
+    int     pulledSphere = -1;        //Handle of the LOD chain in the puller
+    bool    pulling = false;          //Draw the LOD spheres by vertex pulling instead of their VAO
+    SceneBatch* batch = NULL;         //Draws of the bodies gathered during the traversal (NULL without GL 3.2)
+    bool    batching = false;         //Draw the LOD spheres in one multi-draw after the traversal
+    GpuCuller* gpuCuller = NULL;      //Bodies culled and drawn by compute shaders (NULL without GL 4.3)
+    Shader* gpuDrivenShader = NULL;   //Shader of the bodies kept by the GPU culling
+    bool    gpuDriven = false;        //Only update the body matrices during the traversal, the GPU culls and draws them after it
+    FrameBuilder* frameBuilder = NULL; //Draws of the batch prepared on the worker threads (NULL without batching)
+    bool    prepared = false;         //Only update the node matrices during the traversal, the workers prepare the batch after it
+    Shader* depthShader;              //Depth only shader of the pre-pass (the one of the occlusion proxies)
+    GLuint  lodPositionVAO = 0;       //The LOD chain with its positions only, for the pre-pass
+    bool    depthPrepass = false;     //Lay the depth of the opaque meshes first, then shade them with GL_EQUAL
+    bool    frontToBack = false;      //Draw the opaque meshes nearest first
+    std::vector<OpaqueDraw> opaques;  //The opaque meshes of the frame, when one of the two above is on
+    OverdrawCounter* overdraw = NULL; //Counts the fragments of each pass (benchmark only)
+    uint32_t width = WIDTH;           //Size of the frame : of the window, or of the target of the headless backend
+    uint32_t height = HEIGHT;
+    int     lodBias = 0;              //Added to the levels of the LOD chains by the quality governor
+    bool    effects = true;           //False when the quality governor turned the terrain and the tessellation off
+    OcclusionCuller* culler;
+};
 
+void SetBodyUniforms(const Shader* shader, const glm::mat4& view, const glm::mat4& projection, const Objet& objet, const glm::mat4& mvp, const glm::mat4& modelMatrix, const Light& light, bool procedural)
+{
     glm::vec4 tmp = glm::inverse(projection * glm::inverse(view)) * glm::vec4(0, 0, -1, 1);
     glm::vec3 camera = glm::vec3(tmp) / tmp.w;
+    glm::mat3 inv_modelMatrix = glm::inverse(glm::mat3(modelMatrix));
 
     GLint uMVP = glGetUniformLocation(shader->getProgramID(), "uMVP");
     glUniformMatrix4fv(uMVP, 1, GL_FALSE, glm::value_ptr(mvp));
@@ -94,17 +188,230 @@ void Draw(std::stack<glm::mat4>& modelstack, const glm::mat4& view, const glm::m
     GLint cameraposition = glGetUniformLocation(shader->getProgramID(), "cameraposition");
     glUniform3fv(cameraposition, 1, glm::value_ptr(camera));
 
+    //Compact vertices carry octahedral normals (only the LOD spheres use this format)
+    GLint uOctNormals = glGetUniformLocation(shader->getProgramID(), "uOctNormals");
+    glUniform1i(uOctNormals, objet.lod != NULL && objet.lod->getVertexFormat() == VERTEX_FORMAT_COMPACT);
+
+    GLint uProcedural = glGetUniformLocation(shader->getProgramID(), "uProcedural");
+    glUniform1i(uProcedural, procedural);
+
     //uTexture
     GLint uTexture = glGetUniformLocation(shader->getProgramID(), "uTexture");
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, objet.texture); //Ici je dis que GL_TEXTURE_0 est la texture de l'objet
     glUniform1i(uTexture, 0); //uTexture vaut ici ce que vaut GL_TEXTURE_0.
+}
+
+void Draw(std::stack<glm::mat4>& modelstack, const glm::mat4& view, const glm::mat4& projection, RenderContext& ctx, Objet& objet, Light& light)
+{
+    modelstack.push(modelstack.top() * objet.propagatedMatrix);
+
+    glm::mat4 modelMatrix = modelstack.top() * objet.localMatrix;
+    glm::mat3 inv_modelMatrix = glm::inverse(glm::mat3(modelMatrix));
+
+    glm::mat4 mvp = projection * glm::inverse(view) * modelMatrix;
 
-    glDrawArrays(GL_TRIANGLES, 0, objet.nbVertices); //Je d�ssine l'objet car uTexture vaut ce que vaut GL_TEXTURE_0, et que GL_TEXTURE_0 == objet.texture
+    bool gpuDriven = ctx.gpuDriven && ctx.gpuCuller != NULL && objet.gpuBody >= 0;
+    bool prepared = !gpuDriven && ctx.prepared && ctx.frameBuilder != NULL && objet.frameNode >= 0;
+    bool impostor = !gpuDriven && !prepared && ctx.impostors && objet.lod != NULL;
+    bool terrain = !impostor && ctx.effects && ctx.terrainEnabled && objet.terrainBody >= 0;
+    bool tessellated = !impostor && !terrain && ctx.effects && ctx.tessellation && ctx.tessellationShader != NULL && objet.lod != NULL;
+    bool batched = !impostor && !terrain && !tessellated && ctx.batching && ctx.batch != NULL && objet.lod != NULL;
+    bool procedural = !impostor && !terrain && !tessellated && !batched && ctx.procedural && objet.lod != NULL;
+    bool pulled = !impostor && !terrain && !tessellated && !batched && !procedural && ctx.pulling && ctx.pulledSphere >= 0 && objet.lod != NULL;
+    bool deferred = !impostor && !terrain && !tessellated && !batched && !procedural && !pulled && (ctx.depthPrepass || ctx.frontToBack);
+
+    if (gpuDriven)
+    {
+        //The GPU selects the level and tests the visibility itself (DrawGpuDriven) : only the matrix is needed, and only if it moved
+        ctx.gpuCuller->setBody(objet.gpuBody, modelMatrix);
+
+        for (Objet* child : objet.children) {
+            Draw(modelstack, view, projection, ctx, *child, light);
+        }
+        modelstack.pop();
+        return;
+    }
+
+    if (prepared)
+    {
+        //Copied as is : the world matrices, culling and levels are computed by the workers (FrameBuilder::build)
+        ctx.frameBuilder->setNode(objet.frameNode, objet.propagatedMatrix, objet.localMatrix);
+
+        for (Objet* child : objet.children) {
+            Draw(modelstack, view, projection, ctx, *child, light);
+        }
+        modelstack.pop();
+        return;
+    }
+
+    if (batched)
+    {
+        //Only recorded here : the whole scene goes out in one multi-draw after the traversal (DrawBatch), without occlusion queries
+        float screenRadius = LODSphere::computeScreenRadius(modelMatrix, glm::vec3(view[3]), projection, ctx.height);
+        objet.lodLevel = objet.lod->selectLevel(screenRadius, objet.lodLevel, ctx.lodBias);
+        const LODRange& range = objet.lod->getLevel(objet.lodLevel);
+
+        SceneBatch& batch = *ctx.batch;
+        if (batch.commands.getNbCommands() == 0)
+        {
+            batch.constants = objet.Constants;
+            batch.alpha = objet.Alpha;
+        }
+        batch.commands.add(batch.meshes->getMesh(batch.sphere), range.firstIndex, range.nbIndices, batch.commands.getNbCommands());
+
+        glm::mat3 normalMatrix = glm::transpose(inv_modelMatrix);
+        for (int i = 0; i < 4; i++)
+            batch.drawData.push_back(mvp[i]);
+        for (int i = 0; i < 4; i++)
+            batch.drawData.push_back(modelMatrix[i]);
+        for (int i = 0; i < 3; i++)
+            batch.drawData.push_back(glm::vec4(normalMatrix[i], i == 0 ? (float)objet.textureLayer : 0.0f));
+
+        for (Objet* child : objet.children) {
+            Draw(modelstack, view, projection, ctx, *child, light);
+        }
+        modelstack.pop();
+        return;
+    }
+
+    if (deferred)
+    {
+        //Recorded with its level and its distance : DrawOpaques orders the meshes and lays their depth once the traversal is done
+        OpaqueDraw draw;
+        draw.objet = &objet;
+        draw.modelMatrix = modelMatrix;
+        draw.mvp = mvp;
+        draw.firstIndex = 0;
+        draw.count = objet.nbVertices;
+        if (objet.lod != NULL)
+        {
+            float screenRadius = LODSphere::computeScreenRadius(modelMatrix, glm::vec3(view[3]), projection, ctx.height);
+            objet.lodLevel = objet.lod->selectLevel(screenRadius, objet.lodLevel, ctx.lodBias);
+            const LODRange& range = objet.lod->getLevel(objet.lodLevel);
+            draw.firstIndex = range.firstIndex;
+            draw.count = range.nbIndices;
+        }
+        float radius = 0.5f * glm::max(glm::length(glm::vec3(modelMatrix[0])), glm::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+        draw.distance = glm::length(glm::vec3(modelMatrix[3]) - glm::vec3(view[3])) - radius;
+        ctx.opaques.push_back(draw);
+
+        for (Objet* child : objet.children) {
+            Draw(modelstack, view, projection, ctx, *child, light);
+        }
+        modelstack.pop();
+        return;
+    }
+
+    //Proxy test (if the body was hidden) before binding the real shader
+    ctx.culler->beginBody(objet.occlusion, mvp);
+
+    Shader* shader = impostor ? ctx.impostorShader : (terrain ? ctx.terrainShader : (tessellated ? ctx.tessellationShader : (pulled ? ctx.pullingShader : ctx.shader)));
+    glUseProgram(shader->getProgramID());
+    if (!pulled) //The puller binds its own VAO, the same for every mesh
+        glBindVertexArray((impostor || procedural) ? ctx.emptyVAO : objet.VAO);
+
+    SetBodyUniforms(shader, view, projection, objet, mvp, modelMatrix, light, procedural);
+
+    if (impostor)
+    {
+        //One quad per sphere, the surface is ray-cast in the fragment shader
+        glm::mat3 rotation = glm::mat3(modelMatrix);
+        float scale = 0.0f;
+        for (int i = 0; i < 3; i++)
+        {
+            scale = glm::max(scale, glm::length(rotation[i]));
+            rotation[i] = glm::normalize(rotation[i]);
+        }
 
+        glm::vec3 center = glm::vec3(modelMatrix[3]);
+        glm::mat4 viewMatrix = glm::inverse(view);
+        glm::mat3 inv_rotation = glm::transpose(rotation);
+
+        GLint uCenter = glGetUniformLocation(shader->getProgramID(), "uCenter");
+        glUniform3fv(uCenter, 1, glm::value_ptr(center));
+
+        GLint uRadius = glGetUniformLocation(shader->getProgramID(), "uRadius");
+        glUniform1f(uRadius, 0.5f * scale);
+
+        GLint uView = glGetUniformLocation(shader->getProgramID(), "uView");
+        glUniformMatrix4fv(uView, 1, GL_FALSE, glm::value_ptr(viewMatrix));
+
+        GLint uInvView = glGetUniformLocation(shader->getProgramID(), "uInvView");
+        glUniformMatrix4fv(uInvView, 1, GL_FALSE, glm::value_ptr(view));
+
+        GLint uProjection = glGetUniformLocation(shader->getProgramID(), "uProjection");
+        glUniformMatrix4fv(uProjection, 1, GL_FALSE, glm::value_ptr(projection));
+
+        GLint uInvRotation = glGetUniformLocation(shader->getProgramID(), "uInvRotation");
+        glUniformMatrix3fv(uInvRotation, 1, GL_FALSE, glm::value_ptr(inv_rotation));
+
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+    else if (terrain)
+    {
+        //The chunks drawn now were selected from the previous request : the worker selects the next ones meanwhile
+        glm::vec3 cameraModel = glm::vec3(glm::inverse(modelMatrix) * glm::vec4(glm::vec3(view[3]), 1.0f));
+        ctx.terrain->requestSelection(objet.terrainBody, mvp, cameraModel);
+        ctx.terrain->draw(objet.terrainBody, shader, cameraModel);
+    }
+    else if (tessellated)
+    {
+        //A coarse level of the chain as control mesh : the GPU splits its edges by their length on screen
+        const LODRange& control = objet.lod->getLevel(objet.lod->getNbLevels() > 1 ? 1 : 0);
+
+        GLint uViewport = glGetUniformLocation(shader->getProgramID(), "uViewport");
+        glUniform2f(uViewport, (float)ctx.width, (float)ctx.height);
+
+        GLint uEdgePixels = glGetUniformLocation(shader->getProgramID(), "uEdgePixels");
+        glUniform1f(uEdgePixels, ctx.edgePixels);
+
+        GLint uDisplaced = glGetUniformLocation(shader->getProgramID(), "uDisplaced");
+        glUniform1i(uDisplaced, objet.heightMap != 0);
+
+        GLint uHeightMap = glGetUniformLocation(shader->getProgramID(), "uHeightMap");
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, objet.heightMap);
+        glUniform1i(uHeightMap, 1);
+        glActiveTexture(GL_TEXTURE0);
+
+        glPatchParameteri(GL_PATCH_VERTICES, 3);
+        glDrawElements(GL_PATCHES, control.nbIndices, GL_UNSIGNED_INT, INDICE_TO_PTR(control.firstIndex * sizeof(uint32_t)));
+    }
+    else if (objet.lod != NULL)
+    {
+        //Level of detail from the projected size of the body
+        float screenRadius = LODSphere::computeScreenRadius(modelMatrix, glm::vec3(view[3]), projection, ctx.height);
+        objet.lodLevel = objet.lod->selectLevel(screenRadius, objet.lodLevel, ctx.lodBias);
+        const LODRange& range = objet.lod->getLevel(objet.lodLevel);
+        if (procedural)
+        {
+            //The grid size is all the vertex shader needs : one strip of 2*resolution+2 vertices per longitude band
+            GLint uGrid = glGetUniformLocation(shader->getProgramID(), "uGrid");
+            glUniform2i(uGrid, range.resolution, range.resolution);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, (range.resolution - 1) * (2 * range.resolution + 2));
+        }
+        else if (pulled)
+        {
+            //The level is a range of the mesh in the puller buffers, the matrices go with the draw record
+            PulledDraw draw;
+            draw.mesh       = ctx.pulledSphere;
+            draw.firstIndex = range.firstIndex;
+            draw.nbIndices  = range.nbIndices;
+            draw.mvp        = mvp;
+            draw.model      = modelMatrix;
+            ctx.puller->draw(&draw, 1);
+        }
+        else
+            glDrawElements(GL_TRIANGLES, range.nbIndices, GL_UNSIGNED_INT, INDICE_TO_PTR(range.firstIndex * sizeof(uint32_t)));
+    }
+    else
+        glDrawArrays(GL_TRIANGLES, 0, objet.nbVertices); //Je d�ssine l'objet car uTexture vaut ce que vaut GL_TEXTURE_0, et que GL_TEXTURE_0 == objet.texture
+
+    ctx.culler->endBody(objet.occlusion);
 
     for (Objet* child : objet.children) {
-        Draw(modelstack, view, projection, shader, *child, light);
+        Draw(modelstack, view, projection, ctx, *child, light);
     }
 
     modelstack.pop();
@@ -113,74 +420,525 @@ void Draw(std::stack<glm::mat4>& modelstack, const glm::mat4& view, const glm::m
     glUseProgram(0);
 }
 
+void DrawOpaques(const glm::mat4& view, const glm::mat4& projection, RenderContext& ctx, Light& light)
+{
+    std::vector<OpaqueDraw>& opaques = ctx.opaques;
+    if (opaques.empty())
+        return;
 
-GLuint generate_VAO(const Geometry& forme)
+    //Nearest first : the farther fragments fail the depth test before being shaded (the pre-pass is cheaper this way too)
+    std::sort(opaques.begin(), opaques.end(), [](const OpaqueDraw& a, const OpaqueDraw& b) {return a.distance < b.distance;});
+
+    if (ctx.depthPrepass)
+    {
+        //Positions only and no color : the depth of the nearest surface of each pixel, for the cost of a vertex pass
+        if (ctx.overdraw != NULL && ctx.overdraw->getCurrentPass() == OVERDRAW_SHADING)
+            ctx.overdraw->begin(OVERDRAW_DEPTH);
+
+        Shader* shader = ctx.depthShader;
+        glUseProgram(shader->getProgramID());
+        GLint uMVP = glGetUniformLocation(shader->getProgramID(), "uMVP");
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        for (const OpaqueDraw& draw : opaques)
+        {
+            glBindVertexArray(draw.objet->lod != NULL ? ctx.lodPositionVAO : draw.objet->VAO);
+            glUniformMatrix4fv(uMVP, 1, GL_FALSE, glm::value_ptr(draw.mvp));
+            if (draw.objet->lod != NULL)
+                glDrawElements(GL_TRIANGLES, draw.count, GL_UNSIGNED_INT, INDICE_TO_PTR(draw.firstIndex * sizeof(uint32_t)));
+            else
+                glDrawArrays(GL_TRIANGLES, 0, draw.count);
+        }
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+        //Only the fragments of the nearest surface pass now : each pixel is shaded once
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+
+        if (ctx.overdraw != NULL && ctx.overdraw->getCurrentPass() == OVERDRAW_DEPTH)
+            ctx.overdraw->begin(OVERDRAW_SHADING);
+    }
+
+    Shader* shader = ctx.shader;
+    glUseProgram(shader->getProgramID());
+    for (const OpaqueDraw& draw : opaques)
+    {
+        Objet& objet = *draw.objet;
+
+        //The pre-pass already resolved the visibility, and the proxies of the culler would be tested with GL_EQUAL
+        if (!ctx.depthPrepass)
+        {
+            ctx.culler->beginBody(objet.occlusion, draw.mvp);
+            glUseProgram(shader->getProgramID());
+        }
+
+        glBindVertexArray(objet.VAO);
+        SetBodyUniforms(shader, view, projection, objet, draw.mvp, draw.modelMatrix, light, false);
+        if (objet.lod != NULL)
+            glDrawElements(GL_TRIANGLES, draw.count, GL_UNSIGNED_INT, INDICE_TO_PTR(draw.firstIndex * sizeof(uint32_t)));
+        else
+            glDrawArrays(GL_TRIANGLES, 0, draw.count);
+
+        if (!ctx.depthPrepass)
+            ctx.culler->endBody(objet.occlusion);
+    }
+
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    opaques.clear();
+}
+
+void DrawBatch(const glm::mat4& view, const glm::mat4& projection, RenderContext& ctx, Light& light)
+{
+    SceneBatch& batch = *ctx.batch;
+    if (batch.commands.getNbCommands() == 0)
+        return;
+
+    //The texture reads the whole stream buffer (it may have grown) : the draws find their texels from the offset of the frame
+    GLintptr drawDataOffset = batch.drawDataStream->write(&batch.drawData[0], batch.drawData.size() * sizeof(glm::vec4), sizeof(glm::vec4));
+    glBindTexture(GL_TEXTURE_BUFFER, batch.drawDataTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, batch.drawDataStream->getBuffer());
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    Shader* shader = batch.shader;
+    glUseProgram(shader->getProgramID());
+
+    glm::vec4 tmp = glm::inverse(projection * glm::inverse(view)) * glm::vec4(0, 0, -1, 1);
+    glm::vec3 camera = glm::vec3(tmp) / tmp.w;
+
+    GLint constants = glGetUniformLocation(shader->getProgramID(), "constants");
+    glUniform3fv(constants, 1, glm::value_ptr(batch.constants));
+
+    GLint alpha = glGetUniformLocation(shader->getProgramID(), "alpha");
+    glUniform1f(alpha, batch.alpha);
+
+    GLint lightcolor = glGetUniformLocation(shader->getProgramID(), "lightcolor");
+    glUniform3fv(lightcolor, 1, glm::value_ptr(light.lightColor));
+
+    GLint lightposition = glGetUniformLocation(shader->getProgramID(), "lightposition");
+    glUniform3fv(lightposition, 1, glm::value_ptr(light.lightPosition));
+
+    GLint cameraposition = glGetUniformLocation(shader->getProgramID(), "cameraposition");
+    glUniform3fv(cameraposition, 1, glm::value_ptr(camera));
+
+    GLint uOctNormals = glGetUniformLocation(shader->getProgramID(), "uOctNormals");
+    glUniform1i(uOctNormals, batch.meshes->getLayout().octNormals);
+
+    GLint uTextures = glGetUniformLocation(shader->getProgramID(), "uTextures");
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, batch.textures);
+    glUniform1i(uTextures, 0);
+
+    GLint uDrawBase = glGetUniformLocation(shader->getProgramID(), "uDrawBase");
+    glUniform1i(uDrawBase, drawDataOffset / sizeof(glm::vec4));
+
+    GLint uDrawData = glGetUniformLocation(shader->getProgramID(), "uDrawData");
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, batch.drawDataTexture);
+    glUniform1i(uDrawData, 1);
+    glActiveTexture(GL_TEXTURE0);
+
+    batch.meshes->draw(batch.commands);
+
+    batch.commands.clear();
+    batch.drawData.clear();
+    glUseProgram(0);
+}
+
+void DrawGpuDriven(const glm::mat4& view, const glm::mat4& projection, RenderContext& ctx, Light& light)
+{
+    glm::mat4 viewMatrix = glm::inverse(view);
+    ctx.gpuCuller->cull(viewMatrix, projection, ctx.height);
+
+    //Same material and texture array as the batched draws (scene.frag)
+    SceneBatch& batch = *ctx.batch;
+    Shader* shader = ctx.gpuDrivenShader;
+    glUseProgram(shader->getProgramID());
+
+    glm::mat4 viewProjection = projection * viewMatrix;
+    glm::vec3 camera = glm::vec3(view[3]);
+
+    GLint uViewProjection = glGetUniformLocation(shader->getProgramID(), "uViewProjection");
+    glUniformMatrix4fv(uViewProjection, 1, GL_FALSE, glm::value_ptr(viewProjection));
+
+    GLint constants = glGetUniformLocation(shader->getProgramID(), "constants");
+    glUniform3fv(constants, 1, glm::value_ptr(batch.constants));
+
+    GLint alpha = glGetUniformLocation(shader->getProgramID(), "alpha");
+    glUniform1f(alpha, batch.alpha);
+
+    GLint lightcolor = glGetUniformLocation(shader->getProgramID(), "lightcolor");
+    glUniform3fv(lightcolor, 1, glm::value_ptr(light.lightColor));
+
+    GLint lightposition = glGetUniformLocation(shader->getProgramID(), "lightposition");
+    glUniform3fv(lightposition, 1, glm::value_ptr(light.lightPosition));
+
+    GLint cameraposition = glGetUniformLocation(shader->getProgramID(), "cameraposition");
+    glUniform3fv(cameraposition, 1, glm::value_ptr(camera));
+
+    GLint uOctNormals = glGetUniformLocation(shader->getProgramID(), "uOctNormals");
+    glUniform1i(uOctNormals, batch.meshes->getLayout().octNormals);
+
+    GLint uTextures = glGetUniformLocation(shader->getProgramID(), "uTextures");
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, batch.textures);
+    glUniform1i(uTextures, 0);
+
+    ctx.gpuCuller->draw();
+    glUseProgram(0);
+}
+
+void add_frameNodes(FrameBuilder& builder, Objet& objet, int32_t parent)
+{
+    FrameNode node;
+    node.parent = parent;
+    node.propagatedMatrix = objet.propagatedMatrix;
+    node.localMatrix = objet.localMatrix;
+    node.textureLayer = objet.textureLayer;
+    node.drawn = objet.lod != NULL;
+    objet.frameNode = builder.addNode(node);
+
+    for (Objet* child : objet.children)
+        add_frameNodes(builder, *child, objet.frameNode);
+}
+
+GLuint generate_VAO(const VertexLayout& layout, const void* vertexData, const uint32_t* indices, uint32_t nbIndices)
 {
     GLuint VBO;
     glGenBuffers(1, &VBO);
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
-    glBufferData(GL_ARRAY_BUFFER, (3 + 3 + 2) * sizeof(float) * forme.getNbVertices(), NULL, GL_DYNAMIC_DRAW);
-
-    glBufferSubData(GL_ARRAY_BUFFER, 0, 3 * sizeof(float) * forme.getNbVertices(), forme.getVertices());
-    glBufferSubData(GL_ARRAY_BUFFER, 3 * sizeof(float) * forme.getNbVertices(), 3 * sizeof(float) * forme.getNbVertices(), forme.getNormals());
-    glBufferSubData(GL_ARRAY_BUFFER, (3 + 3) * sizeof(float) * forme.getNbVertices(), forme.getNbVertices() * 2 * sizeof(float), forme.getUVs());
+    glBufferData(GL_ARRAY_BUFFER, layout.size, vertexData, GL_STATIC_DRAW);
 
     GLuint vao;
     glGenVertexArrays(1, &vao);
     glBindVertexArray(vao);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
-    glVertexAttribPointer(vPositions, 3, GL_FLOAT, 0, 0, 0);
-    glEnableVertexAttribArray(vPositions);
+    setVertexAttribPointers(layout, vPositions, vNormals, vUV);
+
+    //The element buffer is part of the VAO state
+    if (indices != NULL)
+    {
+        GLuint EBO;
+        glGenBuffers(1, &EBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, nbIndices * sizeof(uint32_t), indices, GL_STATIC_DRAW);
+    }
 
+    glBindVertexArray(0);
+
+    return vao;
+}
+
+GLuint generate_VAO(const Geometry& forme)
+{
+    //Vertices laid out as asked by the geometry (planar, interleaved or compact)
+    VertexLayout layout = getVertexLayout(forme);
+    void* data = malloc(layout.size);
+    packVertices(forme, layout, data);
+
+    GLuint vao = generate_VAO(layout, data, forme.getIndices(), forme.getNbIndices());
+    free(data);
+    return vao;
+}
+
+GLuint generate_VAO(const CachedMesh& mesh)
+{
+    //Straight from the mapped file to the driver
+    return generate_VAO(mesh.getLayout(), mesh.getVertexData(), mesh.getIndices(), mesh.getNbIndices());
+}
+
+GLuint generate_positionVAO(const VertexLayout& layout, const void* vertexData, uint32_t nbVertices, GLuint meshVAO)
+{
+    //The positions alone, packed in their own buffer in their own format : a depth only pass fetches nothing else
+    uint32_t positionSize = layout.position.size * (layout.position.type == GL_FLOAT ? sizeof(float) : sizeof(uint16_t));
+    uint32_t stride = (positionSize + 3) & ~3u;
+    uint32_t sourceStride = layout.stride ? layout.stride : positionSize;
+    std::vector<uint8_t> positions(stride * nbVertices);
+    for (uint32_t i = 0; i < nbVertices; i++)
+        memcpy(&positions[i * stride], (const uint8_t*)vertexData + layout.position.offset + i * sourceStride, positionSize);
 
-    glVertexAttribPointer(vNormals, 3, GL_FLOAT, 0, 0, INDICE_TO_PTR(3 * forme.getNbVertices() * sizeof(float)));
-    glEnableVertexAttribArray(vNormals);
+    GLuint VBO;
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, positions.size(), &positions[0], GL_STATIC_DRAW);
 
-    glVertexAttribPointer(vUV, 2, GL_FLOAT, 0, 0, INDICE_TO_PTR((3 + 3) * forme.getNbVertices() * sizeof(float)));
-    glEnableVertexAttribArray(vUV);
+    //Same indices : the element buffer of the mesh VAO is shared
+    GLint EBO = 0;
+    glBindVertexArray(meshVAO);
+    glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &EBO);
+
+    GLuint vao;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glVertexAttribPointer(vPositions, layout.position.size, layout.position.type, layout.position.normalized, stride, 0);
+    glEnableVertexAttribArray(vPositions);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
 
+    glBindVertexArray(0);
     return vao;
 }
 
+GLuint generate_heightMap(const PlanetNoise& relief, uint32_t width, uint32_t height)
+{
+    //Equirectangular, as the textures of the planets : the tessellation reads it with the uv of the sphere
+    std::vector<float> heights(width * height);
+    relief.sampleMap(width, height, &heights[0]);
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, &heights[0]);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return texture;
+}
+
+std::vector<glm::mat4> generate_asteroidBelt(uint32_t nbAsteroids, float innerOrbit, float outerOrbit)
+{
+    //A fixed seed : every run has the same belt
+    float margin = 0.2f * (outerOrbit - innerOrbit);
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> orbit(innerOrbit + margin, outerOrbit - margin);
+    std::uniform_real_distribution<float> angle(0.0f, 2.0f * (float)M_PI);
+    std::uniform_real_distribution<float> height(-0.4f, 0.4f);
+    std::uniform_real_distribution<float> size(0.02f, 0.08f);
+    std::uniform_real_distribution<float> stretch(0.7f, 1.3f);
+
+    std::vector<glm::mat4> asteroids(nbAsteroids);
+    for (uint32_t i = 0; i < nbAsteroids; i++)
+    {
+        float radius = orbit(random);
+        float theta = angle(random);
+        float scale = size(random);
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(radius * cosf(theta), height(random), radius * sinf(theta)));
+        model = glm::rotate(model, angle(random), glm::normalize(glm::vec3(stretch(random) - 1.0f, 1.0f, stretch(random) - 1.0f)));
+        asteroids[i] = glm::scale(model, scale * glm::vec3(stretch(random), stretch(random), stretch(random)));
+    }
+    return asteroids;
+}
+
+SDL_Surface* load_surface(const char* path)
+{
+    //A missing texture is not worth stopping for : the body is drawn grey
+    SDL_Surface* image = IMG_Load(path);
+    if (image == NULL)
+    {
+        WARNING("Could not load %s (%s), a grey texture replaces it\n", path, IMG_GetError());
+        SDL_Surface* grey = SDL_CreateRGBSurfaceWithFormat(0, 2, 2, 32, SDL_PIXELFORMAT_RGBA32);
+        SDL_FillRect(grey, NULL, SDL_MapRGBA(grey->format, 128, 128, 128, 255));
+        return grey;
+    }
+    SDL_Surface* rgba = SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(image);
+    return rgba;
+}
+
+GLuint generate_textureArray(SDL_Surface** surfaces, uint32_t nbSurfaces, int width, int height)
+{
+    //Every layer has the same size : the surfaces of another size are scaled
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, nbSurfaces, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+    for (uint32_t i = 0; i < nbSurfaces; i++)
+    {
+        SDL_Surface* layer = surfaces[i];
+        SDL_Surface* scaled = NULL;
+        if (layer->w != width || layer->h != height)
+        {
+            scaled = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+            SDL_SetSurfaceBlendMode(layer, SDL_BLENDMODE_NONE);
+            SDL_BlitScaled(layer, NULL, scaled, NULL);
+            layer = scaled;
+        }
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, layer->pixels);
+        if (scaled != NULL)
+            SDL_FreeSurface(scaled);
+    }
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    return texture;
+}
+
+void set_textureLodBias(Objet* const* bodies, uint32_t nbBodies, GLuint textureArray, float bias)
+{
+    //A parameter of the textures themselves : it follows them on whatever unit they are bound to
+    for (uint32_t i = 0; i < nbBodies; i++)
+    {
+        glBindTexture(GL_TEXTURE_2D, bodies[i]->texture);
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_LOD_BIAS, bias);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (textureArray != 0)
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray);
+        glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_LOD_BIAS, bias);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+}
+
+//The window and its context. Declared before any GL object of main() and so destroyed after them all : they are released while the
+//context is still current, like with the HeadlessContext
+struct WindowContext
+{
+    SDL_Window*   window = NULL;
+    SDL_GLContext context = NULL;
+
+    ~WindowContext()
+    {
+        if (context != NULL)
+            SDL_GL_DeleteContext(context);
+        if (window != NULL)
+            SDL_DestroyWindow(window);
+    }
+};
+
 int main(int argc, char* argv[])
 {
+    //Options, anywhere :
+    //--pin-threads : the GL thread and the workers each keep a core of their own
+    //--headless : no window, the frames are drawn offscreen through EGL (see HeadlessContext)
+    //--size WxH : the size of the frame
+    //--frames N : the frames drawn by the headless backend before quitting (1 by default)
+    //--output file.ppm : where the headless backend saves its last frame
+    //--capture frames/%05u.qoi : record every frame as an image (.ppm, .qoi or .png), from the start. 'x' starts and stops the recording
+    //--capture-pipe "command" : record every frame to the standard input of an encoder instead, as raw RGBA
+    //--poster WxH file.ppm : draw the first frame again as a poster of that size, a tile at a time (headless : the last frame). 'j' draws another one
+    //--tile-size N : the size of the tiles of the poster
+    bool headless = false;
+    uint32_t frameWidth = WIDTH;
+    uint32_t frameHeight = HEIGHT;
+    uint32_t headlessFrames = 1;
+    const char* outputPath = NULL;
+    const char* capturePattern = NULL;
+    const char* captureCommand = NULL;
+    uint32_t posterWidth = 8 * WIDTH;
+    uint32_t posterHeight = 8 * HEIGHT;
+    const char* posterPath = NULL;
+    uint32_t posterTileSize = POSTER_TILE_SIZE;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--pin-threads") == 0)
+            setWorkerPinning(true);
+        else if (strcmp(argv[i], "--headless") == 0)
+            headless = true;
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+        {
+            if (sscanf(argv[++i], "%ux%u", &frameWidth, &frameHeight) != 2 || frameWidth == 0 || frameHeight == 0)
+            {
+                ERROR("--size expects WIDTHxHEIGHT, e.g. 1920x1080\n");
+                return EXIT_FAILURE;
+            }
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            headlessFrames = std::max(atoi(argv[++i]), 1);
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            outputPath = argv[++i];
+        else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+            capturePattern = argv[++i];
+        else if (strcmp(argv[i], "--capture-pipe") == 0 && i + 1 < argc)
+            captureCommand = argv[++i];
+        else if (strcmp(argv[i], "--poster") == 0 && i + 2 < argc)
+        {
+            if (sscanf(argv[++i], "%ux%u", &posterWidth, &posterHeight) != 2 || posterWidth == 0 || posterHeight == 0)
+            {
+                ERROR("--poster expects WIDTHxHEIGHT and a path, e.g. 32768x32768 poster.ppm\n");
+                return EXIT_FAILURE;
+            }
+            posterPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--tile-size") == 0 && i + 1 < argc)
+            posterTileSize = std::max(atoi(argv[++i]), 1);
+    }
+
+    //Benchmarks which do not need any window
+    if (argc > 1 && strcmp(argv[1], "--bench-meshes") == 0)
+    {
+        benchmarkSphereGenerators();
+        benchmarkMeshGenerators();
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-noise") == 0)
+    {
+        benchmarkPlanetNoise();
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-prepare") == 0)
+    {
+        benchmarkFramePreparation(ASTEROIDS);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-jobs") == 0)
+    {
+        benchmarkJobSystem();
+        return 0;
+    }
+
     ////////////////////////////////////////
     //SDL2 / OpenGL Context initialization : 
     ////////////////////////////////////////
 
-    //Initialize SDL2
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK) < 0)
+    //Initialize SDL2. Headless, only its events (there are none) and SDL2_image are used
+    if (SDL_Init(headless ? SDL_INIT_EVENTS : SDL_INIT_VIDEO | SDL_INIT_JOYSTICK) < 0)
     {
         ERROR("The initialization of the SDL failed : %s\n", SDL_GetError());
         return 0;
     }
 
-    //Create a Window
-    SDL_Window* window = SDL_CreateWindow("Systeme Solaire",                           //Titre
-        SDL_WINDOWPOS_UNDEFINED,               //X Position
-        SDL_WINDOWPOS_UNDEFINED,               //Y Position
-        WIDTH, HEIGHT,                         //Resolution
-        SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN); //Flags (OpenGL + Show)
-
-//Initialize OpenGL Version (version 3.0)
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
-
-    //Initialize the OpenGL Context (where OpenGL resources (Graphics card resources) lives)
-    SDL_GLContext context = SDL_GL_CreateContext(window);
-
-
+    WindowContext windowContext;
+    HeadlessContext headlessContext;
+    if (headless)
+    {
+        //Same version as the window : everything else is identical, the frame is only drawn in a framebuffer object
+        if (!headlessContext.create(3, 0))
+            return EXIT_FAILURE;
+    }
+    else
+    {
+        //Create a Window
+        windowContext.window = SDL_CreateWindow("Systeme Solaire",                           //Titre
+            SDL_WINDOWPOS_UNDEFINED,               //X Position
+            SDL_WINDOWPOS_UNDEFINED,               //Y Position
+            frameWidth, frameHeight,               //Resolution
+            SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN); //Flags (OpenGL + Show)
+
+        //Initialize OpenGL Version (version 3.0)
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
+
+        //Initialize the OpenGL Context (where OpenGL resources (Graphics card resources) lives)
+        windowContext.context = SDL_GL_CreateContext(windowContext.window);
+    }
 
-    //Tells GLEW to initialize the OpenGL function with this version
+    //Tells GLEW to initialize the OpenGL function with this version.
+    //A GLEW built for GLX loads the GL functions, then fails on the GLX ones without an X display : not needed headless
     glewExperimental = GL_TRUE;
-    glewInit();
+    GLenum glewStatus = glewInit();
+    if (glewStatus != GLEW_OK && !(headless && glewStatus == GLEW_ERROR_NO_GLX_DISPLAY))
+    {
+        ERROR("The initialization of GLEW failed : %s\n", (const char*)glewGetErrorString(glewStatus));
+        return EXIT_FAILURE;
+    }
 
 
     //Start using OpenGL to draw something on screen
-    glViewport(0, 0, WIDTH, HEIGHT); //Draw on ALL the screen
+    glViewport(0, 0, frameWidth, frameHeight); //Draw on ALL the screen
 
     //The OpenGL background color (RGBA, each component between 0.0f and 1.0f)
     glClearColor(0.0, 0.0, 0.0, 1.0); //Full Black
@@ -194,65 +952,52 @@ int main(int argc, char* argv[])
     }
 
     // Lire Texture CPU
-    SDL_Surface* img_soleil = IMG_Load("../Textures/2k_sun.png");
-    SDL_Surface* rgbImg_soleil = SDL_ConvertSurfaceFormat(img_soleil, SDL_PIXELFORMAT_RGBA32, 0);
-    SDL_FreeSurface(img_soleil);
+    SDL_Surface* rgbImg_soleil = load_surface("../Textures/2k_sun.png");
 
-    SDL_Surface* img_terre = IMG_Load("../Textures/8k_earth_daymap.png");
-    SDL_Surface* rgbImg_terre = SDL_ConvertSurfaceFormat(img_terre, SDL_PIXELFORMAT_RGBA32, 0);
-    SDL_FreeSurface(img_terre);
+    SDL_Surface* rgbImg_terre = load_surface("../Textures/8k_earth_daymap.png");
 
-    SDL_Surface* img_lune = IMG_Load("../Textures/8k_moon.png");
-    SDL_Surface* rgbImg_lune = SDL_ConvertSurfaceFormat(img_lune, SDL_PIXELFORMAT_RGBA32, 0);
-    SDL_FreeSurface(img_lune);
+    SDL_Surface* rgbImg_lune = load_surface("../Textures/8k_moon.png");
 
-    SDL_Surface* img_mercury = IMG_Load("../Textures/2k_mercury.png");
-    SDL_Surface* rgbImg_mercury = SDL_ConvertSurfaceFormat(img_mercury, SDL_PIXELFORMAT_RGBA32, 0);
-    SDL_FreeSurface(img_mercury);
+    SDL_Surface* rgbImg_mercury = load_surface("../Textures/2k_mercury.png");
 
     // POSSIBLE DE SUPERPOSEE 2 TEXTURES A VOIR..
-    SDL_Surface* img_venus = IMG_Load("../Textures/2k_venus_surface.png");
-    SDL_Surface* rgbImg_venus = SDL_ConvertSurfaceFormat(img_venus, SDL_PIXELFORMAT_RGBA32, 0);
-    SDL_FreeSurface(img_venus);
+    SDL_Surface* rgbImg_venus = load_surface("../Textures/2k_venus_surface.png");
 
-    SDL_Surface* img_jupiter = IMG_Load("../Textures/2k_jupiter.png");
-    SDL_Surface* rgbImg_jupiter = SDL_ConvertSurfaceFormat(img_jupiter, SDL_PIXELFORMAT_RGBA32, 0);
-    SDL_FreeSurface(img_jupiter);
+    SDL_Surface* rgbImg_jupiter = load_surface("../Textures/2k_jupiter.png");
 
     //POSSIBLE DE SUPERPOSEE 2 TEXTURES A VOIR..
-    SDL_Surface* img_saturne = IMG_Load("../Textures/2k_saturn.png");
-    SDL_Surface* rgbImg_saturne = SDL_ConvertSurfaceFormat(img_saturne, SDL_PIXELFORMAT_RGBA32, 0);
-    SDL_FreeSurface(img_saturne);
+    SDL_Surface* rgbImg_saturne = load_surface("../Textures/2k_saturn.png");
 
-    SDL_Surface* img_uranus = IMG_Load("../Textures/2k_uranus.png");
-    SDL_Surface* rgbImg_uranus = SDL_ConvertSurfaceFormat(img_uranus, SDL_PIXELFORMAT_RGBA32, 0);
-    SDL_FreeSurface(img_uranus);
+    SDL_Surface* rgbImg_uranus = load_surface("../Textures/2k_uranus.png");
 
-    SDL_Surface* img_neptune = IMG_Load("../Textures/2k_neptune.png");
-    SDL_Surface* rgbImg_neptune = SDL_ConvertSurfaceFormat(img_neptune, SDL_PIXELFORMAT_RGBA32, 0);
-    SDL_FreeSurface(img_neptune);
+    SDL_Surface* rgbImg_neptune = load_surface("../Textures/2k_neptune.png");
 
-    SDL_Surface* img_mars = IMG_Load("../Textures/2k_mars.png");
-    SDL_Surface* rgbImg_mars = SDL_ConvertSurfaceFormat(img_mars, SDL_PIXELFORMAT_RGBA32, 0);
-    SDL_FreeSurface(img_mars);
+    SDL_Surface* rgbImg_mars = load_surface("../Textures/2k_mars.png");
 
 
 
 
     // Cr�ation des plan�tes, g�n�ration VBO, Bind Texture
-    Sphere sphere(32, 32);
+    //Every body shares the same LOD chain (8x8 up to 256x256), optimized for the vertex cache
+    //The buffers come from the mesh cache : only the first run generates and optimizes the chain
+    MeshCache meshCache("cache");
+    CachedMesh sphereMesh;
+    meshCache.getOrCreate("LODSphere(8, 256)", VERTEX_FORMAT_COMPACT, []() {return LODSphere(8, 256, "cache");}, sphereMesh);
+    LODSphere lodSphere(8, 256, NULL, false);
+    lodSphere.setVertexFormat(VERTEX_FORMAT_COMPACT);
+    GLuint sphereVAO = generate_VAO(sphereMesh);
 
 
     Objet lune;
-    lune.VAO = generate_VAO(sphere);
-    lune.nbVertices = sphere.getNbVertices();
+    lune.VAO = sphereVAO;
+    lune.lod = &lodSphere;
     lune.Color = glm::vec3(0.5, 0.5, 0.5);
     lune.propagatedMatrix = glm::scale(lune.propagatedMatrix, glm::vec3(0.1, 0.1, 0.1));
     lune.propagatedMatrix = glm::translate(lune.propagatedMatrix, glm::vec3(8.0, 0.0, 0.0));
     glGenTextures(1, &lune.texture);
     glBindTexture(GL_TEXTURE_2D, lune.texture);
     {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -266,15 +1011,15 @@ int main(int argc, char* argv[])
     glBindTexture(GL_TEXTURE_2D, 0);
 
     Objet mercury;
-    mercury.VAO = generate_VAO(sphere);
-    mercury.nbVertices = sphere.getNbVertices();
+    mercury.VAO = sphereVAO;
+    mercury.lod = &lodSphere;
     mercury.Color = glm::vec3(0.0, 0.0, 1.0);
     mercury.propagatedMatrix = glm::scale(mercury.propagatedMatrix, glm::vec3(0.3, 0.3, 0.3));
     mercury.propagatedMatrix = glm::translate(mercury.propagatedMatrix, glm::vec3(3.0, 0.0, 0.0));
     glGenTextures(1, &mercury.texture);
     glBindTexture(GL_TEXTURE_2D, mercury.texture);
     {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
@@ -288,23 +1033,23 @@ int main(int argc, char* argv[])
     glBindTexture(GL_TEXTURE_2D, 0);
 
     Objet dad_mercury;
-    dad_mercury.VAO = generate_VAO(sphere);
-    dad_mercury.nbVertices = sphere.getNbVertices();
+    dad_mercury.VAO = sphereVAO;
+    dad_mercury.lod = &lodSphere;
     dad_mercury.Color = glm::vec3(1.0, 1.0, 0.0);
     dad_mercury.propagatedMatrix = glm::scale(dad_mercury.propagatedMatrix, glm::vec3(4.9, 4.9, 4.9));
     dad_mercury.children = { &mercury };
 
 
     Objet venus;
-    venus.VAO = generate_VAO(sphere);
-    venus.nbVertices = sphere.getNbVertices();
+    venus.VAO = sphereVAO;
+    venus.lod = &lodSphere;
     venus.Color = glm::vec3(0.0, 0.0, 1.0);
     venus.propagatedMatrix = glm::scale(venus.propagatedMatrix, glm::vec3(0.9, 0.9, 0.9));
     venus.propagatedMatrix = glm::translate(venus.propagatedMatrix, glm::vec3(1.95, 0.0, 0.0));
     glGenTextures(1, &venus.texture);
     glBindTexture(GL_TEXTURE_2D, venus.texture);
     {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
@@ -318,16 +1063,16 @@ int main(int argc, char* argv[])
     glBindTexture(GL_TEXTURE_2D, 0);
 
     Objet dad_venus;
-    dad_venus.VAO = generate_VAO(sphere);
-    dad_venus.nbVertices = sphere.getNbVertices();
+    dad_venus.VAO = sphereVAO;
+    dad_venus.lod = &lodSphere;
     dad_venus.Color = glm::vec3(1.0, 1.0, 0.0);
     dad_venus.propagatedMatrix = glm::scale(dad_venus.propagatedMatrix, glm::vec3(4.9, 4.9, 4.9));
     dad_venus.children = { &venus };
 
 
     Objet terre;
-    terre.VAO = generate_VAO(sphere);
-    terre.nbVertices = sphere.getNbVertices();
+    terre.VAO = sphereVAO;
+    terre.lod = &lodSphere;
     terre.Color = glm::vec3(0.0, 0.0, 1.0);
     terre.propagatedMatrix = glm::scale(terre.propagatedMatrix, glm::vec3(0.9, 0.9, 0.9));
     terre.propagatedMatrix = glm::translate(terre.propagatedMatrix, glm::vec3(3.5, 0.0, 0.0));
@@ -335,7 +1080,7 @@ int main(int argc, char* argv[])
     glGenTextures(1, &terre.texture);
     glBindTexture(GL_TEXTURE_2D, terre.texture);
     {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
@@ -349,22 +1094,22 @@ int main(int argc, char* argv[])
     glBindTexture(GL_TEXTURE_2D, 0);
 
     Objet dad_terre;
-    dad_terre.VAO = generate_VAO(sphere);
-    dad_terre.nbVertices = sphere.getNbVertices();
+    dad_terre.VAO = sphereVAO;
+    dad_terre.lod = &lodSphere;
     terre.Color = glm::vec3(1.0, 1.0, 0.0);
     dad_terre.propagatedMatrix = glm::scale(dad_terre.propagatedMatrix, glm::vec3(4.9, 4.9, 4.9));
     dad_terre.children = { &terre };
 
     Objet mars;
-    mars.VAO = generate_VAO(sphere);
-    mars.nbVertices = sphere.getNbVertices();
+    mars.VAO = sphereVAO;
+    mars.lod = &lodSphere;
     mars.Color = glm::vec3(0.0, 0.0, 1.0);
     mars.propagatedMatrix = glm::scale(mars.propagatedMatrix, glm::vec3(0.4, 0.4, 0.4));
     mars.propagatedMatrix = glm::translate(mars.propagatedMatrix, glm::vec3(10.5, 0.0, 0.0));
     glGenTextures(1, &mars.texture);
     glBindTexture(GL_TEXTURE_2D, mars.texture);
     {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
@@ -378,22 +1123,22 @@ int main(int argc, char* argv[])
     glBindTexture(GL_TEXTURE_2D, 0);
 
     Objet dad_mars;
-    dad_mars.VAO = generate_VAO(sphere);
-    dad_mars.nbVertices = sphere.getNbVertices();
+    dad_mars.VAO = sphereVAO;
+    dad_mars.lod = &lodSphere;
     dad_mars.Color = glm::vec3(1.0, 1.0, 0.0);
     dad_mars.propagatedMatrix = glm::scale(dad_mars.propagatedMatrix, glm::vec3(4.9, 4.9, 4.9));
     dad_mars.children = { &mars };
 
     Objet jupiter;
-    jupiter.VAO = generate_VAO(sphere);
-    jupiter.nbVertices = sphere.getNbVertices();
+    jupiter.VAO = sphereVAO;
+    jupiter.lod = &lodSphere;
     jupiter.Color = glm::vec3(0.0, 0.0, 1.0);
     jupiter.propagatedMatrix = glm::scale(jupiter.propagatedMatrix, glm::vec3(2.0, 2.0, 2.0));
     jupiter.propagatedMatrix = glm::translate(jupiter.propagatedMatrix, glm::vec3(3.0, 0.0, 0.0));
     glGenTextures(1, &jupiter.texture);
     glBindTexture(GL_TEXTURE_2D, jupiter.texture);
     {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
@@ -407,22 +1152,22 @@ int main(int argc, char* argv[])
     glBindTexture(GL_TEXTURE_2D, 0);
 
     Objet dad_jupiter;
-    dad_jupiter.VAO = generate_VAO(sphere);
-    dad_jupiter.nbVertices = sphere.getNbVertices();
+    dad_jupiter.VAO = sphereVAO;
+    dad_jupiter.lod = &lodSphere;
     dad_jupiter.Color = glm::vec3(1.0, 1.0, 0.0);
     dad_jupiter.propagatedMatrix = glm::scale(dad_jupiter.propagatedMatrix, glm::vec3(4.9, 4.9, 4.9));
     dad_jupiter.children = { &jupiter };
 
     Objet saturne;
-    saturne.VAO = generate_VAO(sphere);
-    saturne.nbVertices = sphere.getNbVertices();
+    saturne.VAO = sphereVAO;
+    saturne.lod = &lodSphere;
     saturne.Color = glm::vec3(0.0, 0.0, 1.0);
     saturne.propagatedMatrix = glm::scale(saturne.propagatedMatrix, glm::vec3(1.7, 1.7, 1.7));
     saturne.propagatedMatrix = glm::translate(saturne.propagatedMatrix, glm::vec3(5.0, 0.0, 0.0));
     glGenTextures(1, &saturne.texture);
     glBindTexture(GL_TEXTURE_2D, saturne.texture);
     {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
@@ -435,22 +1180,22 @@ int main(int argc, char* argv[])
     }
 
     Objet dad_saturne;
-    dad_saturne.VAO = generate_VAO(sphere);
-    dad_saturne.nbVertices = sphere.getNbVertices();
+    dad_saturne.VAO = sphereVAO;
+    dad_saturne.lod = &lodSphere;
     dad_saturne.Color = glm::vec3(1.0, 1.0, 0.0);
     dad_saturne.propagatedMatrix = glm::scale(dad_saturne.propagatedMatrix, glm::vec3(4.9, 4.9, 4.9));
     dad_saturne.children = { &saturne };
 
     Objet uranus;
-    uranus.VAO = generate_VAO(sphere);
-    uranus.nbVertices = sphere.getNbVertices();
+    uranus.VAO = sphereVAO;
+    uranus.lod = &lodSphere;
     uranus.Color = glm::vec3(0.0, 0.0, 1.0);
     uranus.propagatedMatrix = glm::scale(uranus.propagatedMatrix, glm::vec3(1.2, 1.2, 1.2));
     uranus.propagatedMatrix = glm::translate(uranus.propagatedMatrix, glm::vec3(9.0, 0.0, 0.0));
     glGenTextures(1, &uranus.texture);
     glBindTexture(GL_TEXTURE_2D, uranus.texture);
     {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
@@ -464,23 +1209,23 @@ int main(int argc, char* argv[])
     glBindTexture(GL_TEXTURE_2D, 0);
 
     Objet dad_uranus;
-    dad_uranus.VAO = generate_VAO(sphere);
-    dad_uranus.nbVertices = sphere.getNbVertices();
+    dad_uranus.VAO = sphereVAO;
+    dad_uranus.lod = &lodSphere;
     dad_uranus.Color = glm::vec3(1.0, 1.0, 0.0);
     dad_uranus.propagatedMatrix = glm::scale(dad_uranus.propagatedMatrix, glm::vec3(4.9, 4.9, 4.9));
     dad_uranus.children = { &uranus };
 
 
     Objet neptune;
-    neptune.VAO = generate_VAO(sphere);
-    neptune.nbVertices = sphere.getNbVertices();
+    neptune.VAO = sphereVAO;
+    neptune.lod = &lodSphere;
     neptune.Color = glm::vec3(0.0, 0.0, 1.0);
     neptune.propagatedMatrix = glm::scale(neptune.propagatedMatrix, glm::vec3(1.2, 1.2, 1.2));
     neptune.propagatedMatrix = glm::translate(neptune.propagatedMatrix, glm::vec3(11.0, 0.0, 0.0));
     glGenTextures(1, &neptune.texture);
     glBindTexture(GL_TEXTURE_2D, neptune.texture);
     {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
@@ -494,21 +1239,21 @@ int main(int argc, char* argv[])
     glBindTexture(GL_TEXTURE_2D, 0);
 
     Objet dad_neptune;
-    dad_neptune.VAO = generate_VAO(sphere);
-    dad_neptune.nbVertices = sphere.getNbVertices();
+    dad_neptune.VAO = sphereVAO;
+    dad_neptune.lod = &lodSphere;
     dad_neptune.Color = glm::vec3(1.0, 1.0, 0.0);
     dad_neptune.propagatedMatrix = glm::scale(dad_neptune.propagatedMatrix, glm::vec3(4.9, 4.9, 4.9));
     dad_neptune.children = { &neptune };
 
     Objet soleil;
-    soleil.VAO = generate_VAO(sphere);
-    soleil.nbVertices = sphere.getNbVertices();
+    soleil.VAO = sphereVAO;
+    soleil.lod = &lodSphere;
     soleil.propagatedMatrix = glm::scale(soleil.propagatedMatrix, glm::vec3(5.0, 5.0, 5.0));
 
     glGenTextures(1, &soleil.texture);
     glBindTexture(GL_TEXTURE_2D, soleil.texture);
     {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -525,8 +1270,9 @@ int main(int argc, char* argv[])
 
     FILE* vertFile = fopen("Shaders/color.vert", "r");
     FILE* fragFile = fopen("Shaders/color.frag", "r");
+    FILE* phongFile = fopen("Shaders/phong.glsl", "r");
 
-    Shader* shader = Shader::loadFromFiles(vertFile, fragFile);
+    Shader* shader = Shader::loadFromFiles(vertFile, fragFile, phongFile);
 
     fclose(vertFile);
     fclose(fragFile);
@@ -536,6 +1282,360 @@ int main(int argc, char* argv[])
         return EXIT_FAILURE;
     }
 
+    //Impostors : the spheres ray-cast on a quad, with the same lighting
+    FILE* impostorVertFile = fopen("Shaders/impostor.vert", "r");
+    FILE* impostorFragFile = fopen("Shaders/impostor.frag", "r");
+
+    Shader* impostorShader = Shader::loadFromFiles(impostorVertFile, impostorFragFile, phongFile);
+
+    fclose(impostorVertFile);
+    fclose(impostorFragFile);
+
+    if (impostorShader == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+
+    //Terrain : the rocky bodies as quadtrees of chunks, for close-up flights
+    FILE* terrainVertFile = fopen("Shaders/terrain.vert", "r");
+    FILE* terrainFragFile = fopen("Shaders/terrain.frag", "r");
+
+    Shader* terrainShader = Shader::loadFromFiles(terrainVertFile, terrainFragFile, phongFile);
+
+    fclose(terrainVertFile);
+    fclose(terrainFragFile);
+
+    //Tessellation : the spheres refined on the GPU. It needs GL 4.0, without it the spheres keep the LOD chain
+    Shader* tessellationShader = NULL;
+    if (Shader::isTessellationSupported())
+    {
+        FILE* tessVertFile = fopen("Shaders/color.vert", "r");
+        FILE* tessControlFile = fopen("Shaders/color.tesc", "r");
+        FILE* tessEvalFile = fopen("Shaders/color.tese", "r");
+        FILE* tessFragFile = fopen("Shaders/color.frag", "r");
+
+        tessellationShader = Shader::loadFromFiles(tessVertFile, tessControlFile, tessEvalFile, tessFragFile, phongFile);
+
+        fclose(tessVertFile);
+        fclose(tessControlFile);
+        fclose(tessEvalFile);
+        fclose(tessFragFile);
+
+        if (tessellationShader == NULL)
+            WARNING("The tessellation shader could not be built, the spheres keep the LOD chain\n");
+    }
+    else
+        INFO("No tessellation on this context (OpenGL %s), the spheres keep the LOD chain\n", (const char*)glGetString(GL_VERSION));
+
+    //Vertex pulling : the meshes in shader storage buffers, decoded by the vertex shader. It needs GL 4.3, without it the spheres keep their VAO
+    Shader* pullingShader = NULL;
+    VertexPuller* puller = NULL;
+    int pulledSphere = -1;
+    if (VertexPuller::isSupported())
+    {
+        FILE* pullingVertFile = fopen("Shaders/pulling.vert", "r");
+        FILE* pullingFragFile = fopen("Shaders/color.frag", "r");
+
+        pullingShader = Shader::loadFromFiles(pullingVertFile, pullingFragFile, phongFile);
+
+        fclose(pullingVertFile);
+        fclose(pullingFragFile);
+
+        puller = new VertexPuller();
+        pulledSphere = puller->addMesh(sphereMesh);
+        if (pullingShader == NULL || pulledSphere < 0 || !puller->upload())
+        {
+            WARNING("Vertex pulling could not be set up, the spheres keep their VAO\n");
+            delete puller;
+            puller = NULL;
+            pulledSphere = -1;
+        }
+    }
+    else
+        INFO("No vertex pulling on this context (OpenGL %s), the spheres keep their VAO\n", (const char*)glGetString(GL_VERSION));
+
+    //Batching : every mesh in one buffer and the whole scene in one multi-draw. It needs GL 3.2 (and GL 4.3 for the multi-draw, else one draw per body)
+    Objet* texturedBodies[] = { &soleil, &mercury, &venus, &terre, &lune, &mars, &jupiter, &saturne, &uranus, &neptune };
+    SDL_Surface* bodyTextures[] = { rgbImg_soleil, rgbImg_mercury, rgbImg_venus, rgbImg_terre, rgbImg_lune, rgbImg_mars, rgbImg_jupiter, rgbImg_saturne, rgbImg_uranus, rgbImg_neptune };
+    SceneBatch* sceneBatch = NULL;
+    if (MeshBuffer::isSupported())
+    {
+        FILE* sceneVertFile = fopen("Shaders/scene.vert", "r");
+        FILE* sceneFragFile = fopen("Shaders/scene.frag", "r");
+
+        Shader* sceneShader = Shader::loadFromFiles(sceneVertFile, sceneFragFile, phongFile);
+
+        fclose(sceneVertFile);
+        fclose(sceneFragFile);
+
+        if (sceneShader == NULL)
+            WARNING("The batching shader could not be built, the bodies keep one draw call each\n");
+        else
+        {
+            sceneBatch = new SceneBatch();
+            sceneBatch->shader = sceneShader;
+            sceneBatch->meshes = new MeshBuffer(sphereMesh.getLayout(), sphereMesh.getNbVertices(), sphereMesh.getNbIndices());
+            sceneBatch->sphere = sceneBatch->meshes->addMesh(sphereMesh);
+
+            uint32_t nbLayers = sizeof(texturedBodies) / sizeof(texturedBodies[0]);
+            for (uint32_t i = 0; i < nbLayers; i++)
+                texturedBodies[i]->textureLayer = i;
+            sceneBatch->textures = generate_textureArray(bodyTextures, nbLayers, 2048, 1024);
+
+            sceneBatch->drawDataStream = new StreamBuffer(256 * DRAW_DATA_TEXELS * sizeof(glm::vec4));
+            glGenTextures(1, &sceneBatch->drawDataTexture);
+
+            INFO("Batched draws go out %s\n", MeshBuffer::isMultiDrawSupported() ? "in one glMultiDrawElementsIndirect" : "in a loop of glDrawElementsBaseVertex");
+            if (StreamBuffer::isPersistentSupported())
+                INFO("Per frame data persistently mapped, %d frames in flight\n", STREAM_BUFFER_FRAMES);
+            else
+                INFO("Per frame data in buffers orphaned each frame (no GL 4.4 or ARB_buffer_storage)\n");
+        }
+    }
+    else
+        INFO("No batching on this context (OpenGL %s), the bodies keep one draw call each\n", (const char*)glGetString(GL_VERSION));
+
+    //The asteroid belt lies between the orbits of Mars and Jupiter
+    float innerOrbit = glm::length(glm::vec3((dad_mars.propagatedMatrix * mars.propagatedMatrix)[3]));
+    float outerOrbit = glm::length(glm::vec3((dad_jupiter.propagatedMatrix * jupiter.propagatedMatrix)[3]));
+    std::vector<glm::mat4> asteroidBelt = generate_asteroidBelt(ASTEROIDS, innerOrbit, outerOrbit);
+    glm::mat4 beltMatrix(1.0f);
+    if (sceneBatch != NULL)
+    {
+        sceneBatch->constants = soleil.Constants;
+        sceneBatch->alpha = soleil.Alpha;
+    }
+
+    //GPU driven drawing : culling and level of detail in compute shaders, for the bodies and an asteroid belt. It needs GL 4.3 and the batch resources
+    GpuCuller* gpuCuller = NULL;
+    Shader* gpuDrivenShader = NULL;
+    if (sceneBatch != NULL && GpuCuller::isSupported() && Shader::isComputeSupported())
+    {
+        FILE* cullFile = fopen("Shaders/cull.comp", "r");
+        FILE* hizFile = fopen("Shaders/hiz.comp", "r");
+        FILE* gpuDrivenVertFile = fopen("Shaders/gpudriven.vert", "r");
+        FILE* gpuDrivenFragFile = fopen("Shaders/scene.frag", "r");
+
+        Shader* cullShader = Shader::loadComputeFromFile(cullFile);
+        Shader* hizShader = Shader::loadComputeFromFile(hizFile);
+        gpuDrivenShader = Shader::loadFromFiles(gpuDrivenVertFile, gpuDrivenFragFile, phongFile);
+
+        fclose(cullFile);
+        fclose(hizFile);
+        fclose(gpuDrivenVertFile);
+        fclose(gpuDrivenFragFile);
+
+        if (cullShader == NULL || hizShader == NULL || gpuDrivenShader == NULL)
+            WARNING("The GPU culling shaders could not be built, the bodies stay culled on the CPU\n");
+        else
+        {
+            Objet* roots[] = { &soleil, &dad_mercury, &dad_venus, &dad_terre, &dad_mars, &dad_jupiter, &dad_saturne, &dad_uranus, &dad_neptune };
+            std::vector<Objet*> bodies(roots, roots + sizeof(roots) / sizeof(roots[0]));
+            for (uint32_t i = 0; i < bodies.size(); i++)
+                bodies.insert(bodies.end(), bodies[i]->children.begin(), bodies[i]->children.end());
+
+            gpuCuller = new GpuCuller(cullShader, hizShader, *sceneBatch->meshes, sceneBatch->sphere, lodSphere, bodies.size() + ASTEROIDS, frameWidth, frameHeight);
+            for (Objet* body : bodies)
+                body->gpuBody = gpuCuller->addBody(glm::mat4(1.0f), body->textureLayer);
+
+            //Static here : their records are uploaded once
+            for (uint32_t i = 0; i < ASTEROIDS; i++)
+                gpuCuller->addBody(asteroidBelt[i], lune.textureLayer);
+            INFO("GPU culling available for %u bodies (%u asteroids)\n", gpuCuller->getNbBodies(), ASTEROIDS);
+        }
+    }
+    else
+        INFO("No GPU culling on this context (OpenGL %s), the bodies stay culled on the CPU\n", (const char*)glGetString(GL_VERSION));
+
+    //Multithreaded preparation of the batch : the scene graph flattened, the asteroid belt turning as one node
+    FrameBuilder* frameBuilder = NULL;
+    int32_t beltNode = -1;
+    if (sceneBatch != NULL)
+    {
+        frameBuilder = new FrameBuilder(lodSphere, sceneBatch->meshes->getMesh(sceneBatch->sphere));
+        Objet* roots[] = { &soleil, &dad_mercury, &dad_venus, &dad_terre, &dad_mars, &dad_jupiter, &dad_saturne, &dad_uranus, &dad_neptune };
+        for (Objet* root : roots)
+            add_frameNodes(*frameBuilder, *root, -1);
+
+        FrameNode belt;
+        belt.drawn = false;
+        beltNode = frameBuilder->addNode(belt);
+        for (uint32_t i = 0; i < ASTEROIDS; i++)
+        {
+            FrameNode asteroid;
+            asteroid.parent = beltNode;
+            asteroid.propagatedMatrix = asteroidBelt[i];
+            asteroid.textureLayer = lune.textureLayer;
+            frameBuilder->addNode(asteroid);
+        }
+    }
+    fclose(phongFile);
+
+    if (terrainShader == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+
+    //Procedural relief of each rocky body : one seed per body, so every run flies over the same mountains.
+    //Declared before the terrain : they are destroyed after it, once its selection jobs are done
+    std::vector<std::unique_ptr<PlanetNoise>> reliefs;
+    PlanetTerrain planetTerrain;
+    Objet* rockyBodies[] = { &mercury, &venus, &terre, &lune, &mars };
+    float ridgedMix[] = { 0.3f, 0.2f, 0.5f, 0.7f, 0.6f };
+    for (uint32_t i = 0; i < sizeof(rockyBodies) / sizeof(rockyBodies[0]); i++)
+    {
+        PlanetNoiseParams params;
+        params.seed      = i + 1;
+        params.octaves   = 10;
+        params.ridged    = ridgedMix[i];
+        params.amplitude = 0.005f;
+        reliefs.push_back(std::unique_ptr<PlanetNoise>(new PlanetNoise(params, planetTerrain.getGridSize() + 1)));
+        rockyBodies[i]->terrainBody = planetTerrain.addBody(reliefs.back().get());
+        if (tessellationShader != NULL)
+            rockyBodies[i]->heightMap = generate_heightMap(*reliefs.back(), 1024, 512);
+    }
+
+    GLuint emptyVAO;
+    glGenVertexArrays(1, &emptyVAO);
+
+    //Occlusion culling : the coarsest level of the chain as proxy, scaled up so that it encloses the finer ones
+    FILE* occlusionVertFile = fopen("Shaders/occlusion.vert", "r");
+    FILE* occlusionFragFile = fopen("Shaders/occlusion.frag", "r");
+
+    Shader* occlusionShader = Shader::loadFromFiles(occlusionVertFile, occlusionFragFile);
+
+    fclose(occlusionVertFile);
+    fclose(occlusionFragFile);
+
+    if (occlusionShader == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+
+    const LODRange& proxy = lodSphere.getLevel(0);
+    OcclusionCuller culler(occlusionShader, sphereVAO, proxy.firstIndex, proxy.nbIndices, 1.15f);
+
+    //Depth pre-pass : the proxy shader only writes depth, the chain gets a position only stream
+    GLuint lodPositionVAO = generate_positionVAO(sphereMesh.getLayout(), sphereMesh.getVertexData(), sphereMesh.getNbVertices(), sphereVAO);
+
+    //Overdraw : a full screen triangle counts the covered pixels
+    FILE* coverageVertFile = fopen("Shaders/coverage.vert", "r");
+    FILE* coverageFragFile = fopen("Shaders/occlusion.frag", "r");
+
+    Shader* coverageShader = Shader::loadFromFiles(coverageVertFile, coverageFragFile);
+
+    fclose(coverageVertFile);
+    fclose(coverageFragFile);
+
+    if (coverageShader == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+    OverdrawCounter overdrawCounter(coverageShader, emptyVAO);
+
+    RenderContext renderContext;
+    renderContext.shader         = shader;
+    renderContext.impostorShader = impostorShader;
+    renderContext.emptyVAO       = emptyVAO;
+    renderContext.culler         = &culler;
+    renderContext.terrain        = &planetTerrain;
+    renderContext.terrainShader  = terrainShader;
+    renderContext.tessellationShader = tessellationShader;
+    renderContext.puller         = puller;
+    renderContext.pullingShader  = pullingShader;
+    renderContext.pulledSphere   = pulledSphere;
+    renderContext.batch          = sceneBatch;
+    renderContext.gpuCuller      = gpuCuller;
+    renderContext.gpuDrivenShader = gpuDrivenShader;
+    renderContext.frameBuilder   = frameBuilder;
+    renderContext.depthShader    = occlusionShader;
+    renderContext.lodPositionVAO = lodPositionVAO;
+    renderContext.width          = frameWidth;
+    renderContext.height         = frameHeight;
+
+    //--bench-tessellation : the same number of frames drawn with the LOD chain, then with the tessellation, timed on the GPU
+    bool benchmarkTessellation = argc > 1 && strcmp(argv[1], "--bench-tessellation") == 0;
+    //--bench-overdraw : the same number of frames in hierarchy order, front to back, then with the depth pre-pass, the fragments of each pass counted.
+    //The occlusion culler counts samples too and GL does not nest two such queries : it is off meanwhile
+    bool benchmarkOverdraw = argc > 1 && strcmp(argv[1], "--bench-overdraw") == 0;
+    const char* overdrawModes[] = { "Hierarchy order", "Front to back", "Depth pre-pass" };
+    if (benchmarkOverdraw)
+    {
+        culler.setEnabled(false);
+        renderContext.overdraw = &overdrawCounter;
+    }
+    uint32_t benchmarkFrame = 0;
+    double benchmarkCpuMs = 0.0;
+    GpuTimer gpuTimer;
+
+    //Quality governor : trades resolution, levels of detail, texture sharpness and the costly modes for the frame budget.
+    //Below the full resolution the frame is drawn in sceneTarget, then upscaled to the window. The benchmarks keep the full quality
+    QualityGovernor governor(TIME_PER_FRAME_MS);
+    governor.setEnabled(!benchmarkTessellation && !benchmarkOverdraw && !headless);
+    Framebuffer sceneTarget;
+    uint32_t nbTexturedBodies = sizeof(texturedBodies) / sizeof(texturedBodies[0]);
+    GLuint bodyTextureArray = sceneBatch != NULL ? sceneBatch->textures : 0;
+    uint32_t textureBiasLevel = 0;  //The level whose texture bias the textures have : the one of the finest level when created
+
+    //Render on demand : while the simulation is paused and nothing moves, the loop sleeps until an event instead of drawing the same frame.
+    //Nothing is drawn while the window is hidden. The time warp scales the animation steps
+    bool onDemand = !benchmarkTessellation && !benchmarkOverdraw && !headless;
+    bool paused = false;
+    float timeWarp = 1.0f;
+    bool windowHidden = false;
+    uint32_t settleFrames = IDLE_SETTLE_FRAMES;
+    FrameStats frameStats;
+    bool reportStats = false;
+    uint32_t headlessFrame = 0;
+
+    //Recording : every frame drawn is one step of the animation, so the recording is the same however long each frame takes.
+    //The quality governor would make it depend on the timings : it is off while recording
+    FrameCapture frameCapture;
+    bool captureAtStart = capturePattern != NULL || captureCommand != NULL;
+    if (capturePattern == NULL)
+        capturePattern = "capture_%05u.qoi";
+    if (captureAtStart)
+    {
+        governor.setEnabled(false);
+        bool started = captureCommand != NULL ? frameCapture.startPipe(captureCommand, frameWidth, frameHeight) : frameCapture.startSequence(capturePattern, frameWidth, frameHeight);
+        if (!started)
+            return EXIT_FAILURE;
+    }
+
+    //Posters : the scene drawn again at any resolution, a tile at a time, each tile streamed to the file once drawn
+    TiledRenderer tiledRenderer;
+    bool posterPending = posterPath != NULL;
+    if (posterPath == NULL)
+        posterPath = "poster.ppm";
+
+    //The scene seen through a projection : once per frame, or once per tile of a poster
+    auto drawScene = [&](const glm::mat4& View, const glm::mat4& Projection, uint32_t viewportHeight)
+    {
+        std::stack<glm::mat4> modelstack;
+        modelstack.push(glm::mat4(1.0f));
+        Light light;
+
+        Draw(modelstack, View, Projection, renderContext, soleil, light);
+        Draw(modelstack, View, Projection, renderContext, dad_mercury, light);
+        Draw(modelstack, View, Projection, renderContext, dad_terre, light);
+        Draw(modelstack, View, Projection, renderContext, dad_venus, light);
+        Draw(modelstack, View, Projection, renderContext, dad_mars, light);
+        Draw(modelstack, View, Projection, renderContext, dad_jupiter, light);
+        Draw(modelstack, View, Projection, renderContext, dad_saturne, light);
+        Draw(modelstack, View, Projection, renderContext, dad_uranus, light);
+        Draw(modelstack, View, Projection, renderContext, dad_neptune, light);
+        DrawOpaques(View, Projection, renderContext, light);
+        if (renderContext.prepared)
+        {
+            frameBuilder->setNode(beltNode, beltMatrix, glm::mat4(1.0f));
+            frameBuilder->build(View, Projection, viewportHeight, sceneBatch->commands, sceneBatch->drawData);
+        }
+        if (sceneBatch != NULL)
+            DrawBatch(View, Projection, renderContext, light);
+        if (renderContext.gpuDriven)
+            DrawGpuDriven(View, Projection, renderContext, light);
+    };
+
 
     bool isOpened = true;
     float t = 0.0f;
@@ -559,32 +1659,47 @@ int main(int argc, char* argv[])
     //Main application loop
     while (isOpened)
     {
+        //Idle : wait without taking the event, the poll below handles it
+        if (windowHidden || (onDemand && settleFrames == 0))
+        {
+            std::chrono::high_resolution_clock::time_point idleStart = std::chrono::high_resolution_clock::now();
+            if (windowHidden)
+                SDL_WaitEvent(NULL);
+            else
+                SDL_WaitEventTimeout(NULL, IDLE_TIMEOUT_MS);
+            frameStats.add(FRAME_STAGE_IDLE, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - idleStart).count());
+        }
+        std::chrono::high_resolution_clock::time_point eventsStart = std::chrono::high_resolution_clock::now();
+
+        //Steps of the animation, scaled by the time warp
+        float step = paused || windowHidden ? 0.0f : timeWarp;
 
         // -------- ANIMATION PLANETE --------
        // LUNE --------
-        lune.localMatrix = glm::rotate(lune.localMatrix, glm::radians(10.0f), glm::vec3(1.0, 1.0, 1.0));
+        lune.localMatrix = glm::rotate(lune.localMatrix, glm::radians(10.0f * step), glm::vec3(1.0, 1.0, 1.0));
 
         // Les dad_PLANETE
-        dad_terre.propagatedMatrix = glm::rotate(dad_terre.propagatedMatrix, glm::radians(0.62f), glm::vec3(0.0, 1.0, 0.0));
-        dad_mercury.propagatedMatrix = glm::rotate(dad_mercury.propagatedMatrix, glm::radians(1.0f), glm::vec3(0.0, 1.0, 0.0));
-        dad_venus.propagatedMatrix = glm::rotate(dad_venus.propagatedMatrix, glm::radians(0.73f), glm::vec3(0.0, 1.0, 0.0));
-        dad_mars.propagatedMatrix = glm::rotate(dad_mars.propagatedMatrix, glm::radians(0.5f), glm::vec3(0.0, 1.0, 0.0));
-        dad_jupiter.propagatedMatrix = glm::rotate(dad_jupiter.propagatedMatrix, glm::radians(0.27f), glm::vec3(0.0, 1.0, 0.0));
-        dad_saturne.propagatedMatrix = glm::rotate(dad_saturne.propagatedMatrix, glm::radians(0.20f), glm::vec3(0.0, 1.0, 0.0));
-        dad_uranus.propagatedMatrix = glm::rotate(dad_uranus.propagatedMatrix, glm::radians(0.14f), glm::vec3(0.0, 1.0, 0.0));
-        dad_neptune.propagatedMatrix = glm::rotate(dad_neptune.propagatedMatrix, glm::radians(0.11f), glm::vec3(0.0, 1.0, 0.0));
-        terre.propagatedMatrix = glm::rotate(terre.propagatedMatrix, glm::radians(1.62f), glm::vec3(0.0, 1.0, 0.0));
-
-        lune.localMatrix = glm::rotate(lune.localMatrix, glm::radians(0.041f), glm::vec3(1.0, 1.0, 1.0));
-        terre.localMatrix = glm::rotate(terre.localMatrix, glm::radians(0.041f), glm::vec3(1.0, 1.0, 1.0));
-        soleil.localMatrix = glm::rotate(soleil.localMatrix, glm::radians(1.02f), glm::vec3(1.0, 1.0, 1.0));
-        mercury.localMatrix = glm::rotate(mercury.localMatrix, glm::radians(2.386f), glm::vec3(1.0, 1.0, 1.0));
-        venus.localMatrix = glm::rotate(venus.localMatrix, glm::radians(10.0f), glm::vec3(1.0, 1.0, 1.0));
-        mars.localMatrix = glm::rotate(mars.localMatrix, glm::radians(0.041f), glm::vec3(1.0, 1.0, 1.0));
-        jupiter.localMatrix = glm::rotate(jupiter.localMatrix, glm::radians(0.015f), glm::vec3(1.0, 1.0, 1.0));
-        saturne.localMatrix = glm::rotate(saturne.localMatrix, glm::radians(0.017f), glm::vec3(1.0, 1.0, 1.0));
-        uranus.localMatrix = glm::rotate(uranus.localMatrix, glm::radians(0.0257f), glm::vec3(1.0, 1.0, 1.0));
-        neptune.localMatrix = glm::rotate(neptune.localMatrix, glm::radians(0.030f), glm::vec3(1.0, 1.0, 1.0));
+        dad_terre.propagatedMatrix = glm::rotate(dad_terre.propagatedMatrix, glm::radians(0.62f * step), glm::vec3(0.0, 1.0, 0.0));
+        dad_mercury.propagatedMatrix = glm::rotate(dad_mercury.propagatedMatrix, glm::radians(1.0f * step), glm::vec3(0.0, 1.0, 0.0));
+        dad_venus.propagatedMatrix = glm::rotate(dad_venus.propagatedMatrix, glm::radians(0.73f * step), glm::vec3(0.0, 1.0, 0.0));
+        dad_mars.propagatedMatrix = glm::rotate(dad_mars.propagatedMatrix, glm::radians(0.5f * step), glm::vec3(0.0, 1.0, 0.0));
+        dad_jupiter.propagatedMatrix = glm::rotate(dad_jupiter.propagatedMatrix, glm::radians(0.27f * step), glm::vec3(0.0, 1.0, 0.0));
+        dad_saturne.propagatedMatrix = glm::rotate(dad_saturne.propagatedMatrix, glm::radians(0.20f * step), glm::vec3(0.0, 1.0, 0.0));
+        dad_uranus.propagatedMatrix = glm::rotate(dad_uranus.propagatedMatrix, glm::radians(0.14f * step), glm::vec3(0.0, 1.0, 0.0));
+        dad_neptune.propagatedMatrix = glm::rotate(dad_neptune.propagatedMatrix, glm::radians(0.11f * step), glm::vec3(0.0, 1.0, 0.0));
+        terre.propagatedMatrix = glm::rotate(terre.propagatedMatrix, glm::radians(1.62f * step), glm::vec3(0.0, 1.0, 0.0));
+        beltMatrix = glm::rotate(beltMatrix, glm::radians(0.05f * step), glm::vec3(0.0, 1.0, 0.0));
+
+        lune.localMatrix = glm::rotate(lune.localMatrix, glm::radians(0.041f * step), glm::vec3(1.0, 1.0, 1.0));
+        terre.localMatrix = glm::rotate(terre.localMatrix, glm::radians(0.041f * step), glm::vec3(1.0, 1.0, 1.0));
+        soleil.localMatrix = glm::rotate(soleil.localMatrix, glm::radians(1.02f * step), glm::vec3(1.0, 1.0, 1.0));
+        mercury.localMatrix = glm::rotate(mercury.localMatrix, glm::radians(2.386f * step), glm::vec3(1.0, 1.0, 1.0));
+        venus.localMatrix = glm::rotate(venus.localMatrix, glm::radians(10.0f * step), glm::vec3(1.0, 1.0, 1.0));
+        mars.localMatrix = glm::rotate(mars.localMatrix, glm::radians(0.041f * step), glm::vec3(1.0, 1.0, 1.0));
+        jupiter.localMatrix = glm::rotate(jupiter.localMatrix, glm::radians(0.015f * step), glm::vec3(1.0, 1.0, 1.0));
+        saturne.localMatrix = glm::rotate(saturne.localMatrix, glm::radians(0.017f * step), glm::vec3(1.0, 1.0, 1.0));
+        uranus.localMatrix = glm::rotate(uranus.localMatrix, glm::radians(0.0257f * step), glm::vec3(1.0, 1.0, 1.0));
+        neptune.localMatrix = glm::rotate(neptune.localMatrix, glm::radians(0.030f * step), glm::vec3(1.0, 1.0, 1.0));
 
 
         glm::mat4 View(1.0f);
@@ -597,6 +1712,8 @@ int main(int argc, char* argv[])
         SDL_Event event;
         while (SDL_PollEvent(&event))
         {
+            //Whatever it is, it may change the frame
+            settleFrames = IDLE_SETTLE_FRAMES;
 
             switch (event.type)
             {
@@ -606,6 +1723,15 @@ int main(int argc, char* argv[])
                 case SDL_WINDOWEVENT_CLOSE:
                     isOpened = false;
                     break;
+                case SDL_WINDOWEVENT_HIDDEN:
+                case SDL_WINDOWEVENT_MINIMIZED:
+                    windowHidden = true;
+                    break;
+                case SDL_WINDOWEVENT_SHOWN:
+                case SDL_WINDOWEVENT_RESTORED:
+                case SDL_WINDOWEVENT_EXPOSED:
+                    windowHidden = false;
+                    break;
                 default:
                     break;
                 }
@@ -645,6 +1771,150 @@ int main(int argc, char* argv[])
                 case SDLK_s:
                     zoomb = true;
                     break;
+                case SDLK_o:
+                    culler.setEnabled(!culler.isEnabled());
+                    INFO("Occlusion culling %s\n", culler.isEnabled() ? "enabled" : "disabled");
+                    break;
+                case SDLK_i:
+                    renderContext.impostors = !renderContext.impostors;
+                    INFO("Spheres drawn as %s\n", renderContext.impostors ? "ray-cast impostors" : "meshes");
+                    break;
+                case SDLK_p:
+                    renderContext.procedural = !renderContext.procedural;
+                    INFO("Sphere meshes %s\n", renderContext.procedural ? "computed from gl_VertexID" : "read from the vertex buffer");
+                    break;
+                case SDLK_t:
+                    renderContext.terrainEnabled = !renderContext.terrainEnabled;
+                    INFO("Rocky bodies drawn as %s\n", renderContext.terrainEnabled ? "quadtree terrain" : "LOD spheres");
+                    break;
+                case SDLK_g:
+                    if (tessellationShader == NULL)
+                    {
+                        INFO("Tessellation is not available on this context\n");
+                        break;
+                    }
+                    renderContext.tessellation = !renderContext.tessellation;
+                    INFO("Spheres %s\n", renderContext.tessellation ? "tessellated on the GPU" : "drawn from the LOD chain");
+                    break;
+                case SDLK_v:
+                    if (puller == NULL)
+                    {
+                        INFO("Vertex pulling is not available on this context\n");
+                        break;
+                    }
+                    renderContext.pulling = !renderContext.pulling;
+                    INFO("Sphere vertices %s\n", renderContext.pulling ? "pulled from shader storage" : "read through their VAO");
+                    break;
+                case SDLK_b:
+                    if (sceneBatch == NULL)
+                    {
+                        INFO("Batching is not available on this context\n");
+                        break;
+                    }
+                    renderContext.batching = !renderContext.batching;
+                    INFO("Bodies drawn %s\n", renderContext.batching ? "in one batch after the traversal" : "one draw call each");
+                    break;
+                case SDLK_c:
+                    if (gpuCuller == NULL)
+                    {
+                        INFO("GPU culling is not available on this context\n");
+                        break;
+                    }
+                    //Both draw the bodies and the belt after the traversal : one at a time, or they would be drawn twice
+                    renderContext.gpuDriven = !renderContext.gpuDriven;
+                    if (renderContext.gpuDriven && renderContext.prepared)
+                    {
+                        renderContext.prepared = false;
+                        INFO("Bodies no longer prepared on the worker threads\n");
+                    }
+                    INFO("Bodies %s\n", renderContext.gpuDriven ? "culled and drawn by the GPU, with the asteroid belt" : "culled on the CPU");
+                    break;
+                case SDLK_m:
+                    if (frameBuilder == NULL)
+                    {
+                        INFO("The multithreaded preparation needs the batching, not available on this context\n");
+                        break;
+                    }
+                    renderContext.prepared = !renderContext.prepared;
+                    if (renderContext.prepared && renderContext.gpuDriven)
+                    {
+                        renderContext.gpuDriven = false;
+                        INFO("Bodies no longer culled and drawn by the GPU\n");
+                    }
+                    INFO("Bodies %s\n", renderContext.prepared ? "prepared on the worker threads, with the asteroid belt" : "prepared during the traversal");
+                    if (renderContext.prepared)
+                        INFO("%u nodes over %u worker threads\n", frameBuilder->getNbNodes(), getNbWorkers());
+                    break;
+                case SDLK_d:
+                    renderContext.depthPrepass = !renderContext.depthPrepass;
+                    INFO("Depth pre-pass %s\n", renderContext.depthPrepass ? "enabled : opaque meshes shaded once per pixel, nearest first" : "disabled");
+                    break;
+                case SDLK_f:
+                    renderContext.frontToBack = !renderContext.frontToBack;
+                    INFO("Opaque meshes drawn %s\n", renderContext.frontToBack ? "front to back" : "in hierarchy order");
+                    break;
+                case SDLK_a:
+                    paused = !paused;
+                    INFO("Simulation %s\n", paused ? "paused" : "running");
+                    break;
+                case SDLK_PLUS:
+                case SDLK_EQUALS:
+                case SDLK_KP_PLUS:
+                    timeWarp = std::min(2.0f * timeWarp, MAX_TIME_WARP);
+                    INFO("Time warp x%g\n", timeWarp);
+                    break;
+                case SDLK_MINUS:
+                case SDLK_KP_MINUS:
+                    timeWarp = std::max(0.5f * timeWarp, 1.0f / MAX_TIME_WARP);
+                    INFO("Time warp x%g\n", timeWarp);
+                    break;
+                case SDLK_e:
+                    onDemand = !onDemand;
+                    INFO("Rendering %s\n", onDemand ? "on demand : idle while paused and nothing moves" : "continuous");
+                    break;
+                case SDLK_x:
+                    if (frameCapture.isCapturing())
+                    {
+                        frameCapture.stop();
+                        break;
+                    }
+                    governor.setEnabled(false);
+                    if (captureCommand != NULL)
+                        frameCapture.startPipe(captureCommand, frameWidth, frameHeight);
+                    else
+                        frameCapture.startSequence(capturePattern, frameWidth, frameHeight);
+                    break;
+                case SDLK_j:
+                    posterPending = true;
+                    break;
+                case SDLK_k:
+                    reportStats = !reportStats;
+                    frameStats.reset();
+                    INFO("Frame cost reports %s\n", reportStats ? "every 5 s" : "off");
+                    break;
+                case SDLK_q:
+                {
+                    if (frameCapture.isCapturing())
+                    {
+                        INFO("The quality governor stays off while recording\n");
+                        break;
+                    }
+                    const QualityStats& stats = governor.getStats();
+                    if (governor.isEnabled())
+                        INFO("Quality governor : %u frames, %u over the budget, %u steps down, %u steps up\n", stats.nbFrames, stats.nbOverBudget, stats.nbStepsDown, stats.nbStepsUp);
+                    governor.setEnabled(!governor.isEnabled());
+                    INFO("Quality governor %s\n", governor.isEnabled() ? "enabled : the quality follows the frame budget" : "disabled : full quality");
+                    break;
+                }
+                case SDLK_h:
+                    if (gpuCuller == NULL)
+                    {
+                        INFO("GPU culling is not available on this context\n");
+                        break;
+                    }
+                    gpuCuller->setOcclusionEnabled(!gpuCuller->isOcclusionEnabled());
+                    INFO("GPU occlusion culling %s\n", gpuCuller->isOcclusionEnabled() ? "enabled" : "disabled");
+                    break;
                 default:
                     break;
                 }
@@ -680,6 +1950,42 @@ int main(int argc, char* argv[])
             }
         }
 
+        if (windowHidden)
+        {
+            frameStats.endFrame(false);
+            continue;
+        }
+
+        //Settings of the quality level. Below the full resolution the frame is drawn offscreen, smaller, and upscaled before the swap
+        const QualityLevel& quality = governor.getLevel();
+        renderContext.lodBias = quality.lodBias;
+        renderContext.effects = quality.effects;
+        if (frameBuilder != NULL)
+            frameBuilder->setLodBias(quality.lodBias);
+        if (governor.getStats().level != textureBiasLevel)
+        {
+            set_textureLodBias(texturedBodies, nbTexturedBodies, bodyTextureArray, quality.textureLodBias);
+            textureBiasLevel = governor.getStats().level;
+        }
+        uint32_t renderWidth = (uint32_t)(frameWidth * quality.renderScale);
+        uint32_t renderHeight = (uint32_t)(frameHeight * quality.renderScale);
+        bool upscaled = (renderWidth != frameWidth || renderHeight != frameHeight) && sceneTarget.resize(renderWidth, renderHeight);
+        if (upscaled)
+            sceneTarget.bind();
+        else if (headless)
+        {
+            //No default framebuffer to draw in
+            if (!sceneTarget.resize(frameWidth, frameHeight))
+                return EXIT_FAILURE;
+            sceneTarget.bind();
+        }
+        else
+            Framebuffer::bindDefault(frameWidth, frameHeight);
+
+        //The levels of detail, the tessellation and the GPU culling are chosen for the pixels drawn, not for those of the window
+        renderContext.width = upscaled ? renderWidth : frameWidth;
+        renderContext.height = upscaled ? renderHeight : frameHeight;
+
         //Clear the screen : the depth buffer and the color buffer
         glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
@@ -831,40 +2137,208 @@ int main(int argc, char* argv[])
 
 
         glm::mat4 Projection(1.0f);
-        Projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
-        std::stack<glm::mat4> modelstack;
-        modelstack.push(glm::mat4(1.0f));
-        Light light;
+        Projection = glm::perspective(glm::radians(90.0f), (float)frameWidth / frameHeight, 0.1f, 100.0f);
+        culler.newFrame();
+
+        if (benchmarkTessellation)
+            renderContext.tessellation = benchmarkFrame >= BENCHMARK_FRAMES;
+        if (benchmarkOverdraw)
+        {
+            uint32_t mode = benchmarkFrame / BENCHMARK_FRAMES;
+            renderContext.frontToBack = mode == 1;
+            renderContext.depthPrepass = mode == 2;
+        }
+        std::chrono::high_resolution_clock::time_point cpuStart = std::chrono::high_resolution_clock::now();
+        frameStats.add(FRAME_STAGE_EVENTS, std::chrono::duration<double, std::milli>(cpuStart - eventsStart).count());
+        gpuTimer.begin();
+        if (benchmarkOverdraw)
+            overdrawCounter.begin(OVERDRAW_SHADING);
+
+        drawScene(View, Projection, renderContext.height);
+        renderContext.width = frameWidth;
+        renderContext.height = frameHeight;
+
+        if (benchmarkOverdraw)
+            overdrawCounter.end();
+        gpuTimer.end();
+        std::chrono::duration<double, std::milli> cpuDuration = std::chrono::high_resolution_clock::now() - cpuStart;
+        if (benchmarkTessellation || benchmarkOverdraw)
+            benchmarkCpuMs += cpuDuration.count();
+        if (benchmarkOverdraw)
+            overdrawCounter.measureCoverage();
+
+        //The depth of the whole frame is the occluder of the next GPU culling. Its pyramid has the size of the window : a smaller frame is not one
+        if (renderContext.gpuDriven && upscaled)
+            gpuCuller->invalidateDepth();
+        else if (renderContext.gpuDriven)
+            gpuCuller->updateDepth();
+
+        std::chrono::high_resolution_clock::time_point presentStart = std::chrono::high_resolution_clock::now();
+        if (upscaled)
+            sceneTarget.blit(frameWidth, frameHeight);
+
+        //Read in a pixel buffer, written a few frames later
+        frameCapture.capture();
+
+        //Display on screen (swap the buffer on screen and the buffer you are drawing on). Headless, the frame stays in sceneTarget
+        if (!headless)
+            SDL_GL_SwapWindow(windowContext.window);
+        StreamBuffer::newFrame();
+        std::chrono::high_resolution_clock::time_point presentEnd = std::chrono::high_resolution_clock::now();
+        frameStats.add(FRAME_STAGE_SUBMISSION, std::chrono::duration<double, std::milli>(presentStart - cpuStart).count());
+        frameStats.add(FRAME_STAGE_PRESENT, std::chrono::duration<double, std::milli>(presentEnd - presentStart).count());
+        frameStats.add(FRAME_STAGE_GPU, gpuTimer.getLastMs());
+        frameStats.endFrame(true);
+
+        //Headless : the frames asked for, the last one saved. The benchmarks stop by themselves
+        bool lastFrame = headless && !benchmarkTessellation && !benchmarkOverdraw && ++headlessFrame >= headlessFrames;
+        if (lastFrame && outputPath != NULL)
+        {
+            std::vector<uint8_t> pixels(4 * (size_t)frameWidth * frameHeight);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(0, 0, frameWidth, frameHeight, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+            if (writePPM(outputPath, frameWidth, frameHeight, &pixels[0], true))
+                INFO("Frame %u saved in %s (%ux%u)\n", headlessFrame, outputPath, frameWidth, frameHeight);
+        }
+
+        //The poster : the frame just drawn, again, a tile at a time at the full quality. The culling which relies on the previous frames
+        //would use the previous tile instead : the occlusion queries and the GPU culling depth are off, the terrain waits for its selections
+        //The request is kept until its frame comes : headless, the last one
+        if (posterPending && (!headless || lastFrame))
+        {
+            posterPending = false;
+            if (tiledRenderer.start(posterPath, posterWidth, posterHeight, posterTileSize, glm::radians(90.0f), 0.1f, 100.0f))
+            {
+                bool occlusion = culler.isEnabled();
+                culler.setEnabled(false);
+                planetTerrain.setSynchronous(true);
+                if (gpuCuller != NULL)
+                    gpuCuller->invalidateDepth();
+                renderContext.lodBias = 0;
+                renderContext.effects = true;
+                if (frameBuilder != NULL)
+                    frameBuilder->setLodBias(0);
+                if (textureBiasLevel != 0)
+                {
+                    set_textureLodBias(texturedBodies, nbTexturedBodies, bodyTextureArray, QualityGovernor::getLevel(0).textureLodBias);
+                    textureBiasLevel = 0;
+                }
 
+                for (uint32_t i = 0; i < tiledRenderer.getNbTiles(); i++)
+                {
+                    //The levels of detail are chosen for the pixels of the poster : the tile has its size, the projection only covers it
+                    const RenderTile& tile = tiledRenderer.beginTile(i);
+                    renderContext.width = tile.width;
+                    renderContext.height = tile.height;
+                    drawScene(View, tile.projection, tile.height);
+                    tiledRenderer.endTile();
+                    StreamBuffer::newFrame();
+                    if ((i + 1) % tiledRenderer.getNbColumns() == 0)
+                        INFO("Poster : %u/%u rows of tiles drawn\n", (i + 1) / tiledRenderer.getNbColumns(), tiledRenderer.getNbRows());
+                }
+                tiledRenderer.finish();
 
-        Draw(modelstack, View, Projection, shader, soleil, light);
-        Draw(modelstack, View, Projection, shader, dad_mercury, light);
-        Draw(modelstack, View, Projection, shader, dad_terre, light);
-        Draw(modelstack, View, Projection, shader, dad_venus, light);
-        Draw(modelstack, View, Projection, shader, dad_mars, light);
-        Draw(modelstack, View, Projection, shader, dad_jupiter, light);
-        Draw(modelstack, View, Projection, shader, dad_saturne, light);
-        Draw(modelstack, View, Projection, shader, dad_uranus, light);
-        Draw(modelstack, View, Projection, shader, dad_neptune, light);
+                renderContext.width = frameWidth;
+                renderContext.height = frameHeight;
+                planetTerrain.setSynchronous(false);
+                culler.setEnabled(occlusion);
+            }
+        }
 
+        if (lastFrame)
+        {
+            frameStats.report();
+            isOpened = false;
+        }
 
-        //Display on screen (swap the buffer on screen and the buffer you are drawing on)
-        SDL_GL_SwapWindow(window);
+        //Idle once the camera and the simulation stopped and the frames settled
+        bool cameraMoving = gauche || droite || haut || bas || zooma || zoomb || reset || (camdep ? angle <= 90.0f : angle >= 0.0f);
+        if (!paused || cameraMoving || frameCapture.isCapturing())
+            settleFrames = IDLE_SETTLE_FRAMES;
+        else if (settleFrames > 0)
+            settleFrames--;
+        if (reportStats && frameStats.getElapsedMs() >= STATS_PERIOD_MS)
+        {
+            const QualityStats& quality = governor.getStats();
+            frameStats.report();
+            INFO("    Quality %s (%u steps down, %u up), time warp x%g%s\n", governor.getLevel().name, quality.nbStepsDown, quality.nbStepsUp, timeWarp, paused ? ", paused" : "");
+            frameStats.reset();
+        }
 
         //Time in ms telling us when this frame ended. Useful for keeping a fix framerate
         uint32_t timeEnd = SDL_GetTicks();
 
-        //We want FRAMERATE FPS
-        if (timeEnd - timeBegin < TIME_PER_FRAME_MS)
+        if (governor.addFrame(cpuDuration.count(), gpuTimer.getLastMs()))
+        {
+            const QualityStats& stats = governor.getStats();
+            const QualityLevel& level = governor.getLevel();
+            INFO("Quality %s : %ux%u upscaled to %ux%u, LOD bias %d, texture bias %.1f, terrain and tessellation %s (CPU %.2f ms, GPU %.2f ms, budget %.2f ms)\n",
+                level.name, (uint32_t)(frameWidth * level.renderScale), (uint32_t)(frameHeight * level.renderScale), frameWidth, frameHeight, level.lodBias, level.textureLodBias,
+                level.effects ? "allowed" : "off", stats.cpuMs, stats.gpuMs, stats.budgetMs);
+        }
+
+        if (benchmarkTessellation)
+        {
+            //Report each pass, and quit after the last one
+            if (++benchmarkFrame % BENCHMARK_FRAMES == 0)
+            {
+                gpuTimer.finish();
+                INFO("%-16s GPU %8.3f ms/frame, CPU submission %8.3f ms/frame (%u frames)\n",
+                    renderContext.tessellation ? "Tessellation" : "LOD chain", gpuTimer.getAverageMs(), benchmarkCpuMs / BENCHMARK_FRAMES, BENCHMARK_FRAMES);
+                if (!GpuTimer::isSupported())
+                    INFO("No timer queries on this context : the GPU time is not measured\n");
+                gpuTimer.reset();
+                benchmarkCpuMs = 0.0;
+                if (renderContext.tessellation || tessellationShader == NULL)
+                    isOpened = false;
+            }
+            continue;
+        }
+
+        if (benchmarkOverdraw)
+        {
+            //Report each mode, and quit after the last one
+            if (++benchmarkFrame % BENCHMARK_FRAMES == 0)
+            {
+                gpuTimer.finish();
+                overdrawCounter.finish();
+                uint32_t mode = benchmarkFrame / BENCHMARK_FRAMES - 1;
+                INFO("%-16s GPU %8.3f ms/frame, CPU %8.3f ms/frame, %6.2f shaded and %6.2f depth only fragments per covered pixel (%u frames)\n",
+                    overdrawModes[mode], gpuTimer.getAverageMs(), benchmarkCpuMs / BENCHMARK_FRAMES,
+                    overdrawCounter.getPerPixel(OVERDRAW_SHADING), overdrawCounter.getPerPixel(OVERDRAW_DEPTH), BENCHMARK_FRAMES);
+                gpuTimer.reset();
+                overdrawCounter.reset();
+                benchmarkCpuMs = 0.0;
+                if (mode == 2)
+                    isOpened = false;
+            }
+            continue;
+        }
+
+        //We want FRAMERATE FPS. Headless, as fast as it can
+        if (!headless && timeEnd - timeBegin < TIME_PER_FRAME_MS)
+        {
             SDL_Delay(TIME_PER_FRAME_MS - (timeEnd - timeBegin));
+            frameStats.add(FRAME_STAGE_PACING, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - presentEnd).count());
+        }
 
     }
 
-    //Free everything
-    if (context != NULL)
-        SDL_GL_DeleteContext(context);
-    if (window != NULL)
-        SDL_DestroyWindow(window);
+    //The frames still in flight
+    frameCapture.stop();
+
+    //Free everything. The objects on the stack go with the end of main(), before the context (see WindowContext)
+    delete frameBuilder;
+    delete gpuCuller;
+    if (sceneBatch != NULL)
+    {
+        glDeleteTextures(1, &sceneBatch->textures);
+        glDeleteTextures(1, &sceneBatch->drawDataTexture);
+        delete sceneBatch->drawDataStream;
+        delete sceneBatch->meshes;
+        delete sceneBatch;
+    }
+    delete puller;
 
     return 0;
 